@@ -172,6 +172,8 @@ option(BUILD_OLD_CONFIG "Enable support for the old syntax of configurations"
 
 option(BUILD_MATH "Enable math support" true)
 
+option(BUILD_ALLOC_STATS "Count heap allocations per update phase" false)
+
 option(BUILD_NCURSES "Enable ncurses support" true)
 
 dependent_option(LEAKFREE_NCURSES
@@ -0,0 +1,132 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "alloc-stats.hh"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "content/text_object.h"
+#include "logging.h"
+
+/* Every C++ allocation ends up in the replaceable operator new(size_t) below
+ * (array and nothrow new call it), which bumps the counter of the current
+ * phase. malloc() and friends are not counted.
+ *
+ * Frames are those of the thread calling alloc_frame_done(), the main loop,
+ * and only its allocations count towards them: the phase it is in says
+ * nothing about what the pool's workers or the timer thread are doing. */
+
+namespace {
+thread_local uint8_t current_phase =
+    static_cast<uint8_t>(conky::alloc_phase::OTHER);
+thread_local bool counts_frames = false;
+std::atomic<uint64_t> frame_allocs[conky::alloc_phase_count];
+std::atomic<uint64_t> last_frame[conky::alloc_phase_count];
+thread_local uint64_t allocs_of_thread = 0;
+
+const char *phase_names[conky::alloc_phase_count] = {
+    "other", "update", "generate", "layout", "draw"};
+}  // namespace
+
+void *operator new(std::size_t size) {
+  if (counts_frames) {
+    frame_allocs[current_phase].fetch_add(1, std::memory_order_relaxed);
+  }
+  allocs_of_thread++;
+
+  if (size == 0) { size = 1; }
+  for (;;) {
+    void *p = std::malloc(size);
+    if (p != nullptr) { return p; }
+
+    std::new_handler handler = std::get_new_handler();
+    if (handler == nullptr) { throw std::bad_alloc(); }
+    handler();
+  }
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+namespace conky {
+
+alloc_phase set_alloc_phase(alloc_phase phase) {
+  auto previous = static_cast<alloc_phase>(current_phase);
+  current_phase = static_cast<uint8_t>(phase);
+  return previous;
+}
+
+void alloc_frame_done() {
+  counts_frames = true;
+  for (size_t i = 0; i < alloc_phase_count; i++) {
+    last_frame[i].store(frame_allocs[i].exchange(0, std::memory_order_relaxed),
+                        std::memory_order_relaxed);
+  }
+}
+
+uint64_t last_frame_allocs(alloc_phase phase) {
+  return last_frame[static_cast<size_t>(phase)].load(
+      std::memory_order_relaxed);
+}
+
+uint64_t thread_allocs() { return allocs_of_thread; }
+
+}  // namespace conky
+
+void scan_conky_allocs(struct text_object *obj, const char *arg) {
+  obj->data.i = -1;
+  if (arg == nullptr) { return; }
+
+  for (size_t i = 0; i < conky::alloc_phase_count; i++) {
+    if (strcmp(arg, phase_names[i]) == 0) {
+      obj->data.i = static_cast<int>(i);
+      return;
+    }
+  }
+  NORM_ERR("conky_allocs: unknown phase '%s', showing all of them", arg);
+}
+
+/* allocations of the given phase, or of all of them, in the last frame */
+void print_conky_allocs(struct text_object *obj, char *p,
+                        unsigned int p_max_size) {
+  uint64_t count = 0;
+
+  if (obj->data.i >= 0) {
+    count = conky::last_frame_allocs(
+        static_cast<conky::alloc_phase>(obj->data.i));
+  } else {
+    for (size_t i = 0; i < conky::alloc_phase_count; i++) {
+      count += conky::last_frame_allocs(static_cast<conky::alloc_phase>(i));
+    }
+  }
+  snprintf(p, p_max_size, "%llu", static_cast<unsigned long long>(count));
+}
@@ -0,0 +1,96 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef ALLOC_STATS_HH
+#define ALLOC_STATS_HH
+
+#include "config.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace conky {
+
+/* The parts of an update which allocations are attributed to when conky is
+ * built with BUILD_ALLOC_STATS: running the update callbacks, generating the
+ * text, measuring it and drawing it. Anything else is OTHER. */
+enum class alloc_phase : uint8_t { OTHER, UPDATE, GENERATE, LAYOUT, DRAW };
+constexpr size_t alloc_phase_count = 5;
+
+#ifdef BUILD_ALLOC_STATS
+/* attribute further allocations of the calling thread to phase, returns the
+ * previous phase */
+alloc_phase set_alloc_phase(alloc_phase phase);
+
+/* end the current frame: the counts so far become those of the last frame.
+ * From then on the allocations of the calling thread count towards frames,
+ * those of other threads never do. */
+void alloc_frame_done();
+
+/* number of allocations made in phase during the last frame */
+uint64_t last_frame_allocs(alloc_phase phase);
+
+/* number of allocations the calling thread has made so far */
+uint64_t thread_allocs();
+
+/* Test helper counting the allocations the current thread makes while the
+ * counter is alive. */
+class alloc_counter {
+  uint64_t start;
+
+ public:
+  alloc_counter() : start(thread_allocs()) {}
+  uint64_t count() const { return thread_allocs() - start; }
+};
+#else
+inline alloc_phase set_alloc_phase(alloc_phase) { return alloc_phase::OTHER; }
+inline void alloc_frame_done() {}
+#endif /* BUILD_ALLOC_STATS */
+
+/* attributes allocations to a phase for as long as it is alive */
+class alloc_phase_scope {
+  alloc_phase previous;
+
+ public:
+  explicit alloc_phase_scope(alloc_phase phase)
+      : previous(set_alloc_phase(phase)) {}
+  ~alloc_phase_scope() { set_alloc_phase(previous); }
+
+  alloc_phase_scope(const alloc_phase_scope &) = delete;
+  alloc_phase_scope &operator=(const alloc_phase_scope &) = delete;
+};
+
+}  // namespace conky
+
+#ifdef BUILD_ALLOC_STATS
+/* ${conky_allocs [update|generate|layout|draw]} */
+void scan_conky_allocs(struct text_object *, const char *);
+void print_conky_allocs(struct text_object *, char *, unsigned int);
+#endif /* BUILD_ALLOC_STATS */
+
+#endif /* ALLOC_STATS_HH */
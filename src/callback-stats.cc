@@ -0,0 +1,130 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (C) 2010 Pavel Labath et al.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "callback-stats.hh"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+
+#include "conky.h"
+#include "content/text_object.h"
+#include "logging.h"
+
+namespace {
+/* how many callbacks ${cb_stats} shows by default */
+const int default_top = 5;
+/* width of the name column of ${cb_stats}, longer names are cut */
+const int name_width = 20;
+
+/* callback_reports() as of the current update, shared by all ${cb_stats}
+ * objects and only made when one of them is printed */
+const std::vector<conky::callback_report> &reports_of_update() {
+  static std::vector<conky::callback_report> reports;
+  static int made_in = -1;
+
+  if (made_in != get_total_updates()) {
+    reports = conky::callback_reports();
+    made_in = get_total_updates();
+  }
+  return reports;
+}
+}  // namespace
+
+namespace conky {
+std::string format_micros(uint64_t us) {
+  char buf[32];
+
+  if (us < 1000) {
+    snprintf(buf, sizeof buf, "%" PRIu64 "us", us);
+  } else if (us < 1000000) {
+    snprintf(buf, sizeof buf, "%.1fms", us / 1e3);
+  } else {
+    snprintf(buf, sizeof buf, "%.2fs", us / 1e6);
+  }
+  return buf;
+}
+
+std::string format_callback_report(const callback_report &r) {
+  char buf[256];
+
+  snprintf(buf, sizeof buf,
+           "runs %" PRIu64 " skipped %" PRIu64 " timeouts %" PRIu64
+           " p50 %s p99 %s max %s total %s waited %s",
+           r.runs, r.skipped, r.timeouts, format_micros(r.p50).c_str(),
+           format_micros(r.p99).c_str(), format_micros(r.max).c_str(),
+           format_micros(r.total).c_str(), format_micros(r.waited).c_str());
+  return r.name + ": " + buf;
+}
+
+void dump_callback_reports(FILE *out) {
+  auto reports = callback_reports();
+
+  fprintf(out, "%zu callbacks, updates waited %s for them\n", reports.size(),
+          format_micros(callbacks_waited()).c_str());
+  for (const auto &r : reports) {
+    fprintf(out, "  %s\n", format_callback_report(r).c_str());
+  }
+  fflush(out);
+}
+}  // namespace conky
+
+void scan_cb_stats(struct text_object *obj, const char *arg) {
+  obj->data.i = default_top;
+  if (arg == nullptr) { return; }
+
+  int n;
+  if (sscanf(arg, "top %d", &n) == 1 && n > 0) {
+    obj->data.i = n;
+  } else if (strcmp(arg, "top") != 0) {
+    NORM_ERR("cb_stats: expected 'top [n]', got '%s'", arg);
+  }
+}
+
+/* a line for each of the obj->data.i callbacks which spent the most time in
+ * work() */
+void print_cb_stats(struct text_object *obj, char *p,
+                    unsigned int p_max_size) {
+  const auto &reports = reports_of_update();
+  size_t shown = std::min<size_t>(reports.size(), obj->data.i);
+  size_t len = 0;
+
+  if (p_max_size == 0) { return; }
+  p[0] = '\0';
+  for (size_t i = 0; i < shown && len < p_max_size; ++i) {
+    const auto &r = reports[i];
+    len += snprintf(p + len, p_max_size - len,
+                    "%s%-*.*s p50 %s p99 %s max %s", i == 0 ? "" : "\n",
+                    name_width, name_width, r.name.c_str(),
+                    conky::format_micros(r.p50).c_str(),
+                    conky::format_micros(r.p99).c_str(),
+                    conky::format_micros(r.max).c_str());
+  }
+}
+
+void scan_if_stale(struct text_object *obj, const char *arg) {
+  obj->data.s = arg != nullptr ? strdup(arg) : nullptr;
+}
+
+int check_if_stale(struct text_object *obj) {
+  return static_cast<int>(conky::callbacks_stale(obj->data.s));
+}
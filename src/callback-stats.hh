@@ -0,0 +1,51 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (C) 2010 Pavel Labath et al.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef CALLBACK_STATS_HH
+#define CALLBACK_STATS_HH
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "update-cb.hh"
+
+namespace conky {
+/* a duration in microseconds as text, in us, ms or s, whichever fits */
+std::string format_micros(uint64_t us);
+
+/* the line of r in dump_callback_reports() */
+std::string format_callback_report(const callback_report &r);
+
+/* writes the reports of all callbacks to out, e.g. on SIGUSR2 */
+void dump_callback_reports(FILE *out);
+}  // namespace conky
+
+/* ${cb_stats [top [n]]} */
+void scan_cb_stats(struct text_object *, const char *);
+void print_cb_stats(struct text_object *, char *, unsigned int);
+
+/* ${if_stale [callback]} */
+void scan_if_stale(struct text_object *, const char *);
+int check_if_stale(struct text_object *);
+
+#endif /* CALLBACK_STATS_HH */
@@ -423,29 +423,11 @@ conky::simple_config_setting<std::string> github_token("github_token", "",
                                                        false);
 
 void update_stuff() {
-  /* clear speeds, addresses and up status in case device was removed and
-   *  doesn't get updated */
-
-#ifdef HAVE_OPENMP
-#pragma omp parallel for schedule(dynamic, 10)
-#endif /* HAVE_OPENMP */
-  for (int i = 0; i < MAX_NET_INTERFACES; ++i) {
-    if (netstats[i].dev != nullptr) {
-      netstats[i].up = 0;
-      netstats[i].recv_speed = 0.0;
-      netstats[i].trans_speed = 0.0;
-      netstats[i].addr.sa_data[2] = 0;
-      netstats[i].addr.sa_data[3] = 0;
-      netstats[i].addr.sa_data[4] = 0;
-      netstats[i].addr.sa_data[5] = 0;
-    }
-  }
-
   /* this is a stub on all platforms except solaris */
   prepare_update();
 
   /* if you registered a callback with conky::register_cb, this will run it */
-  conky::run_all_callbacks();
+  conky::run_all_callbacks(update_deadline.get(*state));
 
 #if !defined(__linux__)
   /* XXX: move the following into the update_meminfo() functions? */
@@ -535,11 +517,13 @@ double cpu_barval(struct text_object *obj) {
   return 0.;
 }
 
-#define PRINT_HR_GENERATOR(name)                                     \
-  void print_##name(struct text_object *obj, char *p,                \
-                    unsigned int p_max_size) {                       \
-    human_readable(apply_base_multiplier(obj->data.s, info.name), p, \
-                   p_max_size);                                      \
+#define PRINT_HR_GENERATOR(name)                                         \
+  size_t print_##name(struct text_object *obj, char *p,                  \
+                      unsigned int p_max_size) {                         \
+    return written_length(                                               \
+        human_readable(apply_base_multiplier(obj->data.s, info.name), p, \
+                       p_max_size),                                      \
+        p_max_size);                                                     \
   }
 
 PRINT_HR_GENERATOR(mem)
@@ -646,6 +630,26 @@ void print_uptime_short(struct text_object *obj, char *p,
   format_seconds_short(p, p_max_size, static_cast<int>(info.uptime));
 }
 
+/* The uptime rounded down to the smallest field the format_seconds*() output
+ * shows, which is what that output changes with. */
+uint64_t uptime_cache_key(struct text_object *obj) {
+  (void)obj;
+  auto seconds = static_cast<uint64_t>(info.uptime);
+  if (!times_in_seconds.get(*state) && seconds >= 86400) {
+    seconds -= seconds % 60;
+  }
+  return seconds;
+}
+
+uint64_t uptime_short_cache_key(struct text_object *obj) {
+  (void)obj;
+  auto seconds = static_cast<uint64_t>(info.uptime);
+  if (times_in_seconds.get(*state)) { return seconds; }
+  if (seconds >= 86400) { return seconds - seconds % 3600; }
+  if (seconds >= 3600) { return seconds - seconds % 60; }
+  return seconds;
+}
+
 void print_processes(struct text_object *obj, char *p,
                      unsigned int p_max_size) {
   (void)obj;
@@ -693,7 +697,7 @@ void print_free_cached(struct text_object *obj, char *p,
 
 void print_evaluate(struct text_object *obj, char *p, unsigned int p_max_size) {
   std::vector<char> buf(text_buffer_size.get(*state));
-  evaluate(obj->data.s, &buf[0], buf.size());
+  evaluate(obj->data.s, &buf[0], buf.size(), &obj->evaluated);
   evaluate(&buf[0], p, p_max_size);
 }
 
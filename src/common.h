@@ -121,22 +121,22 @@ double loadgraphval(struct text_object *);
 uint8_t cpu_percentage(struct text_object *);
 double cpu_barval(struct text_object *);
 
-void print_mem(struct text_object *, char *, unsigned int);
-void print_memwithbuffers(struct text_object *, char *, unsigned int);
-void print_memeasyfree(struct text_object *, char *, unsigned int);
-void print_legacymem(struct text_object *, char *, unsigned int);
-void print_memfree(struct text_object *, char *, unsigned int);
-void print_memmax(struct text_object *, char *, unsigned int);
-void print_memactive(struct text_object *, char *, unsigned int);
-void print_meminactive(struct text_object *, char *, unsigned int);
-void print_memwired(struct text_object *, char *, unsigned int);
-void print_memlaundry(struct text_object *, char *, unsigned int);
-void print_memdirty(struct text_object *, char *, unsigned int);
-void print_shmem(struct text_object *, char *, unsigned int);
-void print_memavail(struct text_object *, char *, unsigned int);
-void print_swap(struct text_object *, char *, unsigned int);
-void print_swapfree(struct text_object *, char *, unsigned int);
-void print_swapmax(struct text_object *, char *, unsigned int);
+size_t print_mem(struct text_object *, char *, unsigned int);
+size_t print_memwithbuffers(struct text_object *, char *, unsigned int);
+size_t print_memeasyfree(struct text_object *, char *, unsigned int);
+size_t print_legacymem(struct text_object *, char *, unsigned int);
+size_t print_memfree(struct text_object *, char *, unsigned int);
+size_t print_memmax(struct text_object *, char *, unsigned int);
+size_t print_memactive(struct text_object *, char *, unsigned int);
+size_t print_meminactive(struct text_object *, char *, unsigned int);
+size_t print_memwired(struct text_object *, char *, unsigned int);
+size_t print_memlaundry(struct text_object *, char *, unsigned int);
+size_t print_memdirty(struct text_object *, char *, unsigned int);
+size_t print_shmem(struct text_object *, char *, unsigned int);
+size_t print_memavail(struct text_object *, char *, unsigned int);
+size_t print_swap(struct text_object *, char *, unsigned int);
+size_t print_swapfree(struct text_object *, char *, unsigned int);
+size_t print_swapmax(struct text_object *, char *, unsigned int);
 uint8_t mem_percentage(struct text_object *);
 double mem_barval(struct text_object *);
 double mem_with_buffers_barval(struct text_object *);
@@ -155,6 +155,8 @@ void print_version(struct text_object *obj, char *p, unsigned int p_max_size);
 
 void print_uptime(struct text_object *, char *, unsigned int);
 void print_uptime_short(struct text_object *, char *, unsigned int);
+uint64_t uptime_cache_key(struct text_object *);
+uint64_t uptime_short_cache_key(struct text_object *);
 
 void print_processes(struct text_object *, char *, unsigned int);
 void print_running_processes(struct text_object *, char *, unsigned int);
@@ -66,6 +66,8 @@
 #include <dirent.h>
 #endif /* HAVE_DIRENT_H */
 
+#include "alloc-stats.hh"
+#include "callback-stats.hh"
 #include "common.h"
 #include "content/text_object.h"
 
@@ -210,6 +212,7 @@ conky::simple_config_setting<bool> out_to_stdout("out_to_console",
                                                  false);
 conky::simple_config_setting<bool> out_to_stderr("out_to_stderr", false, false);
 
+/* how many processes each kind of top shows, 0 if it isn't used */
 int top_cpu, top_mem, top_time;
 #ifdef BUILD_IOSTATS
 int top_io;
@@ -222,6 +225,10 @@ conky::range_config_setting<double> update_interval(
 conky::range_config_setting<double> update_interval_on_battery(
     "update_interval_on_battery", 0.0, std::numeric_limits<double>::infinity(),
     NOBATTERY, true);
+/* how long an update waits for the callbacks, 0 for as long as they take */
+conky::range_config_setting<double> update_deadline(
+    "update_deadline", 0.0, std::numeric_limits<double>::infinity(), 0.0,
+    true);
 conky::simple_config_setting<std::string> detect_battery("detect_battery",
                                                          std::string("BAT0"),
                                                          false);
@@ -426,6 +433,26 @@ conky::gradient_factory *create_gradient_factory(int width, Colour first_colour,
   }
   return nullptr;
 }
+
+/* like create_gradient_factory(w, ...)->create_gradient(), but into colours
+ * and without allocating, for drawing graphs on every update */
+static void fill_gradient(Colour *colours, int width, Colour first_colour,
+                          Colour last_colour) {
+  switch (graph_gradient_mode.get(*state)) {
+    case RGB_GRADIENT:
+      conky::rgb_gradient_factory(width, first_colour, last_colour)
+          .create_gradient(colours);
+      break;
+    case HSV_GRADIENT:
+      conky::hsv_gradient_factory(width, first_colour, last_colour)
+          .create_gradient(colours);
+      break;
+    case HCL_GRADIENT:
+      conky::hcl_gradient_factory(width, first_colour, last_colour)
+          .create_gradient(colours);
+      break;
+  }
+}
 #endif /* BUILD_GUI */
 
 /* formatted text to render on screen, generated in generate_text(),
@@ -433,6 +460,10 @@ conky::gradient_factory *create_gradient_factory(int width, Colour first_colour,
 
 static char *text_buffer;
 
+/* same size as text_buffer, max_text_width wraps text_buffer into it and then
+ * the two are swapped */
+static char *wrap_buffer;
+
 /* quite boring functions */
 
 static inline void for_each_line(char *b, int f(char *, int)) {
@@ -477,14 +508,28 @@ static void convert_escapes(char *buf) {
 int spaced_print(char *buf, int size, const char *format, int width, ...) {
   int len = 0;
   va_list argp;
-  char *tempbuf;
+  char stackbuf[128];
+  std::unique_ptr<char[]> heapbuf;
+  char *tempbuf = stackbuf;
 
   if (size < 1) { return 0; }
-  tempbuf = new char[size];
 
-  // Passes the varargs along to vsnprintf
+  // Passes the varargs along to vsnprintf. Numbers fit the stack buffer, only
+  // longer output needs a heap buffer of the full size.
   va_start(argp, width);
-  vsnprintf(tempbuf, size, format, argp);
+  if (static_cast<size_t>(size) > sizeof stackbuf) {
+    va_list copy;
+    va_copy(copy, argp);
+    int needed = vsnprintf(stackbuf, sizeof stackbuf, format, copy);
+    va_end(copy);
+    if (needed >= static_cast<int>(sizeof stackbuf)) {
+      heapbuf.reset(new char[size]);
+      tempbuf = heapbuf.get();
+      vsnprintf(tempbuf, size, format, argp);
+    }
+  } else {
+    vsnprintf(stackbuf, size, format, argp);
+  }
   va_end(argp);
 
   switch (use_spacer.get(*state)) {
@@ -498,7 +543,6 @@ int spaced_print(char *buf, int size, const char *format, int width, ...) {
       len = snprintf(buf, size, "%-*s", width, tempbuf);
       break;
   }
-  delete[] tempbuf;
   return len;
 }
 
@@ -515,7 +559,7 @@ int percent_print(char *buf, int size, unsigned value) {
  * The algorithm always divides by 1024, as unit-conversion of byte
  * counts suggests. But for output length determination we need to
  * compare with 1000 here, as we print in decimal form. */
-void human_readable(long long num, char *buf, int size) {
+int human_readable(long long num, char *buf, int size) {
   const char **suffix = suffixes;
   float fnum;
   int precision;
@@ -524,8 +568,7 @@ void human_readable(long long num, char *buf, int size) {
 
   /* Possibly just output as usual, for example for stdout usage */
   if (!format_human_readable.get(*state)) {
-    spaced_print(buf, size, "%lld", 6, num);
-    return;
+    return spaced_print(buf, size, "%lld", 6, num);
   }
   if (short_units.get(*state)) {
     width = 5;
@@ -537,9 +580,8 @@ void human_readable(long long num, char *buf, int size) {
   width += strlen(units_spacer.get(*state).c_str());
 
   if (llabs(num) < 1000LL) {
-    spaced_print(buf, size, format, width, 0, static_cast<float>(num),
-                 units_spacer.get(*state).c_str(), _(*suffix));
-    return;
+    return spaced_print(buf, size, format, width, 0, static_cast<float>(num),
+                        units_spacer.get(*state).c_str(), _(*suffix));
   }
 
   while (llabs(num / 1024) >= 1000LL && (**(suffix + 2) != 0)) {
@@ -571,8 +613,8 @@ void human_readable(long long num, char *buf, int size) {
   if (fnum < 99.95) { precision = 1; /* print 10-99 with one decimal place */ }
   if (fnum < 9.995) { precision = 2; /* print 0-9 with two decimal places */ }
 
-  spaced_print(buf, size, format, width, precision, fnum,
-               units_spacer.get(*state).c_str(), _(*suffix));
+  return spaced_print(buf, size, format, width, precision, fnum,
+                      units_spacer.get(*state).c_str(), _(*suffix));
 }
 
 /* global object list root element */
@@ -589,10 +631,28 @@ static void extract_variable_text(const char *p) {
   delete_block_and_zero(tmpstring1);
   delete_block_and_zero(tmpstring2);
   delete_block_and_zero(text_buffer);
+  delete_block_and_zero(wrap_buffer);
 
   extract_variable_text_internal(&global_root_object, p);
 }
 
+/* the buffers the text is generated into, sized by the current settings */
+static void allocate_text_buffers() {
+  text_buffer = new char[max_user_text.get(*state)];
+  memset(text_buffer, 0, max_user_text.get(*state));
+  wrap_buffer = new char[max_user_text.get(*state)];
+  memset(wrap_buffer, 0, max_user_text.get(*state));
+  tmpstring1 = new char[text_buffer_size.get(*state)];
+  memset(tmpstring1, 0, text_buffer_size.get(*state));
+  tmpstring2 = new char[text_buffer_size.get(*state)];
+  memset(tmpstring2, 0, text_buffer_size.get(*state));
+}
+
+void load_text(const char *text) {
+  extract_variable_text(text);
+  allocate_text_buffers();
+}
+
 void parse_conky_vars(struct text_object *root, const char *txt, char *p,
                       int p_max_size) {
   extract_variable_text_internal(root, txt);
@@ -609,96 +669,189 @@ void parse_conky_vars(struct text_object *root, const char *txt, char *p,
  * - each ENDIF is silently being ignored
  *
  * Why this works (or: how jumping works):
- * Jumping means to overwrite the "obj" variable of the loop and set it to the
- * target (i.e. the corresponding ELSE or ENDIF). After that, the for-loop does
- * the rest: as regularly, "obj" is being updated to point to obj->next, so
- * object parsing continues right after the corresponding ELSE or ENDIF. This
- * means that if we find an ELSE, it's corresponding IF must not have jumped,
- * so we need to jump always. If we encounter an ENDIF, it's corresponding IF
- * or ELSE has not jumped, and there is nothing to do.
+ * The object list is compiled into a text_program (see
+ * compile_text_objects()), where each IF stores the index of the instruction
+ * following its corresponding ELSE or ENDIF. Jumping means to continue the
+ * loop at that index, so object parsing continues right after the
+ * corresponding ELSE or ENDIF. This means that if we find an ELSE, it's
+ * corresponding IF must not have jumped, so we need to jump always. If we
+ * encounter an ENDIF, it's corresponding IF or ELSE has not jumped, and there
+ * is nothing to do.
  */
 void generate_text_internal(char *p, int p_max_size, struct text_object root) {
-  struct text_object *obj;
-  size_t a;
+  struct text_program local_program;
+  struct text_program *program = root.program;
 
-  if (p == nullptr) { return; }
+  if (p == nullptr || p_max_size <= 0) { return; }
 
-#ifdef BUILD_ICONV
-  char *buff_in;
+  /* roots built by hand rather than by extract_variable_text_internal() have
+   * no program yet */
+  if (program == nullptr) {
+    compile_text_objects(&root, &local_program);
+    program = &local_program;
+  }
 
-  buff_in = new char[p_max_size];
-  memset(buff_in, 0, p_max_size);
+#ifdef BUILD_ICONV
+  /* scratch space for iconv_convert(), kept between calls */
+  static thread_local std::vector<char> iconv_buffer;
+  if (iconv_buffer.size() < static_cast<size_t>(p_max_size)) {
+    iconv_buffer.resize(p_max_size);
+  }
+  char *buff_in = iconv_buffer.data();
 #endif /* BUILD_ICONV */
 
-  p[0] = 0;
-  obj = root.next;
-  while ((obj != nullptr) && p_max_size > 0) {
-    /* check callbacks for existence and act accordingly */
-    if (obj->callbacks.print != nullptr) {
-      (*obj->callbacks.print)(obj, p, p_max_size);
-    } else if (obj->callbacks.iftest != nullptr) {
-      if ((*obj->callbacks.iftest)(obj) == 0) {
-        DBGP2("jumping");
-        if (obj->ifblock_next != nullptr) { obj = obj->ifblock_next; }
-      }
-    } else if (obj->callbacks.barval != nullptr) {
-      new_bar(obj, p, p_max_size, (*obj->callbacks.barval)(obj));
-    } else if (obj->callbacks.gaugeval != nullptr) {
-      new_gauge(obj, p, p_max_size, (*obj->callbacks.gaugeval)(obj));
+  text_builder out(p, p_max_size);
+  text_instruction *code = program->code.data();
+  const size_t code_size = program->code.size();
+  size_t pc = 0;
+  while (pc < code_size && out.room() > 0) {
+    text_instruction &insn = code[pc++];
+    struct text_object *obj = insn.obj;
+    char *pos = out.end();
+    const unsigned int room = out.room();
+    size_t a = 0;
+
+    switch (insn.op) {
+      case text_op::PRINT:
+        if (insn.cache == NO_TEXT_CACHE) {
+          a = print_object(obj, pos, room);
+        } else {
+          a = print_from_cache(obj, program->caches[insn.cache], pos, room);
+        }
+        break;
+      case text_op::IFTEST:
+        if ((*obj->callbacks.iftest)(obj) == 0) {
+          DBGP2("jumping");
+          pc = insn.jump;
+        }
+        break;
+      case text_op::BARVAL:
+        new_bar(obj, pos, room, (*obj->callbacks.barval)(obj));
+        a = strnlen(pos, room);
+        break;
+      case text_op::GAUGEVAL:
+        new_gauge(obj, pos, room, (*obj->callbacks.gaugeval)(obj));
+        a = strnlen(pos, room);
+        break;
+      case text_op::GRAPHVAL:
 #ifdef BUILD_GUI
-    } else if (obj->callbacks.graphval != nullptr) {
-      new_graph(obj, p, p_max_size, (*obj->callbacks.graphval)(obj));
+        new_graph(obj, pos, room, (*obj->callbacks.graphval)(obj));
+        a = strnlen(pos, room);
 #endif /* BUILD_GUI */
-    } else if (obj->callbacks.percentage != nullptr) {
-      percent_print(p, p_max_size, (*obj->callbacks.percentage)(obj));
+        break;
+      case text_op::PERCENTAGE:
+        a = written_length(
+            percent_print(pos, room, (*obj->callbacks.percentage)(obj)), room);
+        break;
     }
 
-    a = strlen(p);
 #ifdef BUILD_ICONV
-    iconv_convert(&a, buff_in, p, p_max_size);
+    iconv_convert(&a, buff_in, pos, room);
 #endif /* BUILD_ICONV */
-    p += a;
-    p_max_size -= a;
-    (*p) = 0;
-
-    obj = obj->next;
+    out.commit(a);
   }
 #ifdef BUILD_GUI
   /* load any new fonts we may have had */
   load_fonts(utf8_mode.get(*state));
 #endif /* BUILD_GUI */
-#ifdef BUILD_ICONV
-  delete[] buff_in;
-#endif /* BUILD_ICONV */
+}
+
+/* Text evaluated by one caller, kept parsed between calls so that its
+ * objects' callback handles, graph history and print caches live on. */
+struct evaluated_text {
+  std::string text;
+  struct text_object root {};
+};
+
+void free_evaluated_text(struct evaluated_text **cache) {
+  if (*cache == nullptr) { return; }
+  free_text_objects(&(*cache)->root);
+  delete *cache;
+  *cache = nullptr;
 }
 
 void evaluate(const char *text, char *p, int p_max_size) {
-  struct text_object subroot {};
+  struct text_object root {};
 
   /**
    * Consider expressions like: ${execp echo '${execp echo hi}'}
    * These would require run extract_variable_text_internal() before
    * callbacks and generate_text_internal() after callbacks.
    */
-  extract_variable_text_internal(&subroot, text);
-  generate_text_internal(p, p_max_size, subroot);
+  extract_variable_text_internal(&root, text);
+  generate_text_internal(p, p_max_size, root);
   DBGP2("evaluated '%s' to '%s'", text, p);
+  free_text_objects(&root);
+}
 
-  free_text_objects(&subroot);
+void evaluate(const char *text, char *p, int p_max_size,
+              struct evaluated_text **cache) {
+  if (*cache != nullptr && (*cache)->text != text) {
+    free_evaluated_text(cache);
+  }
+  if (*cache == nullptr) {
+    *cache = new evaluated_text;
+    (*cache)->text = text;
+    extract_variable_text_internal(&(*cache)->root, text);
+  }
+  generate_text_internal(p, p_max_size, (*cache)->root);
+  DBGP2("evaluated '%s' to '%s'", text, p);
 }
 
 double current_update_time, next_update_time, last_update_time;
 
+/* copy in to out, starting a new line after every width characters, with
+ * a UTF-8 sequence counting as one character. Returns false if out is too
+ * small to hold all the line breaks, those which don't fit are left out. */
+bool wrap_text(const char *in, char *out, size_t out_size, unsigned int width) {
+  size_t len = strlen(in);
+  size_t o = 0;
+  unsigned int column = 0;
+  bool fits = true;
+
+  if (out_size == 0) { return false; }
+
+  for (size_t i = 0; i < len && o + 1 < out_size; i++) {
+    char c = in[i];
+
+    if (c == '\n') {
+      column = 0;
+    } else if ((c & 0xC0) != 0x80) { /* not a UTF-8 continuation byte */
+      if (column == width) {
+        /* room for the break, the rest of in and the '\0' */
+        if (o + 1 + (len - i) < out_size) {
+          out[o++] = '\n';
+          column = 0;
+        } else {
+          fits = false;
+        }
+      }
+      column++;
+    }
+    out[o++] = c;
+  }
+  out[o] = '\0';
+  return fits;
+}
+
 static void generate_text() {
   char *p;
-  unsigned int i, j, k;
   special_count = 0;
 
+  /* what was counted since the last update belongs to the previous frame */
+  conky::alloc_frame_done();
+
+  /* setting values replaced an update ago are no longer being read */
+  conky::reclaim_config_snapshots();
+
   current_update_time = get_time();
 
-  /* clears netstats info, calls conky::run_all_callbacks(), and changes
-   * some info.mem entries */
-  update_stuff();
+  /* calls conky::run_all_callbacks(), and changes some info.mem entries */
+  {
+    conky::alloc_phase_scope phase(conky::alloc_phase::UPDATE);
+    update_stuff();
+  }
+  conky::alloc_phase_scope phase(conky::alloc_phase::GENERATE);
 
   /* populate the text buffer; generate_text_internal() iterates through
    * global_root_object (an instance of the text_object struct) and calls
@@ -707,29 +860,13 @@ static void generate_text() {
 
   generate_text_internal(p, max_user_text.get(*state), global_root_object);
   unsigned int mw = max_text_width.get(*state);
-  unsigned int tbs = text_buffer_size.get(*state);
   if (mw > 0) {
-    for (i = 0, j = 0; p[i] != 0; i++) {
-      if (p[i] == '\n') {
-        j = 0;
-      } else if (j == mw) {
-        k = i + strlen(p + i) + 1;
-        if (k < tbs) {
-          while (k != i) {
-            p[k] = p[k - 1];
-            k--;
-          }
-          p[k] = '\n';
-          j = 0;
-        } else {
-          NORM_ERR(
-              "The end of the text_buffer is reached, increase "
-              "\"text_buffer_size\"");
-        }
-      } else {
-        j++;
-      }
+    if (!wrap_text(text_buffer, wrap_buffer, max_user_text.get(*state), mw)) {
+      NORM_ERR(
+          "The end of the text_buffer is reached, increase "
+          "\"max_user_text\"");
     }
+    std::swap(text_buffer, wrap_buffer);
   }
 
   if (stuff_in_uppercase.get(*state)) {
@@ -771,9 +908,21 @@ int get_border_total() {
 
 void remove_first_char(char *s) { memmove(s, s + 1, strlen(s)); }
 
+/* copy at most n bytes of s into buf, growing it as needed, like strndup() */
+static char *copy_to_scratch(std::vector<char> &buf, const char *s,
+                             size_t n) {
+  size_t len = strnlen(s, n);
+  if (buf.size() < len + 1) { buf.resize(len + 1); }
+  memcpy(buf.data(), s, len);
+  buf[len] = '\0';
+  return buf.data();
+}
+
 static int get_string_width_special(char *s, int special_index) {
+  /* working copies of s, kept to not allocate on every measurement */
+  static std::vector<char> scratch, font_scratch;
   char *p, *final;
-  special_node *current = specials;
+  special_node *current;
   int width = 0;
   long i;
 
@@ -783,10 +932,10 @@ static int get_string_width_special(char *s, int special_index) {
     return strlen(s);
   }
 
-  p = strndup(s, text_buffer_size.get(*state));
+  p = copy_to_scratch(scratch, s, text_buffer_size.get(*state));
   final = p;
 
-  for (i = 0; i <= special_index; i++) { current = current->next; }
+  current = specials.data() + special_index + 1;
 
   while (*p != 0) {
     if (*p == SPECIAL_CHAR) {
@@ -804,14 +953,15 @@ static int get_string_width_special(char *s, int special_index) {
       if (current->type == text_node_t::FONT) {
         // put all following text until the next fontchange/stringend in
         // influenced_by_font but do not include specials
-        char *influenced_by_font = strdup(p);
+        char *influenced_by_font =
+            copy_to_scratch(font_scratch, p, strlen(p));
         special_node *current_after_font = current;
         // influenced_by_font gets special chars removed, so after this loop i
         // counts the number of letters (not special chars) influenced by font
         for (i = 0; influenced_by_font[i] != 0; i++) {
           if (influenced_by_font[i] == SPECIAL_CHAR) {
             // remove specials and stop at fontchange
-            current_after_font = current_after_font->next;
+            current_after_font++;
             if (current_after_font->type == text_node_t::FONT) {
               influenced_by_font[i] = 0;
               break;
@@ -824,7 +974,6 @@ static int get_string_width_special(char *s, int special_index) {
         selected_font = current->font_added;
         width += calc_text_width(influenced_by_font);
         selected_font = orig_font;
-        free(influenced_by_font);
         // make sure the chars counted in the new font are not again counted
         // in the old font
         int specials_skipped = 0;
@@ -838,13 +987,12 @@ static int get_string_width_special(char *s, int special_index) {
           }
         }
       }
-      current = current->next;
+      current++;
     } else {
       p++;
     }
   }
   if (strlen(final) > 1) { width += calc_text_width(final); }
-  free(final);
   return width;
 }
 
@@ -852,6 +1000,7 @@ static int text_size_updater(char *s, int special_index);
 
 int last_font_height;
 void update_text_area() {
+  conky::alloc_phase_scope phase(conky::alloc_phase::LAYOUT);
   conky::vec2i xy;
 
   if (display_output() == nullptr || !display_output()->graphical()) { return; }
@@ -945,9 +1094,7 @@ int get_saved_font_h(int i) { return saved_fonts_h[i]; }
 static int text_size_updater(char *s, int special_index) {
   int w = 0;
   char *p;
-  special_node *current = specials;
-
-  for (int i = 0; i < special_index; i++) { current = current->next; }
+  special_node *current = specials.data() + special_index;
 
   if (display_output() == nullptr || !display_output()->graphical()) {
     return 0;
@@ -988,7 +1135,7 @@ static int text_size_updater(char *s, int special_index) {
       }
 
       special_index++;
-      current = current->next;
+      current++;
       s = p + 1;
     }
     p++;
@@ -1010,7 +1157,7 @@ static inline void set_foreground_color(Colour c) {
   for (auto output : display_outputs()) output->set_foreground_color(c);
 }
 
-static inline void draw_graph_bars(special_node *current, std::unique_ptr<Colour[]>& tmpcolour,
+static inline void draw_graph_bars(special_node *current, const Colour *tmpcolour,
                             conky::vec2i& text_offset, int i, int &j, int w,
                             int colour_idx, int cur_x, int by, int h) {
   double graphheight = current->graph[j] * (h - 1) / current->scale;
@@ -1184,8 +1331,7 @@ int draw_each_line_inner(char *s, int special_index, int last_special_applied) {
         s = p + 1;
       }
       /* draw special */
-      special_node *current = specials;
-      for (int i = 0; i < special_index; i++) { current = current->next; }
+      special_node *current = &specials[special_index];
       switch (current->type) {
 #ifdef BUILD_GUI
         case text_node_t::HORIZONTAL_LINE:
@@ -1333,24 +1479,26 @@ int draw_each_line_inner(char *s, int special_index, int last_special_applied) {
 
             /* in case we don't have a graph yet */
             if (current->graph != nullptr) {
-              std::unique_ptr<Colour[]> tmpcolour;
+              /* gradient colours, reused by every graph of every update */
+              static std::vector<Colour> tmpcolour;
 
               if (current->colours_set) {
-                auto factory = create_gradient_factory(w, current->last_colour,
-                                                       current->first_colour);
-                tmpcolour = factory->create_gradient();
-                delete factory;
+                if (tmpcolour.size() < static_cast<size_t>(w)) {
+                  tmpcolour.resize(w);
+                }
+                fill_gradient(tmpcolour.data(), w, current->last_colour,
+                              current->first_colour);
               }
               colour_idx = 0;
               if(current->invertx){
                 for (i = 0; i <= w - 2; i++) {
-                  draw_graph_bars(current, tmpcolour, text_offset,
+                  draw_graph_bars(current, tmpcolour.data(), text_offset,
                   i, j, w, colour_idx, cur_x, by, h);
                 }
               }
               else{
                 for (i = w - 2; i > -1; i--) {
-                  draw_graph_bars(current, tmpcolour, text_offset,
+                  draw_graph_bars(current, tmpcolour.data(), text_offset,
                   i, j, w, colour_idx, cur_x, by, h);
                 }
               }
@@ -1630,6 +1778,7 @@ static void draw_text() {
 }
 
 void draw_stuff() {
+  conky::alloc_phase_scope phase(conky::alloc_phase::DRAW);
   for (auto output : display_outputs()) output->begin_draw_stuff();
 
 #ifdef BUILD_GUI
@@ -1938,6 +2087,7 @@ void main_loop() {
       g_sigusr2_pending = 0;
       // refresh view;
       NORM_ERR("received SIGUSR2. refreshing.");
+      conky::dump_callback_reports(stderr);
       update_text();
       draw_stuff();
       for (auto output : display_outputs()) output->flush();
@@ -2029,13 +2179,12 @@ static void reload_config() {
   initialisation(argc_copy, argv_copy);
 }
 
-void free_specials(special_node *&current) {
-  if (current != nullptr) {
-    free_specials(current->next);
-    if (current->type == text_node_t::GRAPH) { free(current->graph); }
-    delete current;
-    current = nullptr;
+void free_specials(std::vector<special_node> &nodes) {
+  for (auto &node : nodes) {
+    if (node.type == text_node_t::GRAPH) { free(node.graph); }
   }
+  nodes.clear();
+  special_count = 0;
 
   clear_stored_graphs();
 }
@@ -2062,6 +2211,7 @@ void clean_up(void) {
   delete_block_and_zero(tmpstring1);
   delete_block_and_zero(tmpstring2);
   delete_block_and_zero(text_buffer);
+  delete_block_and_zero(wrap_buffer);
   free_and_zero(global_text);
 
 #ifdef BUILD_PORT_MONITORS
@@ -2432,12 +2582,7 @@ void initialisation(int argc, char **argv) {
     }
   }
 
-  text_buffer = new char[max_user_text.get(*state)];
-  memset(text_buffer, 0, max_user_text.get(*state));
-  tmpstring1 = new char[text_buffer_size.get(*state)];
-  memset(tmpstring1, 0, text_buffer_size.get(*state));
-  tmpstring2 = new char[text_buffer_size.get(*state)];
-  memset(tmpstring2, 0, text_buffer_size.get(*state));
+  allocate_text_buffers();
 
   if (!conky::initialize_display_outputs()) {
     CRIT_ERR("initialize_display_outputs() failed.");
@@ -204,6 +204,8 @@ struct system {
 
 }  // namespace conky::info
 
+#define MAX_SP 100  // most processes a top list can show
+
 struct information {
   unsigned int mask;
 
@@ -238,11 +240,11 @@ struct information {
   struct xmms2_s xmms2;
 #endif /* BUILD_XMMS2 */
   struct usr_info users;
-  struct process *cpu[10];
-  struct process *memu[10];
-  struct process *time[10];
+  struct process *cpu[MAX_SP];
+  struct process *memu[MAX_SP];
+  struct process *time[MAX_SP];
 #ifdef BUILD_IOSTATS
-  struct process *io[10];
+  struct process *io[MAX_SP];
 #endif /* BUILD_IOSTATS */
   struct process *first_process;
   unsigned long looped;
@@ -348,6 +350,7 @@ extern double current_update_time, last_update_time;
 
 extern conky::range_config_setting<double> update_interval;
 extern conky::range_config_setting<double> update_interval_on_battery;
+extern conky::range_config_setting<double> update_deadline;
 double active_update_interval();
 
 extern conky::simple_config_setting<bool> show_graph_scale;
@@ -394,6 +397,16 @@ inline bool wm_is(conky::info::window_manager single) {
  * evaluates 'text' and places the result in 'p' of max length 'p_max_size'
  */
 void evaluate(const char *text, char *p, int p_max_size);
+/* the same, but the parsed text is kept in *cache, which belongs to the
+ * caller (e.g. text_object::evaluated), and is parsed again only when text
+ * changes; free it with free_evaluated_text() */
+struct evaluated_text;
+void evaluate(const char *text, char *p, int p_max_size,
+              struct evaluated_text **cache);
+void free_evaluated_text(struct evaluated_text **cache);
+
+/* wraps in into out for max_text_width, see conky.cc */
+bool wrap_text(const char *in, char *out, size_t out_size, unsigned int width);
 
 void parse_conky_vars(struct text_object *, const char *, char *, int);
 
@@ -401,11 +414,17 @@ void extract_object_args_to_sub(struct text_object *, const char *);
 
 void generate_text_internal(char *, int, struct text_object);
 
+/* makes text the text shown, as if it was the text section of the config */
+void load_text(const char *text);
+
+/* one frame: update_text() generates the text, update_text_area() lays it out
+ * and draw_stuff() draws it */
+void update_text();
 void update_text_area();
 void draw_stuff();
 
 int percent_print(char *, int, unsigned);
-void human_readable(long long, char *, int);
+int human_readable(long long, char *, int);
 
 #ifdef BUILD_GUI
 
@@ -27,11 +27,13 @@
  *
  */
 #include "algebra.h"
+#include <algorithm>
 #include <cctype>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
-#include <memory>
+#include <string>
+#include <vector>
 #include "config.h"
 #include "../conky.h"
 #include "../logging.h"
@@ -239,20 +241,347 @@ int compare(const char *expr) {
   return -2;
 }
 
+/* pre-compiled if_match expressions
+ *
+ * Rendering the whole argument and handing it to compare() on every update
+ * means re-finding the operator and re-classifying both operands each time,
+ * although only the output of the objects between the literal text can
+ * change. So the operator is located once in the literal text of the
+ * argument, with every object standing in as MATCH_OBJECT, and each side is
+ * turned into either a constant, a percentage object read as a number, or a
+ * list of parts which are rendered on update. Arguments whose operator is
+ * only known after rendering keep using compare().
+ */
+#define MATCH_OBJECT '\x01'
+
+/* a piece of a rendered operand: literal text, or an object if obj is set */
+struct match_part {
+  std::string text;
+  struct text_object *obj;
+};
+
+struct match_operand {
+  /* type of a constant or percentage operand, ARG_STRING for a quoted
+   * rendered one, or ARG_BAD if the rendered text is classified on update */
+  enum arg_type type = ARG_BAD;
+  long l = 0;
+  double d = 0.0;
+  std::string s;
+  struct text_object *percentage = nullptr;
+  std::vector<match_part> parts;
+};
+
+struct match_expression {
+  int mtype = -1; /* -1 if the argument is rendered and parsed by compare() */
+  struct match_operand lhs, rhs;
+};
+
+struct match_value {
+  enum arg_type type;
+  long l;
+  double d;
+  const char *s;
+};
+
+static bool is_literal_object(const struct text_object *obj) {
+  return obj->callbacks.print == &gen_print_obj_data_s &&
+         obj->data.s != nullptr;
+}
+
+/* objects generate_text_internal() prints as percent_print() of their value */
+static bool is_percentage_object(const struct text_object *obj) {
+  const struct obj_cb &cb = obj->callbacks;
+  return cb.percentage != nullptr && cb.print == nullptr &&
+         cb.print_len == nullptr && cb.iftest == nullptr &&
+         cb.barval == nullptr && cb.gaugeval == nullptr &&
+         cb.graphval == nullptr;
+}
+
+static bool is_printing_object(const struct text_object *obj) {
+  return obj->callbacks.print != nullptr || obj->callbacks.print_len != nullptr;
+}
+
+static bool is_silent_object(const struct text_object *obj) {
+  const struct obj_cb &cb = obj->callbacks;
+  return cb.print == nullptr && cb.print_len == nullptr &&
+         cb.iftest == nullptr && cb.barval == nullptr &&
+         cb.gaugeval == nullptr && cb.graphval == nullptr &&
+         cb.percentage == nullptr;
+}
+
+/* split text (with one MATCH_OBJECT per entry of objs) into parts */
+static void split_match_parts(const std::string &text,
+                              struct text_object *const *objs,
+                              std::vector<match_part> *parts) {
+  std::string literal;
+
+  for (char c : text) {
+    if (c != MATCH_OBJECT) {
+      literal += c;
+      continue;
+    }
+    if (!literal.empty()) { parts->push_back({literal, nullptr}); }
+    literal.clear();
+    parts->push_back({std::string(), *objs++});
+  }
+  if (!literal.empty()) { parts->push_back({literal, nullptr}); }
+}
+
+/* parse one side of the operator, returns false if it can't be typed */
+static bool parse_match_operand(const std::string &text,
+                                struct text_object *const *objs,
+                                struct match_operand *op) {
+  size_t first = text.find_first_not_of(' ');
+  size_t last = text.find_last_not_of(' ');
+
+  if (first == std::string::npos) { return false; }
+  std::string trimmed = text.substr(first, last - first + 1);
+
+  if (trimmed.find(MATCH_OBJECT) == std::string::npos) {
+    op->type = get_arg_type(text.c_str());
+    switch (op->type) {
+      case ARG_STRING: {
+        char *s = arg_to_string(text.c_str());
+        op->s = s;
+        free(s);
+        return true;
+      }
+      case ARG_LONG:
+        op->l = arg_to_long(text.c_str());
+        return true;
+      case ARG_DOUBLE:
+        op->d = arg_to_double(text.c_str());
+        return true;
+      case ARG_BAD:
+        break;
+    }
+    return false;
+  }
+
+  /* only blanks precede trimmed, so its first object is objs[0] */
+  if (trimmed.size() == 1 && is_percentage_object(objs[0])) {
+    op->type = ARG_LONG;
+    op->percentage = objs[0];
+    return true;
+  }
+
+  /* "...": a string whatever the objects inside render to, unless it holds
+   * further quotes, where arg_to_string() would stop at the first one */
+  if (trimmed.size() >= 2 && trimmed.front() == '"' &&
+      trimmed.find('"', 1) == trimmed.size() - 1) {
+    op->type = ARG_STRING;
+    split_match_parts(trimmed.substr(1, trimmed.size() - 2), objs, &op->parts);
+    return true;
+  }
+
+  op->type = ARG_BAD;
+  split_match_parts(text, objs, &op->parts);
+  return true;
+}
+
+struct match_expression *parse_match_expression(struct text_object *sub) {
+  auto *expr = new match_expression;
+  std::string text;
+  std::vector<struct text_object *> objs;
+  int idx;
+
+  for (struct text_object *obj = sub->next; obj != nullptr; obj = obj->next) {
+    if (is_literal_object(obj)) {
+      text += obj->data.s;
+    } else if (is_printing_object(obj) || is_percentage_object(obj)) {
+      text += MATCH_OBJECT;
+      objs.push_back(obj);
+    } else if (!is_silent_object(obj)) {
+      /* ifblocks and meters only make sense rendered */
+      return expr;
+    }
+  }
+
+  idx = find_match_op(text.c_str());
+  int mtype = get_match_type(text.c_str());
+  if (idx <= 0 || mtype == -1) { return expr; }
+
+  size_t oplen = (mtype == OP_LT || mtype == OP_GT) ? 1 : 2;
+  size_t lhs_objs = std::count(text.begin(), text.begin() + idx, MATCH_OBJECT);
+
+  if (!parse_match_operand(text.substr(0, idx), objs.data(), &expr->lhs) ||
+      !parse_match_operand(text.substr(idx + oplen), objs.data() + lhs_objs,
+                           &expr->rhs)) {
+    /* leave the error reporting to compare() */
+    expr->lhs = match_operand();
+    expr->rhs = match_operand();
+    return expr;
+  }
+  expr->mtype = mtype;
+  return expr;
+}
+
+void free_match_expression(struct match_expression *expr) { delete expr; }
+
+static size_t render_match_parts(const std::vector<match_part> &parts,
+                                 char *p, unsigned int p_max_size) {
+  size_t len = 0;
+
+  for (const auto &part : parts) {
+    if (len + 1 >= p_max_size) { break; }
+    unsigned int room = p_max_size - len;
+    if (part.obj == nullptr) {
+      size_t n = std::min<size_t>(part.text.size(), room - 1);
+      memcpy(p + len, part.text.data(), n);
+      len += n;
+    } else if (is_percentage_object(part.obj)) {
+      len += written_length(
+          percent_print(p + len, room, (*part.obj->callbacks.percentage)(
+                                           part.obj)),
+          room);
+    } else {
+      len += print_object(part.obj, p + len, room);
+    }
+  }
+  p[len] = '\0';
+  return len;
+}
+
+/* get the value of op, rendering into p if needed */
+static void get_match_value(const struct match_operand &op,
+                              struct match_value *v, char *p,
+                              unsigned int p_max_size) {
+  size_t len;
+
+  v->type = op.type;
+  if (op.parts.empty()) {
+    v->l = op.percentage != nullptr ? (*op.percentage->callbacks.percentage)(
+                                          op.percentage)
+                                    : op.l;
+    v->d = op.d;
+    v->s = op.s.c_str();
+    return;
+  }
+
+  len = render_match_parts(op.parts, p, p_max_size);
+  v->s = p;
+  if (op.type == ARG_STRING) { return; }
+
+  v->type = len > 0 ? get_arg_type(p) : ARG_BAD;
+  switch (v->type) {
+    case ARG_STRING: {
+      /* unquote in place, like arg_to_string() */
+      char *start = strchr(p, '"') + 1;
+      char *end = strchr(start, '"');
+      if (end != nullptr) { *end = '\0'; }
+      v->s = start;
+      break;
+    }
+    case ARG_LONG:
+      v->l = arg_to_long(p);
+      break;
+    case ARG_DOUBLE:
+      v->d = arg_to_double(p);
+      break;
+    case ARG_BAD:
+      NORM_ERR("Bad argument: '%s'", p);
+      break;
+  }
+}
+
+static int compare_values(struct match_value *a, enum match_type mtype,
+                          struct match_value *b) {
+  if (a->type == ARG_BAD || b->type == ARG_BAD) { return -2; }
+  if (a->type == ARG_LONG && b->type == ARG_DOUBLE) {
+    a->type = ARG_DOUBLE;
+    a->d = a->l;
+  }
+  if (a->type == ARG_DOUBLE && b->type == ARG_LONG) {
+    b->type = ARG_DOUBLE;
+    b->d = b->l;
+  }
+  if (a->type != b->type) {
+    NORM_ERR("trying to compare args of different type");
+    return -2;
+  }
+  switch (a->type) {
+    case ARG_STRING:
+      return scompare(a->s, mtype, b->s);
+    case ARG_LONG:
+      return lcompare(a->l, mtype, b->l);
+    case ARG_DOUBLE:
+      return dcompare(a->d, mtype, b->d);
+    case ARG_BAD: /* make_gcc_happy() */;
+  }
+  return -2;
+}
+
+/* Scratch space for rendering operands, shared by all expressions a thread
+ * evaluates. Rendering may evaluate expressions nested in the operands, so
+ * each level of nesting has its own. */
+namespace {
+class match_scratch {
+  static thread_local std::vector<std::vector<char>> levels;
+  static thread_local size_t depth;
+  char *buf = nullptr;
+
+ public:
+  explicit match_scratch(size_t size) {
+    if (size == 0) { return; }
+    if (levels.size() <= depth) { levels.resize(depth + 1); }
+    std::vector<char> &level = levels[depth++];
+    if (level.size() < size) { level.resize(size); }
+    buf = level.data();
+  }
+  ~match_scratch() {
+    if (buf != nullptr) { --depth; }
+  }
+  match_scratch(const match_scratch &) = delete;
+  match_scratch &operator=(const match_scratch &) = delete;
+
+  char *get() const { return buf; }
+};
+thread_local std::vector<std::vector<char>> match_scratch::levels;
+thread_local size_t match_scratch::depth = 0;
+}  // namespace
+
+int evaluate_match_expression(struct match_expression *expr,
+                              struct text_object *sub, unsigned int size) {
+  struct match_value a, b;
+
+  if (size < 2) { return -2; }
+
+  if (expr->mtype == -1) {
+    match_scratch scratch(size);
+    char *buf = scratch.get();
+    generate_text_internal(buf, size, *sub);
+    DBGP("parsed arg into '%s'", buf);
+    return compare(buf);
+  }
+
+  /* only operands which are rendered need room, as long as the whole
+   * argument could be */
+  size_t lhs_size = expr->lhs.parts.empty() ? 0 : size;
+  size_t rhs_size = expr->rhs.parts.empty() ? 0 : size;
+  match_scratch scratch(lhs_size + rhs_size);
+  char *buf = scratch.get();
+
+  get_match_value(expr->lhs, &a, buf, size);
+  get_match_value(expr->rhs, &b, buf + lhs_size, size);
+  return compare_values(&a, static_cast<enum match_type>(expr->mtype), &b);
+}
+
 int check_if_match(struct text_object *obj) {
-  std::unique_ptr<char[]> expression(new char[max_user_text.get(*state)]);
+  auto *expr = static_cast<struct match_expression *>(obj->data.opaque);
   int val;
   int result = 1;
 
-  generate_text_internal(expression.get(), max_user_text.get(*state),
-                         *obj->sub);
-  DBGP("parsed arg into '%s'", expression.get());
-
-  val = compare(expression.get());
+  val = evaluate_match_expression(expr, obj->sub, max_user_text.get(*state));
   if (val == -2) {
-    NORM_ERR("compare failed for expression '%s'", expression.get());
+    NORM_ERR("compare failed for if_match on line %ld", obj->line);
   } else if (val == 0) {
     result = 0;
   }
   return result;
 }
+
+void free_if_match(struct text_object *obj) {
+  free_match_expression(static_cast<struct match_expression *>(
+      obj->data.opaque));
+  obj->data.opaque = nullptr;
+}
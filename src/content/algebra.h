@@ -47,6 +47,16 @@ enum arg_type {
 
 int compare(const char *);
 int check_if_match(struct text_object *);
+void free_if_match(struct text_object *);
+
+/* if_match argument (the objects of sub) parsed once when the config is
+ * loaded. evaluate_match_expression() returns like compare(), size being the
+ * longest text an operand is rendered to. */
+struct match_expression;
+struct match_expression *parse_match_expression(struct text_object *sub);
+int evaluate_match_expression(struct match_expression *,
+                              struct text_object *sub, unsigned int size);
+void free_match_expression(struct match_expression *);
 int get_match_type(const char *expr);
 int find_match_op(const char *expr);
 
@@ -64,7 +64,11 @@ Colour gradient_factory::convert_to_rgb(long *const array) {
 
 gradient_factory::colour_array gradient_factory::create_gradient() {
   colour_array colours(new Colour[width]);
+  create_gradient(colours.get());
+  return colours;
+}
 
+void gradient_factory::create_gradient(Colour *colours) {
   long first_converted[3];
   long last_converted[3];
   long diff[3], delta[3];
@@ -84,8 +88,6 @@ gradient_factory::colour_array gradient_factory::create_gradient() {
     for (int k = 0; k < 3; k++) { first_converted[k] += delta[k]; }
     colours[i] = convert_to_rgb(first_converted);
   }
-
-  return colours;
 }
 
 long gradient_factory::get_hue(long *const rgb, long chroma, long value) {
@@ -53,6 +53,8 @@ class gradient_factory {
   virtual ~gradient_factory() {}
 
   colour_array create_gradient();
+  /* same as above, into caller-provided storage for width colours */
+  void create_gradient(Colour *colours);
 
   virtual void convert_from_scaled_rgb(long *const scaled, long *target) = 0;
   virtual void convert_to_scaled_rgb(long *const target, long *scaled) = 0;
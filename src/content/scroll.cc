@@ -76,14 +76,17 @@ inline bool scroll_check_skip_byte(char c) {
 #define SCROLL_WAIT 3
 
 struct scroll_data {
-  char *text;
-  unsigned int show;
-  unsigned int step;
-  int wait;
-  unsigned int wait_arg;
-  signed int start;
+  char *text = nullptr;
+  unsigned int show = 0;
+  unsigned int step = 1;
+  int wait = 0;
+  unsigned int wait_arg = 0;
+  signed int start = 0;
   Colour resetcolor;
-  int direction;
+  int direction = SCROLL_LEFT;
+  /* generated text and colour-fixed output, kept between updates */
+  std::vector<char> buf;
+  std::vector<char> colored;
 };
 
 /**
@@ -135,12 +138,8 @@ void parse_scroll_arg(struct text_object *obj, const char *arg,
   int n1 = 0, n2 = 0;
   char dirarg[6];
 
-  sd = static_cast<struct scroll_data *>(malloc(sizeof(struct scroll_data)));
-  memset(sd, 0, sizeof(struct scroll_data));
-
+  sd = new scroll_data;
   sd->resetcolor = get_current_text_color();
-  sd->step = 1;
-  sd->direction = SCROLL_LEFT;
 
   if ((arg != nullptr) && sscanf(arg, "%5s %n", dirarg, &n1) == 1) {
     if (strcasecmp(dirarg, "right") == 0 || strcasecmp(dirarg, "r") == 0) {
@@ -155,7 +154,7 @@ void parse_scroll_arg(struct text_object *obj, const char *arg,
   }
 
   if ((arg == nullptr) || sscanf(arg + n1, "%u %n", &sd->show, &n2) <= 0) {
-    free(sd);
+    delete sd;
 #ifdef BUILD_GUI
     free(obj->next);
 #endif
@@ -207,10 +206,14 @@ void print_scroll(struct text_object *obj, char *p, unsigned int p_max_size) {
   auto *sd = static_cast<struct scroll_data *>(obj->data.opaque);
   unsigned int j, colorchanges = 0, frontcolorchanges = 0,
                   visibcolorchanges = 0;
-  std::vector<char> buf(max_user_text.get(*state), static_cast<char>(0));
 
   if (sd == nullptr) { return; }
 
+  std::vector<char> &buf = sd->buf;
+  if (buf.size() != static_cast<size_t>(max_user_text.get(*state))) {
+    buf.assign(max_user_text.get(*state), 0);
+  }
+
   generate_text_internal(&(buf[0]), max_user_text.get(*state), *obj->sub);
   for (j = 0; buf[j] != 0; j++) {
     if (buf[j] == '\n') {
@@ -270,8 +273,11 @@ void print_scroll(struct text_object *obj, char *p, unsigned int p_max_size) {
     if (buf[j] == SPECIAL_CHAR) { frontcolorchanges++; }
   }
 
-  int pwithcolors_len = strlen(p) + 4 + colorchanges - visibcolorchanges;
-  char *pwithcolors = new char[pwithcolors_len];
+  size_t pwithcolors_len = strlen(p) + 4 + colorchanges - visibcolorchanges;
+  if (sd->colored.size() < pwithcolors_len) {
+    sd->colored.resize(pwithcolors_len);
+  }
+  char *pwithcolors = sd->colored.data();
 
   for (j = 0; j < frontcolorchanges; j++) { pwithcolors[j] = SPECIAL_CHAR; }
   pwithcolors[j] = 0;
@@ -284,7 +290,6 @@ void print_scroll(struct text_object *obj, char *p, unsigned int p_max_size) {
   }
   pwithcolors[strend + j] = 0;
   strncpy(p, pwithcolors, p_max_size);
-  delete[] pwithcolors;
 
   // scroll
   if (sd->direction == SCROLL_LEFT) {
@@ -337,5 +342,6 @@ void free_scroll(struct text_object *obj) {
   free_and_zero(sd->text);
   free_text_objects(obj->sub);
   free_and_zero(obj->sub);
-  free_and_zero(obj->data.opaque);
+  delete sd;
+  obj->data.opaque = nullptr;
 }
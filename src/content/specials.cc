@@ -46,7 +46,7 @@
 #include "../output/display-output.hh"
 #include "colours.hh"
 
-struct special_node *specials = nullptr;
+std::vector<special_node> specials;
 
 int special_count;
 int graph_count = 0;
@@ -420,33 +420,24 @@ bool scan_graph(struct text_object *obj, const char *argstr, double defscale, ch
  * Printing various special text objects
  */
 
-struct special_node *new_special_t_node() {
-  auto *newnode = new special_node;
-
-  memset(newnode, 0, sizeof *newnode);
-  return newnode;
-}
-
 /**
- * expands the current global linked list specials to special_count elements
+ * takes the next node of the global vector specials, growing it if this
+ * frame has more specials than any before
  *
  * increases special_count
  * @param[out] buf is set to "\x01\x00" not sure why ???
  * @param[in]  t   special type enum, e.g. alignc, alignr, fg, bg, ...
- * @return pointer to the newly inserted special of type t
+ * @return pointer to the special of type t, valid until the next call
  **/
 struct special_node *new_special(char *buf, text_node_t t) {
   special_node *current;
 
   buf[0] = SPECIAL_CHAR;
   buf[1] = '\0';
-  if (specials == nullptr) { specials = new_special_t_node(); }
-  current = specials;
-  /* allocate special_count linked list elements */
-  for (int i = 0; i < special_count; i++) {
-    if (current->next == nullptr) { current->next = new_special_t_node(); }
-    current = current->next;
+  if (static_cast<size_t>(special_count) == specials.size()) {
+    specials.emplace_back();
   }
+  current = &specials[special_count];
   current->type = t;
   special_count++;
   return current;
@@ -576,13 +567,24 @@ static void graph_append(struct special_node *graph, double f, char showaslog) {
 
 void new_graph_in_shell(struct special_node *s, char *buf, int buf_max_size) {
   // Split config string on comma to avoid the hassle of dealing with the
-  // idiosyncrasies of multi-byte unicode on different platforms.
-  // TODO(brenden): Parse config string once and cache result.
-  const std::string ticks = console_graph_ticks.get(*state);
-  std::stringstream ss(ticks);
-  std::string tickitem;
-  std::vector<std::string> tickitems;
-  while (std::getline(ss, tickitem, ',')) { tickitems.push_back(tickitem); }
+  // idiosyncrasies of multi-byte unicode on different platforms. The result
+  // is kept until the settings change.
+  static std::vector<std::string> tickitems;
+  static uint64_t ticks_generation;
+  const uint64_t generation =
+      conky::priv::config_setting_base::current_generation();
+  if (tickitems.empty() || ticks_generation != generation) {
+    const std::string ticks = console_graph_ticks.get(*state);
+    std::stringstream ss(ticks);
+    std::string tickitem;
+    tickitems.clear();
+    while (std::getline(ss, tickitem, ',')) { tickitems.push_back(tickitem); }
+    ticks_generation = generation;
+  }
+  if (tickitems.empty()) {
+    *buf = '\0';
+    return;
+  }
 
   char *p = buf;
   char *buf_max = buf + (sizeof(char) * buf_max_size);
@@ -30,6 +30,7 @@
 #define _SPECIALS_H
 
 #include <tuple>
+#include <vector>
 #include "colours.hh"
 
 /* special stuff in text_buffer */
@@ -92,11 +93,15 @@ struct special_node {
   char invertx;
   char inverty;
   int minheight;
-  struct special_node *next;
 };
 
-/* direct access to the registered specials (FIXME: bad encapsulation) */
-extern struct special_node *specials;
+/* direct access to the registered specials (FIXME: bad encapsulation)
+ *
+ * The specials of a frame, in the order they appear in the text. Nodes are
+ * kept from one frame to the next (graphs keep their history in them), so
+ * specials only grows when a frame has more of them than any before and the
+ * special_count entries in use are reset by setting it to 0. */
+extern std::vector<special_node> specials;
 extern int special_count;
 
 /* forward declare to avoid mutual inclusion between specials.h and
@@ -29,6 +29,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <unordered_map>
 #include "config.h"
 #include "../conky.h"
 #include "../logging.h"
@@ -49,6 +50,15 @@ void gen_print_obj_data_s(struct text_object *obj, char *p,
   snprintf(p, p_max_size, "%s", obj->data.s);
 }
 
+size_t print_object(struct text_object *obj, char *p,
+                    unsigned int p_max_size) {
+  if (obj->callbacks.print_len != nullptr) {
+    return (*obj->callbacks.print_len)(obj, p, p_max_size);
+  }
+  (*obj->callbacks.print)(obj, p, p_max_size);
+  return strnlen(p, p_max_size);
+}
+
 /* text_object_list
  *
  * this list is special. it looks like this:
@@ -185,3 +195,127 @@ void obj_be_plain_text(struct text_object *obj, const char *text) {
   obj->callbacks.print = &gen_print_obj_data_s;
   obj->callbacks.free = &gen_free_opaque;
 }
+
+/* text object compilation
+ *
+ * The program contains one instruction per object which has something to
+ * do in generate_text_internal(), with the same callback priority as the
+ * original list walk: print, iftest, barval, gaugeval, graphval,
+ * percentage. An ifblock_next pointer becomes the index of the instruction
+ * following its target, as the list walk continues after the else/endif it
+ * jumped to.
+ */
+static bool text_object_op(const struct text_object *obj, text_op *op) {
+  if (obj->callbacks.print != nullptr || obj->callbacks.print_len != nullptr) {
+    *op = text_op::PRINT;
+  } else if (obj->callbacks.iftest != nullptr) {
+    *op = text_op::IFTEST;
+  } else if (obj->callbacks.barval != nullptr) {
+    *op = text_op::BARVAL;
+  } else if (obj->callbacks.gaugeval != nullptr) {
+    *op = text_op::GAUGEVAL;
+#ifdef BUILD_GUI
+  } else if (obj->callbacks.graphval != nullptr) {
+    *op = text_op::GRAPHVAL;
+#endif /* BUILD_GUI */
+  } else if (obj->callbacks.percentage != nullptr) {
+    *op = text_op::PERCENTAGE;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void compile_text_objects(const struct text_object *root,
+                          struct text_program *prog) {
+  /* index of the instruction following each object */
+  std::unordered_map<const struct text_object *, uint32_t> resume_at;
+  text_op op;
+
+  prog->code.clear();
+  prog->caches.clear();
+  for (struct text_object *obj = root->next; obj != nullptr; obj = obj->next) {
+    if (text_object_op(obj, &op)) {
+      uint32_t arg = 0;
+      if (op == text_op::PRINT) {
+        arg = NO_TEXT_CACHE;
+        if (obj->cache_policy != text_cache_policy::NONE) {
+          arg = prog->caches.size();
+          prog->caches.push_back({false, 0, std::string()});
+        }
+      }
+      prog->code.push_back({op, {arg}, obj});
+    }
+    resume_at[obj] = prog->code.size();
+  }
+  prog->code.shrink_to_fit();
+  prog->caches.shrink_to_fit();
+
+  for (size_t i = 0; i < prog->code.size(); i++) {
+    text_instruction &insn = prog->code[i];
+
+    if (insn.op != text_op::IFTEST) { continue; }
+    auto target = resume_at.find(insn.obj->ifblock_next);
+    insn.jump = target != resume_at.end() ? target->second : i + 1;
+  }
+}
+
+/* output caching
+ *
+ * The generation identifies the data an object's output was rendered from:
+ * it is constant for STATIC objects, advances with every completed run of
+ * the object's callback for CALLBACK ones and is the object's own cache_key
+ * for KEY ones.
+ */
+static bool cache_generation(struct text_object *obj, uint64_t *generation) {
+  switch (obj->cache_policy) {
+    case text_cache_policy::STATIC:
+      *generation = 0;
+      return true;
+    case text_cache_policy::CALLBACK:
+      if (obj->exec_handle != nullptr) {
+        *generation = (*obj->exec_handle)->get_generation();
+        return true;
+      }
+      if (obj->cb_handle != nullptr) {
+        *generation = (*obj->cb_handle)->get_generation();
+        return true;
+      }
+      return false;
+    case text_cache_policy::KEY:
+      if (obj->callbacks.cache_key != nullptr) {
+        *generation = (*obj->callbacks.cache_key)(obj);
+        return true;
+      }
+      return false;
+    case text_cache_policy::NONE:
+      break;
+  }
+  return false;
+}
+
+size_t print_from_cache(struct text_object *obj, struct text_cache &cache,
+                        char *p, unsigned int p_max_size) {
+  uint64_t generation;
+
+  /* the generation has to be taken before printing, a newer result showing
+   * up meanwhile must not be stored under it */
+  if (!cache_generation(obj, &generation)) {
+    return print_object(obj, p, p_max_size);
+  }
+  if (cache.valid && cache.generation == generation &&
+      cache.output.size() < p_max_size) {
+    memcpy(p, cache.output.c_str(), cache.output.size() + 1);
+    return cache.output.size();
+  }
+
+  size_t len = print_object(obj, p, p_max_size);
+
+  /* truncated output would stay truncated once there is room again */
+  cache.valid = len + 1 < p_max_size;
+  if (cache.valid) {
+    cache.output.assign(p, len);
+    cache.generation = generation;
+  }
+  return len;
+}
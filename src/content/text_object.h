@@ -35,6 +35,8 @@
 #include "specials.h" /* enum special_types */
 
 #include <cstdint> /* uint8_t */
+#include <string>
+#include <vector>
 
 enum class draw_mode_t : uint32_t {
   BG = static_cast<uint32_t>(text_node_t::BG),
@@ -47,6 +49,12 @@ struct obj_cb {
   /* text object: print obj's output to p */
   void (*print)(struct text_object *obj, char *p, unsigned int p_max_size);
 
+  /* text object: like print, but return the number of bytes written to p
+   * (not counting the terminating '\0'), which spares the caller a strlen().
+   * Takes precedence over print. */
+  size_t (*print_len)(struct text_object *obj, char *p,
+                      unsigned int p_max_size);
+
   /* ifblock object: return zero to trigger jumping */
   int (*iftest)(struct text_object *obj);
 
@@ -63,6 +71,10 @@ struct obj_cb {
   /* percentage object: return value in range [0, 100] */
   uint8_t (*percentage)(struct text_object *obj);
 
+  /* objects with text_cache_policy::KEY: a value which changes whenever
+   * the output of print would */
+  uint64_t (*cache_key)(struct text_object *obj);
+
   /* free obj's data */
   void (*free)(struct text_object *obj);
 };
@@ -75,6 +87,17 @@ void gen_free_opaque(struct text_object *);
  * used for the else object */
 int gen_false_iftest(struct text_object *);
 
+/* number of bytes an snprintf()-like function returning n has actually
+ * written to a buffer of the given size, for print_len callbacks */
+inline size_t written_length(int n, unsigned int size) {
+  if (n <= 0 || size == 0) { return 0; }
+  return static_cast<unsigned int>(n) < size ? n : size - 1;
+}
+
+/* call print_len, or print followed by strlen() for objects which only
+ * have the latter */
+size_t print_object(struct text_object *obj, char *p, unsigned int p_max_size);
+
 /* generic nothing printer callback printing nothing
  * used for the endif object */
 void gen_print_nothing(struct text_object *, char *, unsigned int);
@@ -83,20 +106,63 @@ void gen_print_nothing(struct text_object *, char *, unsigned int);
  * used by the $text object */
 void gen_print_obj_data_s(struct text_object *, char *, unsigned int);
 
+/* Parts of struct information written or read by the legacy update
+ * functions. Update functions whose parts do not overlap run concurrently. */
+enum info_part : uint32_t {
+  INFO_UPTIME = 1 << 0,
+  INFO_MEM = 1 << 1,       /* mem*, swap*, buffers, cached */
+  INFO_CPU = 1 << 2,       /* cpu_count, cpu_usage, run_threads */
+  INFO_PROCS = 1 << 3,     /* procs */
+  INFO_RUN_PROCS = 1 << 4, /* run_procs */
+  INFO_THREADS = 1 << 5,   /* threads */
+  INFO_LOADAVG = 1 << 6,
+  INFO_TOP = 1 << 7, /* the process list and the top arrays */
+  INFO_NET = 1 << 8, /* netstats */
+  INFO_DISKIO = 1 << 9,
+  INFO_FS = 1 << 10,
+  INFO_USERS = 1 << 11,
+};
+
+/* the info_parts fn writes and reads, both 0 if it did not declare any, and
+ * whether it publishes what it collects instead of writing it in place */
+void legacy_cb_parts(int (*fn)(), uint32_t &writes, uint32_t &reads,
+                     bool &publishes);
+
 class legacy_cb : public conky::callback<void *, int (*)()> {
   typedef conky::callback<void *, int (*)()> Base;
 
+  const char *fn_name;
+
  protected:
   virtual void work() { std::get<0>(tuple)(); }
 
  public:
-  legacy_cb(uint32_t period, int (*fn)())
-      : Base(period, true, Base::Tuple(fn)) {}
+  legacy_cb(uint32_t period, int (*fn)(), const char *fn_name_)
+      : Base(period, true, Base::Tuple(fn)), fn_name(fn_name_) {
+    uint32_t writes, reads;
+    bool publishes;
+    legacy_cb_parts(fn, writes, reads, publishes);
+    declare_parts(writes, reads);
+    /* most update functions write the global info in place */
+    if (!publishes) { writes_shared_state(); }
+  }
+
+  virtual std::string name() const { return fn_name; }
 };
 
 typedef conky::callback_handle<legacy_cb> legacy_cb_handle;
 typedef conky::callback_handle<exec_cb> exec_cb_handle;
 
+/* Whether the output of an object's print callback may be reused on the next
+ * update instead of calling it again. */
+enum class text_cache_policy : uint8_t {
+  NONE,     /* print on every update (the default) */
+  STATIC,   /* output never changes once the object is constructed */
+  CALLBACK, /* output only changes when exec_handle (or cb_handle) finishes
+             * another run */
+  KEY,      /* output only changes with what callbacks.cache_key returns */
+};
+
 /**
  * This is where Conky collects information on the conky.text objects in your
  * config
@@ -124,6 +190,7 @@ struct text_object {
   long line;
   bool parse;  /* if true then data.s should still be parsed */
   bool thread; /* if true then data.s should be set by a separate thread */
+  text_cache_policy cache_policy;
 
   struct obj_cb callbacks;
 
@@ -132,6 +199,95 @@ struct text_object {
    * pointers so we can instantiate them later. */
   exec_cb_handle *exec_handle;
   legacy_cb_handle *cb_handle;
+
+  /* what the object's print callback last evaluated, see evaluate() */
+  struct evaluated_text *evaluated;
+
+  /* flattened form of the list when this object is a root, see
+   * compile_text_objects() */
+  struct text_program *program;
+};
+
+/* What generate_text_internal() does with an object, resolved once from its
+ * obj_cb when the list is compiled. Objects without any of these callbacks
+ * produce no instruction at all. */
+enum class text_op : uint8_t {
+  PRINT, /* print or print_len */
+  IFTEST,
+  BARVAL,
+  GAUGEVAL,
+  GRAPHVAL,
+  PERCENTAGE,
+};
+
+/* text_instruction::cache of a PRINT whose object has no cache_policy */
+constexpr uint32_t NO_TEXT_CACHE = UINT32_MAX;
+
+struct text_instruction {
+  text_op op;
+  union {
+    /* IFTEST: index of the instruction to continue with when the test
+     * fails (the one following the matching else/endif) */
+    uint32_t jump;
+    /* PRINT: index of the object's entry in text_program::caches, or
+     * NO_TEXT_CACHE */
+    uint32_t cache;
+  };
+  struct text_object *obj;
+};
+
+/* Last output of an object with a cache_policy, and the generation of its
+ * callback it was rendered from. */
+struct text_cache {
+  bool valid;
+  uint64_t generation;
+  std::string output;
+};
+
+/* A text object list lowered into a contiguous array of instructions, so
+ * that evaluating it is a loop over a vector rather than a walk of
+ * heap-scattered nodes. Only the PRINTs of objects with a cache_policy get
+ * an entry in caches. */
+struct text_program {
+  std::vector<text_instruction> code;
+  std::vector<text_cache> caches;
+};
+
+/* lower the list hanging off root into prog */
+void compile_text_objects(const struct text_object *root,
+                          struct text_program *prog);
+
+/* run the print callback of obj, or copy its previous output in cache to p
+ * if the object's cache_policy says that it is still current; returns the
+ * length of the output */
+size_t print_from_cache(struct text_object *obj, struct text_cache &cache,
+                        char *p, unsigned int p_max_size);
+
+/* The output buffer of generate_text_internal(). Objects write at end() and
+ * report how much they wrote with commit(), so the builder always knows the
+ * length of its contents and the room left without scanning the buffer. */
+class text_builder {
+  char *buf;
+  size_t size;
+  size_t len;
+
+ public:
+  text_builder(char *buf_, size_t size_) : buf(buf_), size(size_), len(0) {
+    if (size > 0) { buf[0] = '\0'; }
+  }
+
+  char *end() const { return buf + len; }
+
+  /* bytes available at end(), including the terminating '\0' */
+  size_t room() const { return size - len; }
+
+  size_t length() const { return len; }
+
+  /* account for n bytes just written at end() */
+  void commit(size_t n) {
+    len += n < room() ? n : room() - 1;
+    buf[len] = '\0';
+  }
 };
 
 /* text object list helpers */
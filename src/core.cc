@@ -30,6 +30,8 @@
 #include "config.h"
 
 /* local headers */
+#include "alloc-stats.hh"
+#include "callback-stats.hh"
 #include "content/algebra.h"
 #include "core.h"
 
@@ -364,13 +366,72 @@ void stock_parse_arg(struct text_object *obj, const char *arg) {
 }
 #endif /* BUILD_CURL */
 
-legacy_cb_handle *create_cb_handle(int (*fn)()) {
+/* What the update functions shared by all platforms write and read of
+ * struct information. The ones which publish keep what they collect to
+ * themselves until they are done, so an update may go on without them. */
+static const struct {
+  int (*fn)();
+  uint32_t writes;
+  uint32_t reads;
+  bool publishes;
+} legacy_cb_declarations[] = {
+    {&update_uptime, INFO_UPTIME, 0, false},
+    {&update_meminfo, INFO_MEM, 0, false},
+    {&update_cpu_usage, INFO_CPU, 0, false},
+    {&update_running_processes, INFO_CPU | INFO_RUN_PROCS, 0, false},
+    {&update_total_processes, INFO_PROCS, 0, false},
+    {&update_threads, INFO_THREADS, 0, false},
+    {&update_load_average, INFO_LOADAVG, 0, false},
+#ifdef __linux__
+    {&update_stat, INFO_CPU, 0, false},
+    /* memmax for the percentages, cpu_count for top_cpu_separate */
+    {&update_top, INFO_TOP | INFO_RUN_PROCS, INFO_MEM | INFO_CPU, false},
+#else
+    {&update_top, INFO_TOP | INFO_PROCS | INFO_RUN_PROCS, INFO_MEM | INFO_CPU,
+     false},
+#endif /* __linux__ */
+    {&update_net_stats, INFO_NET, 0, true},
+    {&update_diskio, INFO_DISKIO, 0, true},
+    {&update_fs_stats, INFO_FS, 0, true},
+    {&update_users, INFO_USERS, 0, false},
+};
+
+void legacy_cb_parts(int (*fn)(), uint32_t &writes, uint32_t &reads,
+                     bool &publishes) {
+  writes = reads = 0;
+  publishes = false;
+  for (const auto &d : legacy_cb_declarations) {
+    if (d.fn == fn) {
+      writes = d.writes;
+      reads = d.reads;
+      publishes = d.publishes;
+      return;
+    }
+  }
+}
+
+/* name is the spelling of fn in the source, for callback_reports() */
+legacy_cb_handle *create_cb_handle(int (*fn)(), const char *name) {
   if (fn != nullptr) {
-    return new legacy_cb_handle(conky::register_cb<legacy_cb>(1, fn));
+    if (*name == '&') { name++; }
+    return new legacy_cb_handle(conky::register_cb<legacy_cb>(1, fn, name));
   }
   { return nullptr; }
 }
 
+/* FNV-1a hash of a text object name. It is evaluated at compile time for
+ * every name in construct_text_object() to produce the case labels of the
+ * dispatch switch, so two names hashing to the same value is a compile error
+ * (duplicate case value) rather than a silent lookup bug. */
+static constexpr uint64_t text_object_name_hash(const char *s) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (; *s != '\0'; s++) {
+    hash ^= static_cast<unsigned char>(*s);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
 /* construct_text_object() creates a new text_object */
 struct text_object *construct_text_object(char *s, const char *arg, long line,
                                           void **ifblock_opaque,
@@ -381,9 +442,10 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
   obj->line = line;
 
 /* helper defines for internal use only */
-#define __OBJ_HEAD(a, n) \
-  if (!strcmp(s, #a)) {  \
-    obj->cb_handle = create_cb_handle(n);
+#define __OBJ_HEAD(a, n)                               \
+  case text_object_name_hash(#a): {                    \
+    if (strcmp(s, #a) != 0) { goto unknown_variable; } \
+    obj->cb_handle = create_cb_handle(n, #n);
 #define __OBJ_IF obj_be_ifblock_if(ifblock_opaque, obj)
 #define __OBJ_ARG(...)                              \
   if (!arg) {                                       \
@@ -402,15 +464,32 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
   {
 #define END \
   }         \
-  }         \
-  else
+  break;    \
+  }
 
 #ifdef BUILD_GUI
   if (s[0] == '#') {
     obj->data.l = parse_color(s).to_argb32();
     obj->callbacks.print = &new_fg;
-  } else
+    return obj;
+  }
 #endif /* BUILD_GUI */
+  /* we have four different types of top (top, top_mem, top_time and
+   * top_io). To avoid having almost-same code four times, we have this
+   * special handler. */
+  /* XXX: maybe fiddle them apart later, as print_top() does
+   * nothing else than just that, using an ugly switch(). */
+  if (strncmp(s, "top", 3) == EQUAL) {
+    if (parse_top_args(s, arg, obj) != 0) {
+      obj->cb_handle = create_cb_handle(update_top, "update_top");
+    } else {
+      free(obj);
+      return nullptr;
+    }
+    return obj;
+  }
+
+  switch (text_object_name_hash(s)) {
 #ifndef __OpenBSD__
     OBJ(acpitemp, nullptr)
   obj->data.i = open_acpi_temperature(arg);
@@ -841,12 +920,21 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
 #endif /* BUILD_GUI */
   END OBJ(conky_version, nullptr) obj_be_plain_text(obj, VERSION);
   END OBJ(conky_build_arch, nullptr) obj_be_plain_text(obj, BUILD_ARCH);
+#ifdef BUILD_ALLOC_STATS
+  END OBJ(conky_allocs, nullptr) scan_conky_allocs(obj, arg);
+  obj->callbacks.print = &print_conky_allocs;
+#endif /* BUILD_ALLOC_STATS */
+  END OBJ(cb_stats, nullptr) scan_cb_stats(obj, arg);
+  obj->callbacks.print = &print_cb_stats;
+  END OBJ_IF(if_stale, nullptr) scan_if_stale(obj, arg);
+  obj->callbacks.iftest = &check_if_stale;
+  obj->callbacks.free = &gen_free_opaque;
   END OBJ(downspeed, &update_net_stats)
       parse_net_stat_arg(obj, arg, free_at_crash);
-  obj->callbacks.print = &print_downspeed;
+  obj->callbacks.print_len = &print_downspeed;
   END OBJ(downspeedf, &update_net_stats)
       parse_net_stat_arg(obj, arg, free_at_crash);
-  obj->callbacks.print = &print_downspeedf;
+  obj->callbacks.print_len = &print_downspeedf;
 #ifdef BUILD_GUI
   END OBJ(downspeedgraph, &update_net_stats)
       parse_net_stat_graph_arg(obj, arg, free_at_crash);
@@ -922,6 +1010,7 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
   obj->parse = false;
   obj->thread = false;
   register_exec(obj);
+  obj->cache_policy = text_cache_policy::CALLBACK;
   obj->callbacks.print = &print_exec;
   obj->callbacks.free = &free_exec;
   END OBJ_ARG(execi, nullptr, "execi needs arguments: <interval> <command>")
@@ -929,6 +1018,7 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
   obj->parse = false;
   obj->thread = false;
   register_execi(obj);
+  obj->cache_policy = text_cache_policy::CALLBACK;
   obj->callbacks.print = &print_exec;
   obj->callbacks.free = &free_execi;
   END OBJ_ARG(execp, nullptr, "execp needs arguments: <command>")
@@ -991,6 +1081,7 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
   obj->parse = false;
   obj->thread = true;
   register_execi(obj);
+  obj->cache_policy = text_cache_policy::CALLBACK;
   obj->callbacks.print = &print_exec;
   obj->callbacks.free = &free_execi;
   END OBJ_ARG(texecpi, nullptr, "texecpi needs arguments: <interval> <command>")
@@ -1005,17 +1096,25 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
   END OBJ(fs_bar_free, &update_fs_stats) init_fs_bar(obj, arg);
   obj->callbacks.barval = &fs_free_barval;
   END OBJ(fs_free, &update_fs_stats) init_fs(obj, arg);
-  obj->callbacks.print = &print_fs_free;
+  obj->callbacks.print_len = &print_fs_free;
+  obj->cache_policy = text_cache_policy::KEY;
+  obj->callbacks.cache_key = &fs_cache_key;
   END OBJ(fs_used_perc, &update_fs_stats) init_fs(obj, arg);
   obj->callbacks.percentage = &fs_used_percentage;
   END OBJ(fs_free_perc, &update_fs_stats) init_fs(obj, arg);
   obj->callbacks.percentage = &fs_free_percentage;
   END OBJ(fs_size, &update_fs_stats) init_fs(obj, arg);
-  obj->callbacks.print = &print_fs_size;
+  obj->callbacks.print_len = &print_fs_size;
+  obj->cache_policy = text_cache_policy::KEY;
+  obj->callbacks.cache_key = &fs_cache_key;
   END OBJ(fs_type, &update_fs_stats) init_fs(obj, arg);
   obj->callbacks.print = &print_fs_type;
+  obj->cache_policy = text_cache_policy::KEY;
+  obj->callbacks.cache_key = &fs_cache_key;
   END OBJ(fs_used, &update_fs_stats) init_fs(obj, arg);
-  obj->callbacks.print = &print_fs_used;
+  obj->callbacks.print_len = &print_fs_used;
+  obj->cache_policy = text_cache_policy::KEY;
+  obj->callbacks.cache_key = &fs_cache_key;
 #ifdef BUILD_GUI
   END OBJ(hr, nullptr) obj->data.l =
       arg != nullptr ? strtol(arg, nullptr, 10) : 1;
@@ -1067,21 +1166,7 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
   obj->callbacks.print = &print_sysfs_sensor;
   obj->callbacks.free = &free_sysfs_sensor;
 #endif /* __linux__ */
-  END
-      /* we have four different types of top (top, top_mem, top_time and
-       * top_io). To avoid having almost-same code four times, we have this
-       * special handler. */
-      /* XXX: maybe fiddle them apart later, as print_top() does
-       * nothing else than just that, using an ugly switch(). */
-      if (strncmp(s, "top", 3) == EQUAL) {
-    if (parse_top_args(s, arg, obj) != 0) {
-      obj->cb_handle = create_cb_handle(update_top);
-    } else {
-      free(obj);
-      return nullptr;
-    }
-  }
-  else OBJ(addr, &update_net_stats) parse_net_stat_arg(obj, arg, free_at_crash);
+  END OBJ(addr, &update_net_stats) parse_net_stat_arg(obj, arg, free_at_crash);
   obj->callbacks.print = &print_addr;
   END
 #ifdef __linux__
@@ -1119,7 +1204,9 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
   END OBJ_IF_ARG(if_match, nullptr, "if_match needs arguments") obj->sub =
       static_cast<text_object *>(malloc(sizeof(struct text_object)));
   extract_variable_text_internal(obj->sub, arg);
+  obj->data.opaque = parse_match_expression(obj->sub);
   obj->callbacks.iftest = &check_if_match;
+  obj->callbacks.free = &free_if_match;
   END OBJ_IF_ARG(if_existing, nullptr, "if_existing needs an argument or two")
       obj->data.s = STRNDUP_ARG;
   obj->callbacks.iftest = &if_existing_iftest;
@@ -1155,7 +1242,9 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
   obj->callbacks.iftest = &if_running_iftest;
 #endif
   END OBJ(kernel, nullptr) obj->callbacks.print = &print_kernel;
+  obj->cache_policy = text_cache_policy::STATIC;
   END OBJ(machine, nullptr) obj->callbacks.print = &print_machine;
+  obj->cache_policy = text_cache_policy::STATIC;
 #if defined(__DragonFly__)
   END OBJ(version, 0) obj->callbacks.print = &print_version;
 #endif
@@ -1199,33 +1288,33 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
   obj->callbacks.print = &print_mboxscan;
   obj->callbacks.free = &free_mboxscan;
   END OBJ(mem, &update_meminfo) obj->data.s = STRNDUP_ARG;
-  obj->callbacks.print = &print_mem;
+  obj->callbacks.print_len = &print_mem;
   obj->callbacks.free = &gen_free_opaque;
   END OBJ(legacymem, &update_meminfo) obj->data.s = STRNDUP_ARG;
-  obj->callbacks.print = &print_legacymem;
+  obj->callbacks.print_len = &print_legacymem;
   obj->callbacks.free = &gen_free_opaque;
   END OBJ(memwithbuffers, &update_meminfo) obj->data.s = STRNDUP_ARG;
-  obj->callbacks.print = &print_memwithbuffers;
+  obj->callbacks.print_len = &print_memwithbuffers;
   obj->callbacks.free = &gen_free_opaque;
   END OBJ(memeasyfree, &update_meminfo) obj->data.s = STRNDUP_ARG;
-  obj->callbacks.print = &print_memeasyfree;
+  obj->callbacks.print_len = &print_memeasyfree;
   obj->callbacks.free = &gen_free_opaque;
   END OBJ(memfree, &update_meminfo) obj->data.s = STRNDUP_ARG;
-  obj->callbacks.print = &print_memfree;
+  obj->callbacks.print_len = &print_memfree;
   obj->callbacks.free = &gen_free_opaque;
   END OBJ(memmax, &update_meminfo) obj->data.s = STRNDUP_ARG;
-  obj->callbacks.print = &print_memmax;
+  obj->callbacks.print_len = &print_memmax;
   obj->callbacks.free = &gen_free_opaque;
   END OBJ(memperc, &update_meminfo) obj->callbacks.percentage = &mem_percentage;
 #ifdef __linux__
   END OBJ(memdirty, &update_meminfo) obj->data.s = STRNDUP_ARG;
-  obj->callbacks.print = &print_memdirty;
+  obj->callbacks.print_len = &print_memdirty;
   obj->callbacks.free = &gen_free_opaque;
   END OBJ(memavail, &update_meminfo) obj->data.s = STRNDUP_ARG;
-  obj->callbacks.print = &print_memavail;
+  obj->callbacks.print_len = &print_memavail;
   obj->callbacks.free = &gen_free_opaque;
   END OBJ(shmem, &update_meminfo) obj->data.s = STRNDUP_ARG;
-  obj->callbacks.print = &print_shmem;
+  obj->callbacks.print_len = &print_shmem;
   obj->callbacks.free = &gen_free_opaque;
   END OBJ(free_bufcache, &update_meminfo) obj->data.s = STRNDUP_ARG;
   obj->callbacks.print = &print_free_bufcache;
@@ -1236,16 +1325,16 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
 #endif /* __linux__ */
 #ifdef __FreeBSD__
   END OBJ(memactive, &update_meminfo) obj->data.s = STRNDUP_ARG;
-  obj->callbacks.print = &print_memactive;
+  obj->callbacks.print_len = &print_memactive;
   obj->callbacks.free = &gen_free_opaque;
   END OBJ(meminactive, &update_meminfo) obj->data.s = STRNDUP_ARG;
-  obj->callbacks.print = &print_meminactive;
+  obj->callbacks.print_len = &print_meminactive;
   obj->callbacks.free = &gen_free_opaque;
   END OBJ(memwired, &update_meminfo) obj->data.s = STRNDUP_ARG;
-  obj->callbacks.print = &print_memwired;
+  obj->callbacks.print_len = &print_memwired;
   obj->callbacks.free = &gen_free_opaque;
   END OBJ(memlaundry, &update_meminfo) obj->data.s = STRNDUP_ARG;
-  obj->callbacks.print = &print_memlaundry;
+  obj->callbacks.print_len = &print_memlaundry;
   obj->callbacks.free = &gen_free_opaque;
 #endif /* __FreeBSD__ */
 #ifdef BUILD_GUI
@@ -1290,7 +1379,9 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
   extract_variable_text_internal(obj->sub, arg);
   obj->callbacks.print = &print_format_time;
   END OBJ(nodename, nullptr) obj->callbacks.print = &print_nodename;
+  obj->cache_policy = text_cache_policy::STATIC;
   END OBJ(nodename_short, nullptr) obj->callbacks.print = &print_nodename_short;
+  obj->cache_policy = text_cache_policy::STATIC;
   END OBJ_ARG(cmdline_to_pid, nullptr,
               "cmdline_to_pid needs a command line as argument")
       scan_cmdline_to_pid_arg(obj, arg, free_at_crash);
@@ -1475,13 +1566,13 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
   obj->callbacks.print = &new_stippled_hr;
 #endif /* BUILD_GUI */
   END OBJ(swap, &update_meminfo) obj->data.s = STRNDUP_ARG;
-  obj->callbacks.print = &print_swap;
+  obj->callbacks.print_len = &print_swap;
   obj->callbacks.free = &gen_free_opaque;
   END OBJ(swapfree, &update_meminfo) obj->data.s = STRNDUP_ARG;
-  obj->callbacks.print = &print_swapfree;
+  obj->callbacks.print_len = &print_swapfree;
   obj->callbacks.free = &gen_free_opaque;
   END OBJ(swapmax, &update_meminfo) obj->data.s = STRNDUP_ARG;
-  obj->callbacks.print = &print_swapmax;
+  obj->callbacks.print_len = &print_swapmax;
   obj->callbacks.free = &gen_free_opaque;
   END OBJ(swapperc, &update_meminfo) obj->callbacks.percentage =
       &swap_percentage;
@@ -1489,11 +1580,12 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
   obj->callbacks.barval = &swap_barval;
   /* XXX: swapgraph, swapgauge? */
   END OBJ(sysname, nullptr) obj->callbacks.print = &print_sysname;
+  obj->cache_policy = text_cache_policy::STATIC;
   END OBJ(time, nullptr) scan_time(obj, arg);
-  obj->callbacks.print = &print_time;
+  obj->callbacks.print_len = &print_time;
   obj->callbacks.free = &free_time;
   END OBJ(utime, nullptr) scan_time(obj, arg);
-  obj->callbacks.print = &print_utime;
+  obj->callbacks.print_len = &print_utime;
   obj->callbacks.free = &free_time;
   END OBJ(tztime, nullptr) scan_tztime(obj, arg);
   obj->callbacks.print = &print_tztime;
@@ -1519,10 +1611,10 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
 #endif
   END OBJ(totaldown, &update_net_stats)
       parse_net_stat_arg(obj, arg, free_at_crash);
-  obj->callbacks.print = &print_totaldown;
+  obj->callbacks.print_len = &print_totaldown;
   END OBJ(totalup, &update_net_stats)
       parse_net_stat_arg(obj, arg, free_at_crash);
-  obj->callbacks.print = &print_totalup;
+  obj->callbacks.print_len = &print_totalup;
   END OBJ(updates, nullptr) obj->callbacks.print = &print_updates;
   END OBJ_IF(if_updatenr, nullptr) obj->data.i =
       arg != nullptr ? strtol(arg, nullptr, 10) : 0;
@@ -1541,10 +1633,10 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
   obj->callbacks.print = &new_alignc;
   END OBJ(upspeed, &update_net_stats)
       parse_net_stat_arg(obj, arg, free_at_crash);
-  obj->callbacks.print = &print_upspeed;
+  obj->callbacks.print_len = &print_upspeed;
   END OBJ(upspeedf, &update_net_stats)
       parse_net_stat_arg(obj, arg, free_at_crash);
-  obj->callbacks.print = &print_upspeedf;
+  obj->callbacks.print_len = &print_upspeedf;
 #ifdef BUILD_GUI
   END OBJ(upspeedgraph, &update_net_stats)
       parse_net_stat_graph_arg(obj, arg, free_at_crash);
@@ -1552,7 +1644,11 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
 #endif
   END OBJ(uptime_short, &update_uptime) obj->callbacks.print =
       &print_uptime_short;
+  obj->cache_policy = text_cache_policy::KEY;
+  obj->callbacks.cache_key = &uptime_short_cache_key;
   END OBJ(uptime, &update_uptime) obj->callbacks.print = &print_uptime;
+  obj->cache_policy = text_cache_policy::KEY;
+  obj->callbacks.cache_key = &uptime_cache_key;
 #if defined(__linux__)
   END OBJ(user_names, &update_users) obj->callbacks.print = &print_user_names;
   obj->callbacks.free = &free_user_names;
@@ -1689,15 +1785,6 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
   obj->callbacks.barval = &moc_barval;
 #endif /* BUILD_MOC */
 #ifdef BUILD_CMUS
-  END OBJ(cmus_state, 0) obj->callbacks.print = &print_cmus_state;
-  END OBJ(cmus_file, 0) obj->callbacks.print = &print_cmus_file;
-  END OBJ(cmus_title, 0) obj->callbacks.print = &print_cmus_title;
-  END OBJ(cmus_artist, 0) obj->callbacks.print = &print_cmus_artist;
-  END OBJ(cmus_album, 0) obj->callbacks.print = &print_cmus_album;
-  END OBJ(cmus_totaltime, 0) obj->callbacks.print = &print_cmus_totaltime;
-  END OBJ(cmus_timeleft, 0) obj->callbacks.print = &print_cmus_timeleft;
-  END OBJ(cmus_curtime, 0) obj->callbacks.print = &print_cmus_curtime;
-  END OBJ(cmus_random, 0) obj->callbacks.print = &print_cmus_random;
   END OBJ(cmus_state, 0) obj->callbacks.print = &print_cmus_state;
   END OBJ(cmus_file, 0) obj->callbacks.print = &print_cmus_file;
   END OBJ(cmus_title, 0) obj->callbacks.print = &print_cmus_title;
@@ -2053,7 +2140,8 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
   obj->callbacks.free = &free_intel_backlight;
   init_intel_backlight(obj);
 #endif /* BUILD_INTEL_BACKLIGHT */
-  END {
+  END default:
+  unknown_variable: {
     auto *buf = static_cast<char *>(malloc(text_buffer_size.get(*state)));
 
     NORM_ERR("unknown variable '$%s'", s);
@@ -2061,6 +2149,7 @@ struct text_object *construct_text_object(char *s, const char *arg, long line,
     obj_be_plain_text(obj, buf);
     free(buf);
   }
+  }
 #undef OBJ
 #undef OBJ_IF
 #undef OBJ_ARG
@@ -2242,6 +2331,9 @@ int extract_variable_text_internal(struct text_object *retval,
     NORM_ERR("one or more $endif's are missing");
   }
 
+  retval->program = new text_program;
+  compile_text_objects(retval, retval->program);
+
   free(orig_p);
   return 0;
 }
@@ -2257,6 +2349,11 @@ void extract_object_args_to_sub(struct text_object *obj, const char *args) {
 void free_text_objects(struct text_object *root) {
   struct text_object *obj;
 
+  if (root != nullptr) {
+    delete root->program;
+    root->program = nullptr;
+  }
+
   if ((root != nullptr) && (root->prev != nullptr)) {
     for (obj = root->prev; obj != nullptr; obj = root->prev) {
       root->prev = obj->prev;
@@ -2264,6 +2361,7 @@ void free_text_objects(struct text_object *root) {
       free_text_objects(obj->sub);
       free_and_zero(obj->sub);
       free_and_zero(obj->special_data);
+      free_evaluated_text(&obj->evaluated);
       delete obj->cb_handle;
 
       free(obj);
@@ -99,6 +99,7 @@ class audacious_cb : public conky::callback<aud_result> {
 
  public:
   audacious_cb(uint32_t period) : Base(period, false, Tuple()) {
+    declare_blocking();
 #ifdef NEW_AUDACIOUS_FOUND
     DBusGConnection *connection = dbus_g_bus_get(DBUS_BUS_SESSION, nullptr);
     if (!connection)
@@ -186,9 +187,9 @@ void audacious_cb::work() {
 }
 
 aud_result get_res() {
-  uint32_t period = std::max(
-      lround(music_player_interval.get(*state) / active_update_interval()), 1l);
-  return conky::register_cb<audacious_cb>(period)->get_result_copy();
+  return conky::register_timed_cb<audacious_cb>(
+             music_player_interval.get(*state))
+      ->get_result_copy();
 }
 }  // namespace
 
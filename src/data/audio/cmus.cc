@@ -59,7 +59,9 @@ class cmus_cb : public conky::callback<cmus_result> {
   virtual void work();
 
  public:
-  explicit cmus_cb(uint32_t period) : Base(period, false, Tuple()) {}
+  explicit cmus_cb(uint32_t period) : Base(period, false, Tuple()) {
+    declare_blocking();
+  }
 };
 
 void cmus_cb::work() {
@@ -139,17 +141,15 @@ void cmus_cb::work() {
 }
 }  // namespace
 
-#define CMUS_PRINT_GENERATOR(type, alt)                                       \
-  void print_cmus_##type(struct text_object *obj, char *p,                    \
-                         unsigned int p_max_size) {                           \
-    (void)obj;                                                                \
-    uint32_t period = std::max(                                               \
-        lround(music_player_interval.get(*state) / active_update_interval()), \
-        1l);                                                                  \
-    const cmus_result &cmus =                                                 \
-        conky::register_cb<cmus_cb>(period)->get_result_copy();               \
-    snprintf(p, p_max_size, "%s",                                             \
-             (cmus.type.length() ? cmus.type.c_str() : alt));                 \
+#define CMUS_PRINT_GENERATOR(type, alt)                                      \
+  void print_cmus_##type(struct text_object *obj, char *p,                   \
+                         unsigned int p_max_size) {                          \
+    (void)obj;                                                               \
+    const cmus_result &cmus =                                                \
+        conky::register_timed_cb<cmus_cb>(music_player_interval.get(*state)) \
+            ->get_result_copy();                                             \
+    snprintf(p, p_max_size, "%s",                                            \
+             (cmus.type.length() ? cmus.type.c_str() : alt));                \
   }
 
 CMUS_PRINT_GENERATOR(state, "Off")
@@ -166,29 +166,26 @@ CMUS_PRINT_GENERATOR(date, "")
 
 uint8_t cmus_percent(struct text_object *obj) {
   (void)obj;
-  uint32_t period = std::max(
-      lround(music_player_interval.get(*state) / active_update_interval()), 1l);
   const cmus_result &cmus =
-      conky::register_cb<cmus_cb>(period)->get_result_copy();
+      conky::register_timed_cb<cmus_cb>(music_player_interval.get(*state))
+          ->get_result_copy();
   return static_cast<uint8_t>(round(cmus.progress * 100.0f));
 }
 
 double cmus_progress(struct text_object *obj) {
   (void)obj;
-  uint32_t period = std::max(
-      lround(music_player_interval.get(*state) / active_update_interval()), 1l);
   const cmus_result &cmus =
-      conky::register_cb<cmus_cb>(period)->get_result_copy();
+      conky::register_timed_cb<cmus_cb>(music_player_interval.get(*state))
+          ->get_result_copy();
   return static_cast<double>(cmus.progress);
 }
 
 void print_cmus_totaltime(struct text_object *obj, char *p,
                           unsigned int p_max_size) {
   (void)obj;
-  uint32_t period = std::max(
-      lround(music_player_interval.get(*state) / active_update_interval()), 1l);
   const cmus_result &cmus =
-      conky::register_cb<cmus_cb>(period)->get_result_copy();
+      conky::register_timed_cb<cmus_cb>(music_player_interval.get(*state))
+          ->get_result_copy();
   format_seconds_short(p, p_max_size,
                        strtol(cmus.totaltime.c_str(), nullptr, 10));
 }
@@ -196,20 +193,18 @@ void print_cmus_totaltime(struct text_object *obj, char *p,
 void print_cmus_timeleft(struct text_object *obj, char *p,
                          unsigned int p_max_size) {
   (void)obj;
-  uint32_t period = std::max(
-      lround(music_player_interval.get(*state) / active_update_interval()), 1l);
   const cmus_result &cmus =
-      conky::register_cb<cmus_cb>(period)->get_result_copy();
+      conky::register_timed_cb<cmus_cb>(music_player_interval.get(*state))
+          ->get_result_copy();
   format_seconds_short(p, p_max_size, static_cast<long>(cmus.timeleft));
 }
 
 void print_cmus_curtime(struct text_object *obj, char *p,
                         unsigned int p_max_size) {
   (void)obj;
-  uint32_t period = std::max(
-      lround(music_player_interval.get(*state) / active_update_interval()), 1l);
   const cmus_result &cmus =
-      conky::register_cb<cmus_cb>(period)->get_result_copy();
+      conky::register_timed_cb<cmus_cb>(music_player_interval.get(*state))
+          ->get_result_copy();
   format_seconds_short(p, p_max_size,
                        strtol(cmus.curtime.c_str(), nullptr, 10));
 }
@@ -57,7 +57,9 @@ class moc_cb : public conky::callback<moc_result> {
   void work() override;
 
  public:
-  explicit moc_cb(uint32_t period) : Base(period, false, Tuple()) {}
+  explicit moc_cb(uint32_t period) : Base(period, false, Tuple()) {
+    declare_blocking();
+  }
 };
 
 void moc_cb::work() {
@@ -133,17 +135,15 @@ void moc_cb::work() {
 }
 }  // namespace
 
-#define MOC_PRINT_GENERATOR(type, alt)                                        \
-  void print_moc_##type(struct text_object *obj, char *p,                     \
-                        unsigned int p_max_size) {                            \
-    (void)obj;                                                                \
-    uint32_t period = std::max(                                               \
-        lround(music_player_interval.get(*state) / active_update_interval()), \
-        1l);                                                                  \
-    const moc_result &moc =                                                   \
-        conky::register_cb<moc_cb>(period)->get_result_copy();                \
-    snprintf(p, p_max_size, "%s",                                             \
-             (moc.type.length() ? moc.type.c_str() : (alt)));                 \
+#define MOC_PRINT_GENERATOR(type, alt)                                      \
+  void print_moc_##type(struct text_object *obj, char *p,                   \
+                        unsigned int p_max_size) {                          \
+    (void)obj;                                                              \
+    const moc_result &moc =                                                 \
+        conky::register_timed_cb<moc_cb>(music_player_interval.get(*state)) \
+            ->get_result_copy();                                            \
+    snprintf(p, p_max_size, "%s",                                           \
+             (moc.type.length() ? moc.type.c_str() : (alt)));               \
   }
 
 MOC_PRINT_GENERATOR(state, "??")
@@ -165,10 +165,9 @@ MOC_PRINT_GENERATOR(rate, "0kHz")
 
 double moc_barval(struct text_object * obj) {
   (void)obj;
-  uint32_t period = std::max(
-      lround(music_player_interval.get(*state) / active_update_interval()),
-      1l);
-  const moc_result &moc = conky::register_cb<moc_cb>(period)->get_result_copy();
+  const moc_result &moc =
+      conky::register_timed_cb<moc_cb>(music_player_interval.get(*state))
+          ->get_result_copy();
   double progress;
 
   int totalsec = atoi(moc.totalsec.c_str());
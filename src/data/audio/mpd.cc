@@ -143,7 +143,9 @@ class mpd_cb : public conky::callback<mpd_result> {
 
  public:
   explicit mpd_cb(uint32_t period)
-      : Base(period, false, Tuple()), conn(nullptr) {}
+      : Base(period, false, Tuple()), conn(nullptr) {
+    declare_blocking();
+  }
 
   ~mpd_cb() override {
     if (conn != nullptr) { mpd_closeConnection(conn); }
@@ -302,9 +304,8 @@ void mpd_cb::work() {
 }
 
 mpd_result get_mpd() {
-  uint32_t period = std::max(
-      lround(music_player_interval.get(*state) / active_update_interval()), 1l);
-  return conky::register_cb<mpd_cb>(period)->get_result_copy();
+  return conky::register_timed_cb<mpd_cb>(music_player_interval.get(*state))
+      ->get_result_copy();
 }
 }  // namespace
 
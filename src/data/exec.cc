@@ -139,8 +139,8 @@ static FILE *pid_popen(const char *command, const char *mode, pid_t *child) {
  * conky::run_all_callbacks() handles this. In order for this magic to
  * happen, we must register a callback with conky::register_cb<exec_cb>()
  * and store it somewhere, such as obj->exec_handle. To retrieve the
- * results, use the stored callback to call get_result_copy(), which
- * returns a std::string.
+ * results, use the stored callback to call get_result_ptr(), which
+ * returns a pointer to the std::string last published.
  */
 void exec_cb::work() {
   pid_t childpid;
@@ -159,10 +159,9 @@ void exec_cb::work() {
     buf.append(b, length);
   }
 
-  if (*buf.rbegin() == '\n') { buf.resize(buf.size() - 1); }
+  if (!buf.empty() && *buf.rbegin() == '\n') { buf.resize(buf.size() - 1); }
 
-  std::lock_guard<std::mutex> l(result_mutex);
-  result = buf;
+  publish(std::move(buf));
 }
 
 // remove backspaced chars, example: "dog^H^H^Hcat" becomes "cat"
@@ -225,7 +224,7 @@ static inline double get_barnum(const char *buf) {
 void fill_p(const char *buffer, struct text_object *obj, char *p,
             unsigned int p_max_size) {
   if (obj->parse) {
-    evaluate(buffer, p, p_max_size);
+    evaluate(buffer, p, p_max_size, &obj->evaluated);
   } else {
     snprintf(p, p_max_size, "%s", buffer);
   }
@@ -321,10 +320,9 @@ void register_execi(struct text_object *obj) {
   auto *ed = static_cast<struct execi_data *>(obj->data.opaque);
 
   if ((ed != nullptr) && (ed->cmd != nullptr) && (ed->cmd[0] != 0)) {
-    uint32_t period =
-        std::max(lround(ed->interval / active_update_interval()), 1l);
     obj->exec_handle = new conky::callback_handle<exec_cb>(
-        conky::register_cb<exec_cb>(period, !obj->thread, ed->cmd));
+        conky::register_timed_cb<exec_cb>(ed->interval, !obj->thread,
+                                          ed->cmd));
   } else {
     DBGP("unable to register execi callback");
   }
@@ -339,7 +337,7 @@ void register_execi(struct text_object *obj) {
  */
 void print_exec(struct text_object *obj, char *p, unsigned int p_max_size) {
   if (obj->exec_handle != nullptr) {
-    fill_p((*obj->exec_handle)->get_result_copy().c_str(), obj, p, p_max_size);
+    fill_p((*obj->exec_handle)->get_result_ptr()->c_str(), obj, p, p_max_size);
   }
 }
 
@@ -351,7 +349,7 @@ void print_exec(struct text_object *obj, char *p, unsigned int p_max_size) {
  */
 double execbarval(struct text_object *obj) {
   if (obj->exec_handle != nullptr) {
-    return get_barnum((*obj->exec_handle)->get_result_copy().c_str());
+    return get_barnum((*obj->exec_handle)->get_result_ptr()->c_str());
   }
   return 0.0;
 }
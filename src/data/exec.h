@@ -55,7 +55,11 @@ class exec_cb : public conky::callback<std::string, std::string> {
 
  public:
   exec_cb(uint32_t period, bool wait, const std::string &cmd)
-      : Base(period, wait, Base::Tuple(cmd)) {}
+      : Base(period, wait, Base::Tuple(cmd)) {
+    declare_blocking();
+  }
+
+  virtual std::string name() const { return "exec " + std::get<0>(tuple); }
 };
 
 /**
@@ -31,8 +31,10 @@
 #include <fcntl.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <atomic>
 #include <cctype>
 #include <cerrno>
+#include <mutex>
 #include "../conky.h"
 #include "../logging.h"
 #include "../content/specials.h"
@@ -72,9 +74,21 @@
 
 static struct fs_stat fs_stats_[MAX_FS_STATS];
 struct fs_stat *fs_stats = fs_stats_;
+/* how often fs_stats were refreshed, which is when fs_* output changes */
+static std::atomic<uint64_t> fs_generation{0};
+/* Guards fs_stats. statfs() may hang on a dead mount, so it is done on a copy
+ * of an fs_stat without the lock, which publish_fs_stat() then puts back. */
+static std::mutex fs_mutex;
 
 static void update_fs_stat(struct fs_stat *fs);
 
+static void publish_fs_stat(struct fs_stat *to, const struct fs_stat &from) {
+  std::lock_guard<std::mutex> lock(fs_mutex);
+  /* cleared meanwhile */
+  if (to->set == 0 || strcmp(to->path, from.path) != 0) { return; }
+  *to = from;
+}
+
 void get_fs_type(const char *path, char *result);
 
 int update_fs_stats() {
@@ -84,14 +98,28 @@ int update_fs_stats() {
   if (current_update_time - last_fs_update < 13) { return 0; }
 
   for (i = 0; i < MAX_FS_STATS; ++i) {
-    if (fs_stats[i].set != 0) { update_fs_stat(&fs_stats[i]); }
+    struct fs_stat fs;
+    {
+      std::lock_guard<std::mutex> lock(fs_mutex);
+      if (fs_stats[i].set == 0) { continue; }
+      fs = fs_stats[i];
+    }
+    update_fs_stat(&fs);
+    publish_fs_stat(&fs_stats[i], fs);
   }
   last_fs_update = current_update_time;
+  fs_generation.fetch_add(1, std::memory_order_release);
   return 0;
 }
 
+uint64_t fs_cache_key(struct text_object *obj) {
+  (void)obj;
+  return fs_generation.load(std::memory_order_acquire);
+}
+
 void clear_fs_stats() {
   unsigned i;
+  std::lock_guard<std::mutex> lock(fs_mutex);
   for (i = 0; i < MAX_FS_STATS; ++i) {
     memset(&fs_stats[i], 0, sizeof(struct fs_stat));
   }
@@ -99,27 +127,33 @@ void clear_fs_stats() {
 
 struct fs_stat *prepare_fs_stat(const char *s) {
   struct fs_stat *next = nullptr;
+  struct fs_stat fs;
   unsigned i;
 
-  /* lookup existing or get new */
-  for (i = 0; i < MAX_FS_STATS; ++i) {
-    if (fs_stats[i].set != 0) {
-      if (strncmp(fs_stats[i].path, s, DEFAULT_TEXT_BUFFER_SIZE) == 0) {
-        return &fs_stats[i];
+  {
+    std::lock_guard<std::mutex> lock(fs_mutex);
+    /* lookup existing or get new */
+    for (i = 0; i < MAX_FS_STATS; ++i) {
+      if (fs_stats[i].set != 0) {
+        if (strncmp(fs_stats[i].path, s, DEFAULT_TEXT_BUFFER_SIZE) == 0) {
+          return &fs_stats[i];
+        }
+      } else {
+        next = &fs_stats[i];
       }
-    } else {
-      next = &fs_stats[i];
     }
+    /* new path */
+    if (next == nullptr) {
+      NORM_ERR("too many fs stats");
+      return nullptr;
+    }
+    strncpy(next->path, s, DEFAULT_TEXT_BUFFER_SIZE);
+    next->set = 1;
+    next->errored = 0;
+    fs = *next;
   }
-  /* new path */
-  if (next == nullptr) {
-    NORM_ERR("too many fs stats");
-    return nullptr;
-  }
-  strncpy(next->path, s, DEFAULT_TEXT_BUFFER_SIZE);
-  next->set = 1;
-  next->errored = 0;
-  update_fs_stat(next);
+  update_fs_stat(&fs);
+  publish_fs_stat(next, fs);
   return next;
 }
 
@@ -242,6 +276,7 @@ void init_fs_bar(struct text_object *obj, const char *arg) {
 static double get_fs_perc(struct text_object *obj, bool get_free) {
   auto *fs = static_cast<struct fs_stat *>(obj->data.opaque);
   double ret = 0.0;
+  std::lock_guard<std::mutex> lock(fs_mutex);
 
   if ((fs != nullptr) && (fs->size != 0)) {
     if (get_free) {
@@ -273,11 +308,13 @@ uint8_t fs_used_percentage(struct text_object *obj) {
   return get_fs_perc(obj, false) * 100;
 }
 
-#define HUMAN_PRINT_FS_GENERATOR(name, expr)                 \
-  void print_fs_##name(struct text_object *obj, char *p,     \
-                       unsigned int p_max_size) {            \
-    struct fs_stat *fs = (struct fs_stat *)obj->data.opaque; \
-    if (fs) human_readable(expr, p, p_max_size);             \
+#define HUMAN_PRINT_FS_GENERATOR(name, expr)                                \
+  size_t print_fs_##name(struct text_object *obj, char *p,                  \
+                         unsigned int p_max_size) {                         \
+    struct fs_stat *fs = (struct fs_stat *)obj->data.opaque;                \
+    if (!fs) return 0;                                                      \
+    std::lock_guard<std::mutex> lock(fs_mutex);                             \
+    return written_length(human_readable(expr, p, p_max_size), p_max_size); \
   }
 
 HUMAN_PRINT_FS_GENERATOR(free, fs->avail)
@@ -286,6 +323,7 @@ HUMAN_PRINT_FS_GENERATOR(used, fs->size - fs->free)
 
 void print_fs_type(struct text_object *obj, char *p, unsigned int p_max_size) {
   auto *fs = static_cast<struct fs_stat *>(obj->data.opaque);
+  std::lock_guard<std::mutex> lock(fs_mutex);
 
   if (fs != nullptr) { snprintf(p, p_max_size, "%s", fs->type); }
 }
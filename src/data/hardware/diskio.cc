@@ -30,6 +30,7 @@
 #include "diskio.h"
 #include <sys/stat.h>
 #include <cstdlib>
+#include <mutex>
 #include <vector>
 #include "../../common.h"
 #include "config.h"
@@ -43,6 +44,11 @@
  * also containing the totals. */
 struct diskio_stat stats;
 
+/* Guards the current values of the diskio_stats, the only ones the text
+ * objects read. update_diskio() keeps the rest to itself, and publishes the
+ * current values of a disk under the lock once it has computed them. */
+static std::mutex diskio_mutex;
+
 void clear_diskio_stats() {
   struct diskio_stat *cur;
   while (stats.next != nullptr) {
@@ -143,12 +149,15 @@ static void print_diskio_dir(struct text_object *obj, int dir, char *p,
 
   if (diskio == nullptr) { return; }
 
-  if (dir < 0) {
-    val = diskio->current_read;
-  } else if (dir == 0) {
-    val = diskio->current;
-  } else {
-    val = diskio->current_write;
+  {
+    std::lock_guard<std::mutex> lock(diskio_mutex);
+    if (dir < 0) {
+      val = diskio->current_read;
+    } else if (dir == 0) {
+      val = diskio->current;
+    } else {
+      val = diskio->current_write;
+    }
   }
 
   /* TODO: move this correction from kB to kB/s elsewhere
@@ -181,23 +190,32 @@ void parse_diskiograph_arg(struct text_object *obj, const char *arg) {
 
 double diskiographval(struct text_object *obj) {
   auto *diskio = static_cast<struct diskio_stat *>(obj->data.opaque);
+  std::lock_guard<std::mutex> lock(diskio_mutex);
 
   return (diskio != nullptr ? diskio->current : 0);
 }
 
 double diskiographval_read(struct text_object *obj) {
   auto *diskio = static_cast<struct diskio_stat *>(obj->data.opaque);
+  std::lock_guard<std::mutex> lock(diskio_mutex);
 
   return (diskio != nullptr ? diskio->current_read : 0);
 }
 
 double diskiographval_write(struct text_object *obj) {
   auto *diskio = static_cast<struct diskio_stat *>(obj->data.opaque);
+  std::lock_guard<std::mutex> lock(diskio_mutex);
 
   return (diskio != nullptr ? diskio->current_write : 0);
 }
 #endif /* BUILD_GUI */
 
+/* publishes zero current values, e.g. when the disks could not be read */
+void reset_diskio_values(struct diskio_stat *ds) {
+  std::lock_guard<std::mutex> lock(diskio_mutex);
+  ds->current = ds->current_read = ds->current_write = 0;
+}
+
 void update_diskio_values(struct diskio_stat *ds, unsigned int reads,
                           unsigned int writes) {
   int i;
@@ -223,9 +241,12 @@ void update_diskio_values(struct diskio_stat *ds, unsigned int reads,
     sum_r += ds->sample_read[i] * 1024LL;
     sum_w += ds->sample_write[i] * 1024LL;
   }
-  ds->current = sum / static_cast<double>(samples);
-  ds->current_read = sum_r / static_cast<double>(samples);
-  ds->current_write = sum_w / static_cast<double>(samples);
+  {
+    std::lock_guard<std::mutex> lock(diskio_mutex);
+    ds->current = sum / static_cast<double>(samples);
+    ds->current_read = sum_r / static_cast<double>(samples);
+    ds->current_write = sum_w / static_cast<double>(samples);
+  }
 
   /* shift sample history */
   for (i = samples - 1; i > 0; i--) {
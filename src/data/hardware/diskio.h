@@ -65,6 +65,7 @@ struct diskio_stat *prepare_diskio_stat(const char *);
 int update_diskio(void);
 void clear_diskio_stats(void);
 void update_diskio_values(struct diskio_stat *, unsigned int, unsigned int);
+void reset_diskio_values(struct diskio_stat *);
 
 void parse_diskio_arg(struct text_object *, const char *);
 void print_diskio(struct text_object *, char *, unsigned int);
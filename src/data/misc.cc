@@ -80,14 +80,14 @@ void print_catp(struct text_object *obj, char *p, unsigned int p_max_size) {
 
   read_file(obj->data.s, buf, sz);
 
-  evaluate(buf, p, p_max_size);
+  evaluate(buf, p, p_max_size, &obj->evaluated);
 
   delete[] buf;
 }
 
 void print_startcase(struct text_object *obj, char *p,
                      unsigned int p_max_size) {
-  evaluate(obj->data.s, p, p_max_size);
+  evaluate(obj->data.s, p, p_max_size, &obj->evaluated);
 
   for (unsigned int x = 0, z = 0; x < p_max_size - 1 && p[x]; x++) {
     if (isspace(p[x])) {
@@ -101,7 +101,7 @@ void print_startcase(struct text_object *obj, char *p,
 
 void print_lowercase(struct text_object *obj, char *p,
                      unsigned int p_max_size) {
-  evaluate(obj->data.s, p, p_max_size);
+  evaluate(obj->data.s, p, p_max_size, &obj->evaluated);
 
   for (unsigned int x = 0; x < p_max_size - 1 && p[x]; x++)
     p[x] = tolower(p[x]);
@@ -109,7 +109,7 @@ void print_lowercase(struct text_object *obj, char *p,
 
 void print_uppercase(struct text_object *obj, char *p,
                      unsigned int p_max_size) {
-  evaluate(obj->data.s, p, p_max_size);
+  evaluate(obj->data.s, p, p_max_size, &obj->evaluated);
 
   for (unsigned int x = 0; x < p_max_size - 1 && p[x]; x++)
     p[x] = toupper(p[x]);
@@ -117,7 +117,7 @@ void print_uppercase(struct text_object *obj, char *p,
 
 void strip_trailing_whitespace(struct text_object *obj, char *p,
                                unsigned int p_max_size) {
-  evaluate(obj->data.s, p, p_max_size);
+  evaluate(obj->data.s, p, p_max_size, &obj->evaluated);
   for (unsigned int x = p_max_size - 2;; x--) {
     if (p[x] && !isspace(p[x])) {
       p[x + 1] = '\0';
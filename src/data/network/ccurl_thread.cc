@@ -162,10 +162,7 @@ class simple_curl_cb : public curl_callback<std::string> {
   typedef curl_callback<std::string> Base;
 
  protected:
-  virtual void process_data() {
-    std::lock_guard<std::mutex> lock(result_mutex);
-    result = data;
-  }
+  virtual void process_data() { publish(data); }
 
  public:
   simple_curl_cb(uint32_t period, const std::string &uri)
@@ -185,10 +182,9 @@ struct curl_data {
 /* prints result data to text buffer, used by $curl */
 void ccurl_process_info(char *p, int p_max_size, const std::string &uri,
                         int interval) {
-  uint32_t period = std::max(lround(interval / active_update_interval()), 1l);
-  auto cb = conky::register_cb<simple_curl_cb>(period, uri);
+  auto cb = conky::register_timed_cb<simple_curl_cb>(interval, uri);
 
-  strncpy(p, cb->get_result_copy().c_str(), p_max_size);
+  strncpy(p, cb->get_result_ptr()->c_str(), p_max_size);
 }
 
 void curl_parse_arg(struct text_object *obj, const char *arg) {
@@ -74,7 +74,9 @@ class curl_callback : public conky::callback<Result, std::string, Keys...>,
 
  public:
   curl_callback(uint32_t period, const typename Base1::Tuple &tuple)
-      : Base1(period, false, tuple), Base2(std::get<0>(tuple)) {}
+      : Base1(period, false, tuple), Base2(std::get<0>(tuple)) {
+    Base1::declare_blocking();
+  }
 };
 
 /* $curl exports begin */
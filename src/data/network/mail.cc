@@ -169,7 +169,7 @@ class mail_cb
 
 struct mail_param_ex : public mail_cb::Tuple {
   uint16_t retries{0};
-  uint32_t period{1};
+  double interval{0};
 
   mail_param_ex() = default;
 };
@@ -519,7 +519,7 @@ std::unique_ptr<mail_param_ex> parse_mail_args(mail_type type,
     tmp += 3;
     sscanf(tmp, "%f", &interval);
   }
-  mail->period = std::max(lround(interval / active_update_interval()), 1l);
+  mail->interval = interval;
 
   tmp = const_cast<char *>(strstr(arg, "-p "));
   if (tmp != nullptr) {
@@ -895,7 +895,8 @@ void print_imap_unseen(struct text_object *obj, char *p,
 
   if (mail == nullptr) { return; }
 
-  auto cb = conky::register_cb<imap_cb>(mail->period, *mail, mail->retries);
+  auto cb = conky::register_timed_cb<imap_cb>(mail->interval, *mail,
+                                              mail->retries);
 
   snprintf(p, p_max_size, "%lu", cb->get_result_copy().unseen);
 }
@@ -906,7 +907,8 @@ void print_imap_messages(struct text_object *obj, char *p,
 
   if (mail == nullptr) { return; }
 
-  auto cb = conky::register_cb<imap_cb>(mail->period, *mail, mail->retries);
+  auto cb = conky::register_timed_cb<imap_cb>(mail->interval, *mail,
+                                              mail->retries);
 
   snprintf(p, p_max_size, "%lu", cb->get_result_copy().messages);
 }
@@ -968,7 +970,8 @@ void print_pop3_unseen(struct text_object *obj, char *p,
 
   if (mail == nullptr) { return; }
 
-  auto cb = conky::register_cb<pop3_cb>(mail->period, *mail, mail->retries);
+  auto cb = conky::register_timed_cb<pop3_cb>(mail->interval, *mail,
+                                              mail->retries);
 
   snprintf(p, p_max_size, "%lu", cb->get_result_copy().unseen);
 }
@@ -979,7 +982,8 @@ void print_pop3_used(struct text_object *obj, char *p,
 
   if (mail == nullptr) { return; }
 
-  auto cb = conky::register_cb<pop3_cb>(mail->period, *mail, mail->retries);
+  auto cb = conky::register_timed_cb<pop3_cb>(mail->interval, *mail,
+                                              mail->retries);
 
   snprintf(p, p_max_size, "%.1f", cb->get_result_copy().used / 1024.0 / 1024.0);
 }
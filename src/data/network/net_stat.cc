@@ -34,6 +34,7 @@
 #include <unistd.h>
 #include <cerrno>
 #include <cstring>
+#include <mutex>
 #include "../../conky.h"
 #include "../../logging.h"
 #include "net/if.h"
@@ -74,6 +75,103 @@ static conky::simple_config_setting<if_up_strictness_> if_up_strictness(
 struct net_stat netstats[MAX_NET_INTERFACES];
 struct net_stat foo_netstats;
 
+/* What the text objects read instead: copies of the above, made at the end of
+ * update_net_stats(), which an update may leave behind while it waits on
+ * the network. The v6addrs lists are copies too, and dev is not kept. */
+static std::mutex shown_mutex;
+static struct net_stat shown_netstats[MAX_NET_INTERFACES];
+static struct net_stat shown_foo_netstats;
+
+/* the copy of the net_stat an object refers to, locked while in scope */
+class shown_net_stat {
+  std::lock_guard<std::mutex> lock;
+  struct net_stat *ns;
+
+ public:
+  explicit shown_net_stat(struct text_object *obj) : lock(shown_mutex) {
+    auto *of = static_cast<struct net_stat *>(obj->data.opaque);
+    if (of == nullptr) {
+      ns = nullptr;
+    } else if (of >= netstats && of < netstats + MAX_NET_INTERFACES) {
+      ns = &shown_netstats[of - netstats];
+    } else {
+      ns = &shown_foo_netstats;
+    }
+  }
+
+  struct net_stat *operator->() const { return ns; }
+  bool operator!() const { return ns == nullptr; }
+};
+
+#ifdef BUILD_IPV6
+static void free_v6addrs(struct v6addr *&list) {
+  while (list != nullptr) {
+    struct v6addr *next = list->next;
+    free(list);
+    list = next;
+  }
+}
+
+static struct v6addr *copy_v6addrs(const struct v6addr *from) {
+  struct v6addr *head = nullptr;
+  struct v6addr **tail = &head;
+  for (; from != nullptr; from = from->next) {
+    *tail = static_cast<struct v6addr *>(malloc(sizeof(struct v6addr)));
+    **tail = *from;
+    (*tail)->next = nullptr;
+    tail = &(*tail)->next;
+  }
+  return head;
+}
+#endif /* BUILD_IPV6 */
+
+static void publish_net_stat(struct net_stat &to, const struct net_stat &from) {
+#ifdef BUILD_IPV6
+  free_v6addrs(to.v6addrs);
+#endif /* BUILD_IPV6 */
+  to = from;
+  to.dev = nullptr;
+#ifdef BUILD_IPV6
+  to.v6addrs = copy_v6addrs(from.v6addrs);
+#endif /* BUILD_IPV6 */
+}
+
+static void publish_net_stats() {
+  std::lock_guard<std::mutex> lock(shown_mutex);
+  for (int i = 0; i < MAX_NET_INTERFACES; ++i) {
+    publish_net_stat(shown_netstats[i], netstats[i]);
+  }
+  publish_net_stat(shown_foo_netstats, foo_netstats);
+}
+
+/**
+ * Collects the network statistics with collect_net_stats() and publishes
+ * them for the text objects.
+ **/
+int update_net_stats() {
+  /* clear speeds, addresses and up status in case device was removed and
+   *  doesn't get updated */
+
+#ifdef HAVE_OPENMP
+#pragma omp parallel for schedule(dynamic, 10)
+#endif /* HAVE_OPENMP */
+  for (int i = 0; i < MAX_NET_INTERFACES; ++i) {
+    if (netstats[i].dev != nullptr) {
+      netstats[i].up = 0;
+      netstats[i].recv_speed = 0.0;
+      netstats[i].trans_speed = 0.0;
+      netstats[i].addr.sa_data[2] = 0;
+      netstats[i].addr.sa_data[3] = 0;
+      netstats[i].addr.sa_data[4] = 0;
+      netstats[i].addr.sa_data[5] = 0;
+    }
+  }
+
+  int ret = collect_net_stats();
+  publish_net_stats();
+  return ret;
+}
+
 /**
  * Returns pointer to specified interface in netstats array.
  * If not found then add the specified interface to the array.
@@ -203,61 +301,71 @@ void parse_net_stat_bar_arg(struct text_object *obj, const char *arg,
   }
 }
 
-void print_downspeed(struct text_object *obj, char *p,
-                     unsigned int p_max_size) {
-  auto *ns = static_cast<struct net_stat *>(obj->data.opaque);
+size_t print_downspeed(struct text_object *obj, char *p,
+                       unsigned int p_max_size) {
+  shown_net_stat ns(obj);
 
-  if (ns == nullptr) { return; }
+  if (!ns) { return 0; }
 
-  human_readable(ns->recv_speed, p, p_max_size);
+  return written_length(human_readable(ns->recv_speed, p, p_max_size),
+                        p_max_size);
 }
 
-void print_downspeedf(struct text_object *obj, char *p,
-                      unsigned int p_max_size) {
-  auto *ns = static_cast<struct net_stat *>(obj->data.opaque);
+size_t print_downspeedf(struct text_object *obj, char *p,
+                        unsigned int p_max_size) {
+  shown_net_stat ns(obj);
 
-  if (ns == nullptr) { return; }
+  if (!ns) { return 0; }
 
-  spaced_print(p, p_max_size, "%.1f", 8, ns->recv_speed / 1024.0);
+  return written_length(
+      spaced_print(p, p_max_size, "%.1f", 8, ns->recv_speed / 1024.0),
+      p_max_size);
 }
 
-void print_upspeed(struct text_object *obj, char *p, unsigned int p_max_size) {
-  auto *ns = static_cast<struct net_stat *>(obj->data.opaque);
+size_t print_upspeed(struct text_object *obj, char *p,
+                     unsigned int p_max_size) {
+  shown_net_stat ns(obj);
 
-  if (ns == nullptr) { return; }
+  if (!ns) { return 0; }
 
-  human_readable(ns->trans_speed, p, p_max_size);
+  return written_length(human_readable(ns->trans_speed, p, p_max_size),
+                        p_max_size);
 }
 
-void print_upspeedf(struct text_object *obj, char *p, unsigned int p_max_size) {
-  auto *ns = static_cast<struct net_stat *>(obj->data.opaque);
+size_t print_upspeedf(struct text_object *obj, char *p,
+                      unsigned int p_max_size) {
+  shown_net_stat ns(obj);
 
-  if (ns == nullptr) { return; }
+  if (!ns) { return 0; }
 
-  spaced_print(p, p_max_size, "%.1f", 8, ns->trans_speed / 1024.0);
+  return written_length(
+      spaced_print(p, p_max_size, "%.1f", 8, ns->trans_speed / 1024.0),
+      p_max_size);
 }
 
-void print_totaldown(struct text_object *obj, char *p,
-                     unsigned int p_max_size) {
-  auto *ns = static_cast<struct net_stat *>(obj->data.opaque);
+size_t print_totaldown(struct text_object *obj, char *p,
+                       unsigned int p_max_size) {
+  shown_net_stat ns(obj);
 
-  if (ns == nullptr) { return; }
+  if (!ns) { return 0; }
 
-  human_readable(ns->recv, p, p_max_size);
+  return written_length(human_readable(ns->recv, p, p_max_size), p_max_size);
 }
 
-void print_totalup(struct text_object *obj, char *p, unsigned int p_max_size) {
-  auto *ns = static_cast<struct net_stat *>(obj->data.opaque);
+size_t print_totalup(struct text_object *obj, char *p,
+                     unsigned int p_max_size) {
+  shown_net_stat ns(obj);
 
-  if (ns == nullptr) { return; }
+  if (!ns) { return 0; }
 
-  human_readable(ns->trans, p, p_max_size);
+  return written_length(human_readable(ns->trans, p, p_max_size),
+                        p_max_size);
 }
 
 void print_addr(struct text_object *obj, char *p, unsigned int p_max_size) {
-  auto *ns = static_cast<struct net_stat *>(obj->data.opaque);
+  shown_net_stat ns(obj);
 
-  if (ns == nullptr) { return; }
+  if (!ns) { return; }
 
   if ((ns->addr.sa_data[2] & 255) == 0 && (ns->addr.sa_data[3] & 255) == 0 &&
       (ns->addr.sa_data[4] & 255) == 0 && (ns->addr.sa_data[5] & 255) == 0) {
@@ -271,13 +379,14 @@ void print_addr(struct text_object *obj, char *p, unsigned int p_max_size) {
 
 #ifdef __linux__
 void print_addrs(struct text_object *obj, char *p, unsigned int p_max_size) {
-  struct net_stat *ns = (struct net_stat *)obj->data.opaque;
+  shown_net_stat ns(obj);
 
   if (!ns) return;
 
-  if (0 != ns->addrs[0] && strlen(ns->addrs) > 2) {
-    ns->addrs[strlen(ns->addrs) - 2] = 0; /* remove ", " from end of string */
-    strncpy(p, ns->addrs, p_max_size);
+  size_t len = strlen(ns->addrs);
+  if (len > 2) {
+    /* without the ", " at the end */
+    snprintf(p, p_max_size, "%.*s", static_cast<int>(len - 2), ns->addrs);
   } else {
     strncpy(p, "0.0.0.0", p_max_size);
   }
@@ -285,7 +394,7 @@ void print_addrs(struct text_object *obj, char *p, unsigned int p_max_size) {
 
 #ifdef BUILD_IPV6
 void print_v6addrs(struct text_object *obj, char *p, unsigned int p_max_size) {
-  struct net_stat *ns = (struct net_stat *)obj->data.opaque;
+  shown_net_stat ns(obj);
   char tempaddress[INET6_ADDRSTRLEN];
   struct v6addr *current_v6 = ns->v6addrs;
 
@@ -360,27 +469,27 @@ void parse_net_stat_graph_arg(struct text_object *obj, const char *arg,
  *                containing a void * to a net_stat struct
  **/
 double downspeedgraphval(struct text_object *obj) {
-  auto *ns = static_cast<struct net_stat *>(obj->data.opaque);
+  shown_net_stat ns(obj);
 
-  return (ns != nullptr ? ns->recv_speed : 0);
+  return (!ns ? 0 : ns->recv_speed);
 }
 
 double upspeedgraphval(struct text_object *obj) {
-  auto *ns = static_cast<struct net_stat *>(obj->data.opaque);
+  shown_net_stat ns(obj);
 
-  return (ns != nullptr ? ns->trans_speed : 0);
+  return (!ns ? 0 : ns->trans_speed);
 }
 #endif /* BUILD_GUI */
 
 #ifdef BUILD_WLAN
 void print_wireless_essid(struct text_object *obj, char *p,
                           unsigned int p_max_size) {
-  struct net_stat *ns = (struct net_stat *)obj->data.opaque;
+  shown_net_stat ns(obj);
 
   if (!ns) {
-    for (unsigned int i = 0; *(netstats[i].dev) != 0; i++) {
-      if (*(netstats[i].essid) != 0) {
-        snprintf(p, p_max_size, "%s", netstats[i].essid);
+    for (unsigned int i = 0; i < MAX_NET_INTERFACES; i++) {
+      if (*(shown_netstats[i].essid) != 0) {
+        snprintf(p, p_max_size, "%s", shown_netstats[i].essid);
         return;
       }
     }
@@ -391,7 +500,7 @@ void print_wireless_essid(struct text_object *obj, char *p,
 }
 void print_wireless_mode(struct text_object *obj, char *p,
                          unsigned int p_max_size) {
-  struct net_stat *ns = (struct net_stat *)obj->data.opaque;
+  shown_net_stat ns(obj);
 
   if (!ns) return;
 
@@ -399,7 +508,7 @@ void print_wireless_mode(struct text_object *obj, char *p,
 }
 void print_wireless_channel(struct text_object *obj, char *p,
                             unsigned int p_max_size) {
-  struct net_stat *ns = (struct net_stat *)obj->data.opaque;
+  shown_net_stat ns(obj);
 
   if (!ns) return;
 
@@ -411,7 +520,7 @@ void print_wireless_channel(struct text_object *obj, char *p,
 }
 void print_wireless_frequency(struct text_object *obj, char *p,
                               unsigned int p_max_size) {
-  struct net_stat *ns = (struct net_stat *)obj->data.opaque;
+  shown_net_stat ns(obj);
 
   if (!ns) return;
 
@@ -423,7 +532,7 @@ void print_wireless_frequency(struct text_object *obj, char *p,
 }
 void print_wireless_bitrate(struct text_object *obj, char *p,
                             unsigned int p_max_size) {
-  struct net_stat *ns = (struct net_stat *)obj->data.opaque;
+  shown_net_stat ns(obj);
 
   if (!ns) return;
 
@@ -431,7 +540,7 @@ void print_wireless_bitrate(struct text_object *obj, char *p,
 }
 void print_wireless_ap(struct text_object *obj, char *p,
                        unsigned int p_max_size) {
-  struct net_stat *ns = (struct net_stat *)obj->data.opaque;
+  shown_net_stat ns(obj);
 
   if (!ns) return;
 
@@ -439,7 +548,7 @@ void print_wireless_ap(struct text_object *obj, char *p,
 }
 void print_wireless_link_qual(struct text_object *obj, char *p,
                               unsigned int p_max_size) {
-  struct net_stat *ns = (struct net_stat *)obj->data.opaque;
+  shown_net_stat ns(obj);
 
   if (!ns) return;
 
@@ -447,7 +556,7 @@ void print_wireless_link_qual(struct text_object *obj, char *p,
 }
 void print_wireless_link_qual_max(struct text_object *obj, char *p,
                                   unsigned int p_max_size) {
-  struct net_stat *ns = (struct net_stat *)obj->data.opaque;
+  shown_net_stat ns(obj);
 
   if (!ns) return;
 
@@ -455,7 +564,7 @@ void print_wireless_link_qual_max(struct text_object *obj, char *p,
 }
 void print_wireless_link_qual_perc(struct text_object *obj, char *p,
                                    unsigned int p_max_size) {
-  struct net_stat *ns = (struct net_stat *)obj->data.opaque;
+  shown_net_stat ns(obj);
 
   if (!ns) return;
 
@@ -467,7 +576,7 @@ void print_wireless_link_qual_perc(struct text_object *obj, char *p,
   }
 }
 double wireless_link_barval(struct text_object *obj) {
-  struct net_stat *ns = (struct net_stat *)obj->data.opaque;
+  shown_net_stat ns(obj);
 
   if (!ns) return 0;
 
@@ -495,6 +604,14 @@ void clear_net_stats() {
 #endif /* BUILD_IPV6 */
   }
   memset(netstats, 0, sizeof(netstats));
+
+  std::lock_guard<std::mutex> lock(shown_mutex);
+#ifdef BUILD_IPV6
+  for (i = 0; i < MAX_NET_INTERFACES; i++) {
+    free_v6addrs(shown_netstats[i].v6addrs);
+  }
+#endif /* BUILD_IPV6 */
+  memset(shown_netstats, 0, sizeof(shown_netstats));
 }
 
 void clear_net_stats(net_stat *in) {
@@ -87,14 +87,18 @@ extern struct net_stat netstats[];
 
 struct net_stat *get_net_stat(const char *, void *, void *);
 
+/* The platform's part of update_net_stats(): fills netstats, which the text
+ * objects only see once update_net_stats() has published them. */
+int collect_net_stats(void);
+
 void parse_net_stat_arg(struct text_object *, const char *, void *);
 void parse_net_stat_bar_arg(struct text_object *, const char *, void *);
-void print_downspeed(struct text_object *, char *, unsigned int);
-void print_downspeedf(struct text_object *, char *, unsigned int);
-void print_upspeed(struct text_object *, char *, unsigned int);
-void print_upspeedf(struct text_object *, char *, unsigned int);
-void print_totaldown(struct text_object *, char *, unsigned int);
-void print_totalup(struct text_object *, char *, unsigned int);
+size_t print_downspeed(struct text_object *, char *, unsigned int);
+size_t print_downspeedf(struct text_object *, char *, unsigned int);
+size_t print_upspeed(struct text_object *, char *, unsigned int);
+size_t print_upspeedf(struct text_object *, char *, unsigned int);
+size_t print_totaldown(struct text_object *, char *, unsigned int);
+size_t print_totalup(struct text_object *, char *, unsigned int);
 void print_addr(struct text_object *, char *, unsigned int);
 #ifdef __linux__
 void print_addrs(struct text_object *, char *, unsigned int);
@@ -78,9 +78,7 @@ static void rss_process_info(char *p, int p_max_size, const std::string &uri,
                              unsigned int nrspaces) {
   char *str;
 
-  uint32_t period = std::max(lround(interval / active_update_interval()), 1l);
-
-  auto cb = conky::register_cb<rss_cb>(period, uri);
+  auto cb = conky::register_timed_cb<rss_cb>(interval, uri);
 
   assert(act_par >= 0 && action);
 
@@ -697,7 +697,7 @@ void update_wlan_stats(struct net_stat *ns) {
 
 #endif /* BUILD_WLAN */
 
-int update_net_stats() {
+int collect_net_stats() {
   struct net_stat *ns;
   double delta;
   long long r, t, last_recv, last_trans;
@@ -168,7 +168,7 @@ int update_meminfo(void) {
   return 0;
 }
 
-int update_net_stats(void) {
+int collect_net_stats(void) {
   struct net_stat *ns;
   double delta;
   long long r, t, last_recv, last_trans;
@@ -588,7 +588,7 @@ int update_diskio(void) {
 
   memset(&statinfo_cur, 0, sizeof(statinfo_cur));
   statinfo_cur.dinfo = (struct devinfo *)calloc(1, sizeof(struct devinfo));
-  stats.current = stats.current_read = stats.current_write = 0;
+  reset_diskio_values(&stats);
 
   if (getdevs(&statinfo_cur) < 0) {
     free(statinfo_cur.dinfo);
@@ -71,7 +71,7 @@ int update_meminfo() {
   return 0;
 }
 
-int update_net_stats() {
+int collect_net_stats() {
   // TODO
   return 1;
 }
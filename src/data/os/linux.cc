@@ -37,8 +37,13 @@
 #include "../../conky.h"
 #include "../hardware/diskio.h"
 #include "../../logging.h"
+#include "../../update-cb.hh"
 #include "../network/net_stat.h"
 #include "../proc.h"
+#include "../process-table.hh"
+#include "proc-events.hh"
+#include "proc-fields.hh"
+#include "procfs.hh"
 #include "../../content/temphelper.h"
 #ifndef HAVE_CLOCK_GETTIME
 #include <sys/time.h>
@@ -48,6 +53,7 @@
 // #include <assert.h>
 #include <time.h>
 #include <unordered_map>
+#include <unordered_set>
 #include "../../lua/setting.hh"
 #include "../top.h"
 
@@ -113,6 +119,12 @@ char interfaces_arr[MAX_NET_INTERFACES][iface_len] = {""};
 
 static conky::simple_config_setting<bool> top_cpu_separate("top_cpu_separate",
                                                            false, true);
+static conky::simple_config_setting<bool> top_proc_events("top_proc_events",
+                                                          false, true);
+/* how long reading /proc/<pid> may take per update, 0 to read all of them */
+static conky::range_config_setting<double> top_scan_budget(
+    "top_scan_budget", 0.0, std::numeric_limits<double>::infinity(), 0.0,
+    true);
 
 /* This flag tells the linux routines to use the /proc system where possible,
  * even if other api's are available, e.g. sysinfo() or getloadavg().
@@ -176,11 +188,8 @@ int check_mount(struct text_object *obj) {
  * (that's why I'm reading them from proc) */
 
 int update_meminfo(void) {
-  FILE *meminfo_fp;
-  static int reported = 0;
-
-  /* unsigned int a; */
-  char buf[256];
+  static conky::procfs_file meminfo("/proc/meminfo");
+  char *buf;
 
   /* With multi-threading, calculations that require
    * multiple steps to reach a final result can cause havok
@@ -196,11 +205,9 @@ int update_meminfo(void) {
           info.memeasyfree = info.legacymem = info.shmem = info.memavail =
               info.free_bufcache = info.free_cached = 0;
 
-  if (!(meminfo_fp = open_file("/proc/meminfo", &reported))) { return 0; }
-
-  while (!feof(meminfo_fp)) {
-    if (fgets(buf, 255, meminfo_fp) == nullptr) { break; }
+  if (!meminfo.read()) { return 0; }
 
+  while ((buf = meminfo.next_line()) != nullptr) {
     if (strncmp(buf, "MemTotal:", 9) == 0) {
       sscanf(buf, "%*s %llu", &info.memmax);
     } else if (strncmp(buf, "MemFree:", 8) == 0) {
@@ -266,7 +273,6 @@ int update_meminfo(void) {
   info.free_cached = info.cached + sreclaimable;
   info.free_bufcache = info.free_cached + info.buffers;
 
-  fclose(meminfo_fp);
   return 0;
 }
 
@@ -488,7 +494,7 @@ void print_gateway_ip(struct text_object *obj, char *p,
   snprintf(p, p_max_size, "%s", gw_info.ip);
 }
 
-void update_net_interfaces(FILE *net_dev_fp, bool is_first_update,
+void update_net_interfaces(conky::procfs_file &net_dev, bool is_first_update,
                            double time_between_updates) {
   /* read each interface */
 #ifdef BUILD_WLAN
@@ -503,9 +509,8 @@ void update_net_interfaces(FILE *net_dev_fp, bool is_first_update,
     long long r, t, last_recv, last_trans;
 
     /* quit only after all non-header lines from /proc/net/dev parsed */
-    // FIXME: arbitrary size chosen to keep code simple.
-    char buf[256];
-    if (fgets(buf, 255, net_dev_fp) == nullptr) { break; }
+    char *buf = net_dev.next_line();
+    if (buf == nullptr) { break; }
     p = buf;
     /* change char * p to first non-space character, which is the beginning
      * of the interface name */
@@ -531,8 +536,11 @@ void update_net_interfaces(FILE *net_dev_fp, bool is_first_update,
                       Nasty memory usage... */
 
     /* bytes packets errs drop fifo frame compressed multicast|bytes ... */
-    sscanf(p, "%lld  %*d     %*d  %*d  %*d  %*d   %*d        %*d       %lld",
-           &r, &t);
+    unsigned long long fields[9] = {0};
+    const char *q = p;
+    conky::parse_uints(q, net_dev.end(), fields, 9);
+    r = fields[0];
+    t = fields[8];
 
     /* if the interface is parsed the first time, then set recv and trans
      * to currently received, meaning the change in network traffic is 0 */
@@ -774,11 +782,10 @@ void update_ipv6_net_stats() {
  * @return always returns 0. May change in the future, e.g. returning non zero
  * if some error happened
  **/
-int update_net_stats(void) {
+int collect_net_stats(void) {
   update_gateway_info();
   update_gateway_info2();
-  FILE *net_dev_fp;
-  static int reported = 0;
+  static conky::procfs_file net_dev("/proc/net/dev");
   /* variable to notify the parts averaging the download speed, that this
    * is the first call ever to this function. This variable can't be used
    * to decide if this is the first time an interface was parsed as there
@@ -786,8 +793,6 @@ int update_net_stats(void) {
    * times */
   static bool is_first_update = true;
 
-  // FIXME: arbitrary size chosen to keep code simple.
-  char buf[256];
   double time_between_updates;
 
   /* get delta */
@@ -796,22 +801,21 @@ int update_net_stats(void) {
 
   /* open file /proc/net/dev. If not something went wrong, clear all
    * network statistics */
-  if (!(net_dev_fp = open_file("/proc/net/dev", &reported))) {
+  if (!net_dev.read()) {
     clear_net_stats();
     return 0;
   }
   /* ignore first two header lines in file /proc/net/dev. If somethings
    * goes wrong, e.g. end of file reached, quit.
    * (Why isn't clear_net_stats called for this case ??? */
-  char *one = fgets(buf, 255, net_dev_fp);
-  char *two = fgets(buf, 255, net_dev_fp);
+  char *one = net_dev.next_line();
+  char *two = net_dev.next_line();
   if (!one || /* garbage */
       !two) { /* garbage (field names) */
-    fclose(net_dev_fp);
     return 0;
   }
 
-  update_net_interfaces(net_dev_fp, is_first_update, time_between_updates);
+  update_net_interfaces(net_dev, is_first_update, time_between_updates);
 
 #ifdef BUILD_IPV6
   update_ipv6_net_stats();
@@ -819,7 +823,6 @@ int update_net_stats(void) {
 
   is_first_update = false;
 
-  fclose(net_dev_fp);
   return 0;
 }
 
@@ -923,6 +926,8 @@ void determine_longstat_file(void) {
   stat_initialized = 1;
 }
 
+static int read_stat(bool only_snapshot);
+
 void get_cpu_count(void) {
   FILE *stat_fp;
   static int reported = 0;
@@ -966,40 +971,47 @@ void get_cpu_count(void) {
       if (subtoken2 > 0) info.cpu_count += subtoken2 - subtoken1;
     }
   }
-  info.cpu_usage = (float *)malloc((info.cpu_count + 1) * sizeof(float));
+  info.cpu_usage = (float *)calloc(info.cpu_count + 1, sizeof(float));
 
   fclose(stat_fp);
+
+  /* take a first snapshot right away, usually while the config is parsed,
+   * so that the first update has an interval to compute the usage over */
+  read_stat(true);
 }
 
-#define TMPL_LONGSTAT "%*s %llu %llu %llu %llu %llu %llu %llu %llu"
-#define TMPL_SHORTSTAT "%*s %llu %llu %llu %llu"
+/* how many of the jiffy counters on a cpu line of /proc/stat are read */
+#define LONGSTAT_FIELDS 8
+#define SHORTSTAT_FIELDS 4
 
-int update_stat(void) {
-  FILE *stat_fp;
-  static int reported = 0;
+/* Over less time than this the jiffy counters in /proc/stat hardly move, and
+ * the usage computed from them would be noise. */
+#define CPU_MIN_SAMPLE_INTERVAL 0.05
+
+/* when the /proc/stat snapshot in global_cpu was taken, by get_time(); 0
+ * before the first one */
+static double last_stat_sample = 0.0;
+
+/*
+ * Reads /proc/stat. Unless only_snapshot is set, CPU usage is computed from
+ * the difference to the previous snapshot, which this one replaces, i.e. over
+ * the real time between them. If that was too short, the previous usage
+ * stays. Without a previous snapshot, the usage is the one since boot.
+ */
+static int read_stat(bool only_snapshot) {
+  static conky::procfs_file stat_file("/proc/stat");
   struct cpu_info *cpu = nullptr;
-  char buf[256];
+  char *buf;
   int i;
   unsigned int idx;
   double curtmp;
-  const char *stat_template = nullptr;
+  size_t stat_fields = 0;
   unsigned int malloc_cpu_size = 0;
   extern void *global_cpu;
 
-  static pthread_mutex_t last_stat_update_mutex = PTHREAD_MUTEX_INITIALIZER;
-  static double last_stat_update = 0.0;
   float cur_total = 0.0;
-
-  /* since we use wrappers for this function, the update machinery
-   * can't eliminate double invocations of this function. Check for
-   * them here, otherwise cpu_usage counters are freaking out. */
-  pthread_mutex_lock(&last_stat_update_mutex);
-  if (last_stat_update == current_update_time) {
-    pthread_mutex_unlock(&last_stat_update_mutex);
-    return 0;
-  }
-  last_stat_update = current_update_time;
-  pthread_mutex_unlock(&last_stat_update_mutex);
+  double now = get_time();
+  bool sample;
 
   /* add check for !info.cpu_usage since that mem is freed on a SIGUSR1 */
   if (!cpu_setup || !info.cpu_usage) {
@@ -1007,10 +1019,10 @@ int update_stat(void) {
     cpu_setup = 1;
   }
 
-  if (!stat_template) {
+  if (!stat_fields) {
     determine_longstat_file();
-    stat_template =
-        KFLAG_ISSET(KFLAG_IS_LONGSTAT) ? TMPL_LONGSTAT : TMPL_SHORTSTAT;
+    stat_fields =
+        KFLAG_ISSET(KFLAG_IS_LONGSTAT) ? LONGSTAT_FIELDS : SHORTSTAT_FIELDS;
   }
 
   if (global_cpu) {
@@ -1020,9 +1032,13 @@ int update_stat(void) {
     cpu = (struct cpu_info *)malloc(malloc_cpu_size);
     memset(cpu, 0, malloc_cpu_size);
     global_cpu = cpu;
+    last_stat_sample = 0.0;
   }
+  sample = !only_snapshot &&
+           (last_stat_sample == 0.0 ||
+            now - last_stat_sample >= CPU_MIN_SAMPLE_INTERVAL);
 
-  if (!(stat_fp = open_file("/proc/stat", &reported))) {
+  if (!stat_file.read()) {
     info.run_threads = 0;
     if (info.cpu_usage) {
       memset(info.cpu_usage, 0, info.cpu_count * sizeof(float));
@@ -1031,23 +1047,29 @@ int update_stat(void) {
   }
 
   idx = 0;
-  while (!feof(stat_fp)) {
-    if (fgets(buf, 255, stat_fp) == nullptr) { break; }
-
+  while ((buf = stat_file.next_line()) != nullptr) {
     if (strncmp(buf, "procs_running ", 14) == 0) {
-      sscanf(buf, "%*s %hu", &info.run_threads);
+      const char *p = buf + 14;
+      unsigned long long running;
+      if (conky::parse_uints(p, stat_file.end(), &running, 1) == 1) {
+        info.run_threads = running;
+      }
     } else if (strncmp(buf, "cpu", 3) == 0) {
-      double delta;
       if (isdigit((unsigned char)buf[3])) {
         idx++;  // just increment here since the CPU index can skip numbers
       } else {
         idx = 0;
       }
       if (idx > info.cpu_count) { continue; }
-      sscanf(buf, stat_template, &(cpu[idx].cpu_user), &(cpu[idx].cpu_nice),
-             &(cpu[idx].cpu_system), &(cpu[idx].cpu_idle),
-             &(cpu[idx].cpu_iowait), &(cpu[idx].cpu_irq),
-             &(cpu[idx].cpu_softirq), &(cpu[idx].cpu_steal));
+      /* user nice system idle iowait irq softirq steal */
+      unsigned long long jiffies[LONGSTAT_FIELDS];
+      const char *p = conky::skip_fields(buf, stat_file.end(), 1);
+      size_t n = conky::parse_uints(p, stat_file.end(), jiffies, stat_fields);
+      unsigned long long *counters[LONGSTAT_FIELDS] = {
+          &cpu[idx].cpu_user,    &cpu[idx].cpu_nice,   &cpu[idx].cpu_system,
+          &cpu[idx].cpu_idle,    &cpu[idx].cpu_iowait, &cpu[idx].cpu_irq,
+          &cpu[idx].cpu_softirq, &cpu[idx].cpu_steal};
+      for (size_t j = 0; j < n; ++j) { *counters[j] = jiffies[j]; }
 
       cpu[idx].cpu_total = cpu[idx].cpu_user + cpu[idx].cpu_nice +
                            cpu[idx].cpu_system + cpu[idx].cpu_idle +
@@ -1057,9 +1079,12 @@ int update_stat(void) {
       cpu[idx].cpu_active_total =
           cpu[idx].cpu_total - (cpu[idx].cpu_idle + cpu[idx].cpu_iowait);
 
-      delta = current_update_time - last_update_time;
-
-      if (delta <= 0.001) { break; }
+      if (only_snapshot) {
+        cpu[idx].cpu_last_total = cpu[idx].cpu_total;
+        cpu[idx].cpu_last_active_total = cpu[idx].cpu_active_total;
+        continue;
+      }
+      if (!sample) { continue; }
 
       cur_total = (float)(cpu[idx].cpu_total - cpu[idx].cpu_last_total);
       if (cur_total == 0.0) {
@@ -1082,22 +1107,29 @@ int update_stat(void) {
       }
     }
   }
-  fclose(stat_fp);
+  if (sample || only_snapshot) { last_stat_sample = now; }
   return 0;
 }
 
+int update_stat(void) {
+  static double last_stat_update = 0.0;
+
+  /* since we use wrappers for this function, the update machinery
+   * can't eliminate double invocations of this function. Check for
+   * them here, otherwise cpu_usage counters are freaking out. The wrappers
+   * all declare INFO_CPU, so they never run at the same time. */
+  if (last_stat_update == current_update_time) { return 0; }
+  last_stat_update = current_update_time;
+
+  return read_stat(false);
+}
+
 int update_running_processes(void) {
   update_stat();
   return 0;
 }
 
 int update_cpu_usage(void) {
-  struct timespec tc = {0L, 100L * 1000000L};
-  update_stat();
-  if (-1 == (nanosleep(&tc, NULL))) {
-    NORM_ERR("update_cpu_usage(): nanosleep() failed");
-    return 0;
-  }
   update_stat();
   return 0;
 }
@@ -1105,9 +1137,9 @@ int update_cpu_usage(void) {
 void free_cpu(struct text_object *) { /* no-op */
 }
 
-// fscanf() that reads floats with points even if you are using a locale where
+// sscanf() that reads floats with points even if you are using a locale where
 // floats are with commas
-int fscanf_no_i18n(FILE *stream, const char *format, ...) {
+int sscanf_no_i18n(const char *str, const char *format, ...) {
   int returncode;
   va_list ap;
 
@@ -1117,7 +1149,7 @@ int fscanf_no_i18n(FILE *stream, const char *format, ...) {
   setlocale(LC_NUMERIC, "C");
 #endif
   va_start(ap, format);
-  returncode = vfscanf(stream, format, ap);
+  returncode = vsscanf(str, format, ap);
   va_end(ap);
 #ifdef BUILD_I18N
   setlocale(LC_NUMERIC, oldlocale);
@@ -1138,17 +1170,16 @@ int update_load_average(void) {
   } else
 #endif
   {
-    static int reported = 0;
-    FILE *fp;
+    static conky::procfs_file loadavg("/proc/loadavg");
 
-    if (!(fp = open_file("/proc/loadavg", &reported))) {
+    if (!loadavg.read()) {
       info.loadavg[0] = info.loadavg[1] = info.loadavg[2] = 0.0;
       return 0;
     }
-    if (fscanf_no_i18n(fp, "%f %f %f", &info.loadavg[0], &info.loadavg[1],
+    if (sscanf_no_i18n(loadavg.contents().data(), "%f %f %f",
+                       &info.loadavg[0], &info.loadavg[1],
                        &info.loadavg[2]) < 0)
       info.loadavg[0] = info.loadavg[1] = info.loadavg[2] = 0.0;
-    fclose(fp);
   }
   return 0;
 }
@@ -2729,7 +2760,7 @@ std::unordered_map<std::string, bool> dev_list;
 /* Same as sf #2942117 but memoized using a linked list */
 int is_disk(char *dev) {
   std::string orig(dev);
-  std::string syspath("/sys/block/");
+  std::string syspath = conky::procfs_path("/sys/block/");
   char *slash;
 
   auto i = dev_list.find(orig);
@@ -2742,41 +2773,53 @@ int is_disk(char *dev) {
 }
 
 int update_diskio(void) {
-  FILE *fp;
-  static int reported = 0;
-  char buf[512], devbuf[64];
-  unsigned int major, minor;
-  int col_count = 0;
+  static conky::procfs_file diskstats("/proc/diskstats");
+  char *buf, devbuf[64];
+  unsigned int major;
+  size_t col_count = 0;
   struct diskio_stat *cur;
   unsigned int reads, writes;
   unsigned int total_reads = 0, total_writes = 0;
 
-  stats.current = 0;
-  stats.current_read = 0;
-  stats.current_write = 0;
-
-  if (!(fp = open_file("/proc/diskstats", &reported))) { return 0; }
+  if (!diskstats.read()) {
+    reset_diskio_values(&stats);
+    return 0;
+  }
 
   /* read reads and writes from all disks (minor = 0), including cd-roms
    * and floppies, and sum them up */
-  while (fgets(buf, 512, fp)) {
-    col_count = sscanf(buf, "%u %u %s %*u %*u %u %*u %*u %*u %u", &major,
-                       &minor, devbuf, &reads, &writes);
+  while ((buf = diskstats.next_line()) != nullptr) {
+    /* major minor name, then reads merged sectors ms writes ... for disks,
+     * or, on old kernels, reads sectors writes sectors for partitions */
+    unsigned long long numbers[7];
+    const char *p = buf;
+    if (conky::parse_uints(p, diskstats.end(), numbers, 2) != 2) { continue; }
+    major = numbers[0];
+    size_t name_length = conky::next_field(p, diskstats.end());
+    if (name_length == 0) { continue; }
+    name_length = std::min(name_length, sizeof(devbuf) - 1);
+    memcpy(devbuf, p, name_length);
+    devbuf[name_length] = '\0';
+    p += name_length;
+    col_count = conky::parse_uints(p, diskstats.end(), numbers, 7);
+
     /* ignore subdevices (they have only 3 matching entries in their line)
      * and virtual devices (LVM, network block devices, RAM disks, Loopback)
      *
      * XXX: ignore devices which are part of a SW RAID (MD_MAJOR) */
-    if (col_count == 5 && major != LVM_BLK_MAJOR && major != NBD_MAJOR &&
+    if (col_count == 7 && major != LVM_BLK_MAJOR && major != NBD_MAJOR &&
         major != RAMDISK_MAJOR && major != LOOP_MAJOR && major != DM_MAJOR) {
+      reads = numbers[2];
+      writes = numbers[6];
       /* check needed for kernel >= 2.6.31, see sf #2942117 */
       if (is_disk(devbuf)) {
         total_reads += reads;
         total_writes += writes;
       }
     } else {
-      col_count = sscanf(buf, "%u %u %s %*u %u %*u %u", &major, &minor, devbuf,
-                         &reads, &writes);
-      if (col_count != 5) { continue; }
+      if (col_count < 4) { continue; }
+      reads = numbers[1];
+      writes = numbers[3];
     }
     cur = stats.next;
     while (cur && strcmp(devbuf, cur->dev)) cur = cur->next;
@@ -2784,7 +2827,6 @@ int update_diskio(void) {
     if (cur) update_diskio_values(cur, reads, writes);
   }
   update_diskio_values(&stats, total_reads, total_writes);
-  fclose(fp);
   return 0;
 }
 
@@ -2873,35 +2915,27 @@ void print_distribution(struct text_object * /*obj*/, char *p,
 /******************************************
  * Calculate cpu total					  *
  ******************************************/
-#define TMPL_SHORTPROC "%*s %llu %llu %llu %llu"
-#define TMPL_LONGPROC "%*s %llu %llu %llu %llu %llu %llu %llu %llu"
 
-static unsigned long long calc_cpu_total(void) {
+/* The sum of calc_cpu_total() over all updates, which is when each process
+ * was read, see process_table::read_at. */
+static unsigned long long cpu_ticks = 0;
+
+unsigned long long calc_cpu_total(void) {
   static unsigned long long previous_total = 0;
   unsigned long long total = 0;
   unsigned long long t = 0;
-  int rc;
-  int ps;
-  char line[BUFFER_LEN] = {0};
-  unsigned long long cpu = 0;
-  unsigned long long niceval = 0;
-  unsigned long long systemval = 0;
-  unsigned long long idle = 0;
-  unsigned long long iowait = 0;
-  unsigned long long irq = 0;
-  unsigned long long softirq = 0;
-  unsigned long long steal = 0;
-  const char *template_ =
-      KFLAG_ISSET(KFLAG_IS_LONGSTAT) ? TMPL_LONGPROC : TMPL_SHORTPROC;
+  static conky::procfs_file stat_file("/proc/stat");
+  unsigned long long jiffies[LONGSTAT_FIELDS];
+  size_t fields =
+      KFLAG_ISSET(KFLAG_IS_LONGSTAT) ? LONGSTAT_FIELDS : SHORTSTAT_FIELDS;
 
-  ps = open("/proc/stat", O_RDONLY);
-  rc = read(ps, line, BUFFER_LEN - 1);
-  close(ps);
-  if (rc < 0) { return 0; }
+  if (!stat_file.read()) { return 0; }
 
-  sscanf(line, template_, &cpu, &niceval, &systemval, &idle, &iowait, &irq,
-         &softirq, &steal);
-  total = cpu + niceval + systemval + idle + iowait + irq + softirq + steal;
+  /* the first line is the one for all CPUs */
+  const char *p = conky::skip_fields(stat_file.contents().data(),
+                                     stat_file.end(), 1);
+  fields = conky::parse_uints(p, stat_file.end(), jiffies, fields);
+  for (size_t i = 0; i < fields; ++i) { total += jiffies[i]; }
 
   t = total - previous_total;
   previous_total = total;
@@ -2913,24 +2947,31 @@ static unsigned long long calc_cpu_total(void) {
  * Calculate each processes cpu			  *
  ******************************************/
 
-inline static void calc_cpu_each(unsigned long long total) {
+inline static void calc_cpu_each(void) {
   float mul = 100.0;
   if (top_cpu_separate.get(*state)) mul *= info.cpu_count;
-
-  for (struct process *p = first_process; p; p = p->next)
-    p->amount = mul * (p->user_time + p->kernel_time) / (float)total;
+  conky::calc_cpu_amounts(top_processes(), mul);
 }
 
 #ifdef BUILD_IOSTATS
 static void calc_io_each(void) {
-  struct process *p;
-  unsigned long long sum = 0;
+  conky::process_table &table = top_processes();
+  const unsigned long long *read = table.read_bytes.data();
+  const unsigned long long *write = table.write_bytes.data();
+  const unsigned long long *interval = table.interval.data();
+  float *io_perc = table.io_perc.data();
+  size_t n = table.size();
+  float sum = 0;
 
-  for (p = first_process; p; p = p->next) sum += p->read_bytes + p->write_bytes;
+  /* the I/O per cpu tick, see calc_cpu_each() */
+  for (size_t i = 0; i < n; ++i) {
+    io_perc[i] = (read[i] + write[i]) / (float)std::max(interval[i], 1ULL);
+    sum += io_perc[i];
+  }
 
   if (sum == 0) sum = 1; /* to avoid having NANs if no I/O occurred */
-  for (p = first_process; p; p = p->next)
-    p->io_perc = 100.0 * (p->read_bytes + p->write_bytes) / (float)sum;
+  float mul = 100.0 / sum;
+  for (size_t i = 0; i < n; ++i) io_perc[i] *= mul;
 }
 #endif /* BUILD_IOSTATS */
 
@@ -2941,57 +2982,27 @@ static void calc_io_each(void) {
 #define PROCFS_TEMPLATE "/proc/%d/stat"
 #define PROCFS_CMDLINE_TEMPLATE "/proc/%d/cmdline"
 
-/* These are the guts that extract information out of /proc.
- * Anyone hoping to port wmtop should look here first. */
-static void process_parse_stat(struct process *process) {
-  char line[BUFFER_LEN] = {0}, filename[BUFFER_LEN], procname[BUFFER_LEN];
-  char cmdline[BUFFER_LEN] = {0}, cmdline_filename[BUFFER_LEN],
-       cmdline_procname[BUFFER_LEN];
-  char basename[BUFFER_LEN] = {0};
+/* Reads /proc/<pid>/cmdline into name, turned into what top shows: the
+ * command without its directory, and its arguments. Returns false if the
+ * file can't be read. */
+static bool read_cmdline_name(pid_t pid, char *name) {
+  char cmdline[BUFFER_LEN] = {0}, cmdline_filename[BUFFER_LEN];
   char tmpstr[BUFFER_LEN] = {0};
-  char state[4];
-  int ps, cmdline_ps;
-  unsigned long user_time = 0;
-  unsigned long kernel_time = 0;
-  int rc;
+  int cmdline_ps;
   int endl;
-  int nice_val;
-  char *lparen, *rparen;
-  struct stat process_stat;
 
-  snprintf(filename, sizeof(filename), PROCFS_TEMPLATE, process->pid);
   snprintf(cmdline_filename, sizeof(cmdline_filename), PROCFS_CMDLINE_TEMPLATE,
-           process->pid);
-
-  ps = open(filename, O_RDONLY);
-  if (ps == -1) {
-    /* The process must have finished in the last few jiffies! */
-    return;
-  }
-
-  if (fstat(ps, &process_stat) != 0) {
-    close(ps);
-    return;
-  }
-  process->uid = process_stat.st_uid;
-
-  /* Mark process as up-to-date. */
-  process->time_stamp = g_time;
-
-  rc = read(ps, line, BUFFER_LEN - 1);
-  close(ps);
-  if (rc < 0) { return; }
+           pid);
 
-  /* Read /proc/<pid>/cmdline */
   cmdline_ps = open(cmdline_filename, O_RDONLY);
   if (cmdline_ps < 0) {
     /* The process must have finished in the last few jiffies! */
-    return;
+    return false;
   }
 
   endl = read(cmdline_ps, cmdline, BUFFER_LEN - 1);
   close(cmdline_ps);
-  if (endl < 0) { return; }
+  if (endl < 0) { return false; }
 
   /* Some processes have null-separated arguments (see proc(5)); let's fix it */
   int i = endl;
@@ -3023,76 +3034,116 @@ static void process_parse_stat(struct process *process) {
 
   char *slash_ptr = strrchr(tmpstr, '/');
   if (slash_ptr == nullptr) {
-    strncpy(cmdline_procname, cmdline, BUFFER_LEN);
+    strncpy(name, cmdline, BUFFER_LEN);
   } else {
     long int slash_pos = slash_ptr - tmpstr;
-    strncpy(cmdline_procname, cmdline + slash_pos + 1,
-            BUFFER_LEN - slash_pos - 1);
-    cmdline_procname[BUFFER_LEN - slash_pos - 1] = 0;
+    strncpy(name, cmdline + slash_pos + 1, BUFFER_LEN - slash_pos - 1);
+    name[BUFFER_LEN - slash_pos - 1] = 0;
   }
+  return true;
+}
+
+/* These are the guts that extract information out of /proc.
+ * Anyone hoping to port wmtop should look here first.
+ * Returns whether the process is running. It only touches its slot of
+ * table, so processes can be parsed at the same time, see
+ * update_process_table(). */
+static bool process_parse_stat(conky::process_table &table, size_t slot) {
+  char line[BUFFER_LEN] = {0}, filename[BUFFER_LEN], procname[BUFFER_LEN];
+  char state[4];
+  int ps;
+  int rc;
+  char *lparen, *rparen;
+  struct stat process_stat;
+  struct process *view = table.views[slot];
+
+  snprintf(filename, sizeof(filename), PROCFS_TEMPLATE, table.pid[slot]);
+
+  ps = open(filename, O_RDONLY);
+  if (ps == -1) {
+    /* The process must have finished in the last few jiffies! */
+    return false;
+  }
+
+  if (fstat(ps, &process_stat) != 0) {
+    close(ps);
+    return false;
+  }
+  table.uid[slot] = process_stat.st_uid;
+
+  /* Mark process as up-to-date. */
+  table.time_stamp[slot] = g_time;
+
+  rc = read(ps, line, BUFFER_LEN - 1);
+  close(ps);
+  if (rc < 0) { return false; }
 
   /* Extract cpu times from data in /proc filesystem */
   lparen = strchr(line, '(');
   rparen = strrchr(line, ')');
-  if (!lparen || !rparen || rparen < lparen) return;  // this should not happen
+  if (!lparen || !rparen || rparen < lparen) {
+    return false;  // this should not happen
+  }
 
   rc = MIN((unsigned)(rparen - lparen - 1), sizeof(procname) - 1);
   strncpy(procname, lparen + 1, rc);
   procname[rc] = '\0';
-  strncpy(basename, procname, strlen(procname) + 1);
-
-  if (strlen(procname) < strlen(cmdline_procname))
-    strncpy(procname, cmdline_procname, strlen(cmdline_procname) + 1);
 
-  rc = sscanf(rparen + 1,
-              "%3s %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %lu "
-              "%lu %*s %*s %*s %d %*s %*s %*s %llu %llu",
-              state, &process->user_time, &process->kernel_time, &nice_val,
-              &process->vsize, &process->rss);
-  if (rc < 6) {
+  /* state ppid pgrp session tty_nr tpgid flags minflt cminflt majflt
+   * cmajflt utime stime cutime cstime priority nice num_threads
+   * itrealvalue starttime vsize rss */
+  const char *end = rparen + strlen(rparen);
+  const char *p = rparen + 1;
+  unsigned long long times[2], tail[3];
+  long long nice;
+  size_t state_length = conky::next_field(p, end);
+  state_length = std::min(state_length, sizeof(state) - 1);
+  memcpy(state, p, state_length);
+  state[state_length] = '\0';
+  p = conky::skip_fields(p, end, 11);
+  rc = state_length > 0 ? 1 : 0;
+  rc += conky::parse_uints(p, end, times, 2);
+  p = conky::skip_fields(p, end, 3);
+  rc += conky::parse_ints(p, end, &nice, 1);
+  p = conky::skip_fields(p, end, 2);
+  rc += conky::parse_uints(p, end, tail, 3);
+  if (rc < 7) {
     NORM_ERR("scanning data for %s failed, got only %d fields", procname, rc);
-    return;
+    return false;
   }
 
-  if (state[0] == 'R') ++info.run_procs;
-
-  free_and_zero(process->name);
-  free_and_zero(process->basename);
-  process->name = strndup(procname, text_buffer_size.get(*::state));
-  process->basename = strndup(basename, text_buffer_size.get(*::state));
-  process->rss *= getpagesize();
+  /* The names only change when the process execs, which gives it a new
+   * comm, or when its pid was reused, by a process with another starttime.
+   * Until then cmdline isn't read again. */
+  if (view->name == nullptr || table.starttime[slot] != tail[0] ||
+      strcmp(view->basename, procname) != 0) {
+    char cmdline_procname[BUFFER_LEN];
+    if (!read_cmdline_name(table.pid[slot], cmdline_procname)) {
+      return false;
+    }
 
-  process->total_cpu_time = process->user_time + process->kernel_time;
-  if (process->previous_user_time == ULONG_MAX) {
-    process->previous_user_time = process->user_time;
-  }
-  if (process->previous_kernel_time == ULONG_MAX) {
-    process->previous_kernel_time = process->kernel_time;
+    free_and_zero(view->name);
+    free_and_zero(view->basename);
+    view->basename = strndup(procname, text_buffer_size.get(*::state));
+    if (strlen(procname) < strlen(cmdline_procname)) {
+      view->name =
+          strndup(cmdline_procname, text_buffer_size.get(*::state));
+    } else {
+      view->name = strndup(procname, text_buffer_size.get(*::state));
+    }
+    table.starttime[slot] = tail[0];
   }
 
-  /* strangely, the values aren't monotonous */
-  if (process->previous_user_time > process->user_time)
-    process->previous_user_time = process->user_time;
+  table.vsize[slot] = tail[1];
+  table.rss[slot] = tail[2] * getpagesize();
+  table.record_times(slot, times[0], times[1], cpu_ticks);
 
-  if (process->previous_kernel_time > process->kernel_time)
-    process->previous_kernel_time = process->kernel_time;
-
-  /* store the difference of the user_time */
-  user_time = process->user_time - process->previous_user_time;
-  kernel_time = process->kernel_time - process->previous_kernel_time;
-
-  /* backup the process->user_time for next time around */
-  process->previous_user_time = process->user_time;
-  process->previous_kernel_time = process->kernel_time;
-
-  /* store only the difference of the user_time here... */
-  process->user_time = user_time;
-  process->kernel_time = kernel_time;
+  return state[0] == 'R';
 }
 
 #ifdef BUILD_IOSTATS
 #define PROCFS_TEMPLATE_IO "/proc/%d/io"
-static void process_parse_io(struct process *process) {
+static void process_parse_io(conky::process_table &table, size_t slot) {
   static const char *read_bytes_str = "read_bytes:";
   static const char *write_bytes_str = "write_bytes:";
 
@@ -3102,7 +3153,7 @@ static void process_parse_io(struct process *process) {
   char *pos, *endpos;
   unsigned long long read_bytes, write_bytes;
 
-  snprintf(filename, sizeof(filename), PROCFS_TEMPLATE_IO, process->pid);
+  snprintf(filename, sizeof(filename), PROCFS_TEMPLATE_IO, table.pid[slot]);
 
   ps = open(filename, O_RDONLY);
   if (ps < 0) {
@@ -3122,33 +3173,33 @@ static void process_parse_io(struct process *process) {
     return;
   }
   pos += strlen(read_bytes_str);
-  process->read_bytes = strtoull(pos, &endpos, 10);
+  table.read_bytes[slot] = strtoull(pos, &endpos, 10);
   if (endpos == pos) { return; }
 
   pos = strstr(line, write_bytes_str);
   if (pos == nullptr) { return; }
   pos += strlen(write_bytes_str);
-  process->write_bytes = strtoull(pos, &endpos, 10);
+  table.write_bytes[slot] = strtoull(pos, &endpos, 10);
   if (endpos == pos) { return; }
 
-  if (process->previous_read_bytes == ULLONG_MAX) {
-    process->previous_read_bytes = process->read_bytes;
+  if (table.previous_read_bytes[slot] == ULLONG_MAX) {
+    table.previous_read_bytes[slot] = table.read_bytes[slot];
   }
-  if (process->previous_write_bytes == ULLONG_MAX) {
-    process->previous_write_bytes = process->write_bytes;
+  if (table.previous_write_bytes[slot] == ULLONG_MAX) {
+    table.previous_write_bytes[slot] = table.write_bytes[slot];
   }
 
   /* store the difference of the byte counts */
-  read_bytes = process->read_bytes - process->previous_read_bytes;
-  write_bytes = process->write_bytes - process->previous_write_bytes;
+  read_bytes = table.read_bytes[slot] - table.previous_read_bytes[slot];
+  write_bytes = table.write_bytes[slot] - table.previous_write_bytes[slot];
 
   /* backup the counts for next time around */
-  process->previous_read_bytes = process->read_bytes;
-  process->previous_write_bytes = process->write_bytes;
+  table.previous_read_bytes[slot] = table.read_bytes[slot];
+  table.previous_write_bytes[slot] = table.write_bytes[slot];
 
   /* store only the difference here... */
-  process->read_bytes = read_bytes;
-  process->write_bytes = write_bytes;
+  table.read_bytes[slot] = read_bytes;
+  table.write_bytes[slot] = write_bytes;
 }
 #endif /* BUILD_IOSTATS */
 
@@ -3158,12 +3209,13 @@ static void process_parse_io(struct process *process) {
 
 /* This function seems to hog all of the CPU time.
  * I can't figure out why - it doesn't do much. */
-static void calculate_stats(struct process *process) {
+static bool calculate_stats(conky::process_table &table, size_t slot) {
   /* compute each process cpu usage by reading /proc/<proc#>/stat */
-  process_parse_stat(process);
+  bool running = process_parse_stat(table, slot);
+  table.running[slot] = running;
 
 #ifdef BUILD_IOSTATS
-  process_parse_io(process);
+  process_parse_io(table, slot);
 #endif /* BUILD_IOSTATS */
 
   /*
@@ -3172,39 +3224,160 @@ static void calculate_stats(struct process *process) {
   /* if (process->counted && exclusion_expression &&
    * !regexec(exclusion_expression, process->name, 0, 0, 0))
    * process->counted = 0; */
+
+  return running;
 }
 
 /******************************************
  * Update process table					  *
  ******************************************/
 
-static void update_process_table(void) {
+/* Even with process events, /proc is listed again this often (in seconds),
+ * in case the kernel didn't send some without saying so. */
+#define PROC_EVENTS_RESCAN_INTERVAL 60.0
+
+/* Calls fn with the pid of every process in /proc. */
+template <typename Fn>
+static void for_each_pid(Fn fn) {
   DIR *dir;
   struct dirent *entry;
 
   if (!(dir = opendir("/proc"))) { return; }
 
-  info.run_procs = 0;
-
-  /* Get list of processes from /proc directory */
   while ((entry = readdir(dir))) {
     pid_t pid;
 
-    if (sscanf(entry->d_name, "%d", &pid) > 0) {
-      /* compute each process cpu usage */
-      calculate_stats(get_process(pid));
-    }
+    if (sscanf(entry->d_name, "%d", &pid) > 0) { fn(pid); }
   }
 
   closedir(dir);
 }
 
-void get_top_info(void) {
-  unsigned long long total = 0;
+/* How many processes one piece of calculate_all_stats() parses. Enough to
+ * make handing out pieces cheap, few enough to spread a few hundred
+ * processes over some threads. */
+#define PROCESSES_PER_SHARD 32
+
+/* Runs calculate_stats() on the processes in slots, in shards spread over
+ * the callback pool. Returns how many of them are running. */
+static unsigned int calculate_all_stats(const std::vector<size_t> &slots) {
+  conky::process_table &table = top_processes();
+  size_t shards =
+      (slots.size() + PROCESSES_PER_SHARD - 1) / PROCESSES_PER_SHARD;
+  std::atomic<unsigned int> running{0};
+
+  conky::run_parallel(shards, [&table, &slots, &running](size_t shard) {
+    size_t begin = shard * PROCESSES_PER_SHARD;
+    size_t end = std::min(begin + PROCESSES_PER_SHARD, slots.size());
+    unsigned int n = 0;
+    for (size_t i = begin; i < end; ++i) {
+      n += calculate_stats(table, slots[i]);
+    }
+    running += n;
+  });
+  return running;
+}
+
+/* Picks the processes in slots which are read this update under
+ * top_scan_budget, see conky::pick_processes(), with those top showed last
+ * update always among them. Returns how many of the rest are running. */
+static unsigned int pick_processes(const std::vector<size_t> &slots,
+                                   size_t count, std::vector<size_t> &picked) {
+  conky::process_table &table = top_processes();
+  static std::vector<size_t> shown;
+
+  shown.clear();
+  auto add_shown = [&table](struct process **list, int n) {
+    for (int i = 0; i < n && list[i] != nullptr; ++i) {
+      size_t slot = table.find(list[i]->pid);
+      if (slot < table.size()) { shown.push_back(slot); }
+    }
+  };
+  add_shown(info.cpu, top_cpu);
+  add_shown(info.memu, top_mem);
+  add_shown(info.time, top_time);
+#ifdef BUILD_IOSTATS
+  add_shown(info.io, top_io);
+#endif /* BUILD_IOSTATS */
+  std::sort(shown.begin(), shown.end());
 
-  total = calc_cpu_total(); /* calculate the total of the processor */
-  update_process_table();   /* update the table with process list */
-  calc_cpu_each(total);     /* and then the percentage for each task */
+  return conky::pick_processes(table, slots, shown, count,
+                               PROCESSES_PER_SHARD, g_time, picked);
+}
+
+/* Reads the processes in slots, or with top_scan_budget as many as can be
+ * read in that time, judging by the last update. Returns how many are
+ * running. */
+static unsigned int scan_processes(const std::vector<size_t> &slots) {
+  /* seconds it takes to read a process */
+  static double cost = 0.0;
+  static std::vector<size_t> picked;
+  double budget = top_scan_budget.get(*state);
+
+  if (budget == 0.0) {
+    cost = 0.0;
+    return calculate_all_stats(slots);
+  }
+
+  /* the first time, all are read, to know them all and what that costs */
+  size_t count = slots.size();
+  if (cost > 0.0 && budget / cost < count) { count = budget / cost; }
+  unsigned int running = pick_processes(slots, count, picked);
+
+  double start = get_time();
+  running += calculate_all_stats(picked);
+  if (!picked.empty()) {
+    double took = (get_time() - start) / picked.size();
+    cost = cost > 0.0 ? (cost + took) / 2 : took;
+  }
+  return running;
+}
+
+static void update_process_table(void) {
+  static conky::proc_events events;
+  static std::unordered_set<pid_t> pids;
+  static double last_scan = 0.0;
+  conky::process_table &table = top_processes();
+  /* adding processes may move the arrays, so it is done up front */
+  static std::vector<size_t> slots;
+
+  slots.clear();
+
+  if (top_proc_events.get(*state)) {
+    events.start();
+  } else if (events.listening()) {
+    events.stop();
+    pids.clear();
+  }
+
+  if (!events.listening()) {
+    for_each_pid([&table](pid_t pid) { slots.push_back(table.slot_of(pid)); });
+    /* compute each process cpu usage */
+    info.run_procs = scan_processes(slots);
+    return;
+  }
+
+  double now = get_time();
+  if (!events.update(pids) || now - last_scan >= PROC_EVENTS_RESCAN_INTERVAL) {
+    pids.clear();
+    for_each_pid([](pid_t pid) { pids.insert(pid); });
+    last_scan = now;
+  }
+
+  for (pid_t pid : pids) { slots.push_back(table.slot_of(pid)); }
+  info.run_procs = scan_processes(slots);
+
+  /* gone, and its exit event missed */
+  for (size_t slot : slots) {
+    if (table.time_stamp[slot] != g_time) { pids.erase(table.pid[slot]); }
+  }
+}
+
+void get_top_info(void) {
+  /* calculate the total of the processor */
+  cpu_ticks += calc_cpu_total();
+  update_process_table(); /* update the table with process list */
+  calc_cpu_each();        /* and then the percentage for each task */
 #ifdef BUILD_IOSTATS
   calc_io_each(); /* percentage of I/O for each task */
 #endif            /* BUILD_IOSTATS */
@@ -55,6 +55,8 @@ int get_entropy_avail(unsigned int *);
 int get_entropy_poolsize(unsigned int *);
 
 int update_stat(void);
+/* the jiffies of all CPUs in /proc/stat since the previous call */
+unsigned long long calc_cpu_total(void);
 
 void print_distribution(struct text_object *, char *, unsigned int);
 
@@ -89,7 +89,7 @@ int update_meminfo() {
   return 1;
 }
 
-int update_net_stats() {
+int collect_net_stats() {
   int i;
   double delta;
   struct ifnet ifnet;
@@ -107,7 +107,7 @@ int update_meminfo() {
   return 1;
 }
 
-int update_net_stats() {
+int collect_net_stats() {
   struct net_stat *ns;
   double delta;
   long long r, t, last_recv, last_trans;
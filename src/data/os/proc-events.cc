@@ -0,0 +1,179 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (C) 2010 Pavel Labath et al.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "proc-events.hh"
+
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include "../../logging.h"
+
+namespace conky {
+namespace {
+/* The values of proc_event::what that matter here. The enum is declared
+ * inside proc_event by older kernel headers and outside by newer ones. */
+const uint32_t EVENT_FORK = 0x00000001;
+const uint32_t EVENT_EXIT = 0x80000000;
+
+/* inode numbers of the initial namespaces, see include/linux/proc_ns.h */
+const ino_t INIT_USER_NS_INO = 0xEFFFFFFD;
+const ino_t INIT_PID_NS_INO = 0xEFFFFFFC;
+
+/* How much the kernel may queue between updates. Forks and exits come in
+ * bursts, e.g. from a build; what doesn't fit costs a scan of /proc. */
+const int RECEIVE_BUFFER = 1 << 20;
+
+bool in_namespace(const char *path, ino_t ino) {
+  struct stat st;
+  return stat(path, &st) == 0 && st.st_ino == ino;
+}
+
+bool send_op(int fd, enum proc_cn_mcast_op op) {
+  char buf[NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(op))] = {0};
+  auto *header = reinterpret_cast<struct nlmsghdr *>(buf);
+  header->nlmsg_len = NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(op));
+  header->nlmsg_type = NLMSG_DONE;
+
+  auto *message = static_cast<struct cn_msg *>(NLMSG_DATA(header));
+  message->id.idx = CN_IDX_PROC;
+  message->id.val = CN_VAL_PROC;
+  message->len = sizeof(op);
+  memcpy(message->data, &op, sizeof(op));
+
+  return send(fd, buf, header->nlmsg_len, 0) >= 0;
+}
+}  // namespace
+
+bool proc_events::start() {
+  if (fd >= 0) { return true; }
+  if (failed) { return false; }
+  failed = true;
+
+  if (!in_namespace("/proc/self/ns/user", INIT_USER_NS_INO) ||
+      !in_namespace("/proc/self/ns/pid", INIT_PID_NS_INO)) {
+    NORM_ERR(
+        "top_proc_events: process events are only sent to the initial "
+        "namespaces, scanning /proc instead");
+    return false;
+  }
+
+  fd = socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+              NETLINK_CONNECTOR);
+  if (fd < 0) {
+    NORM_ERR("top_proc_events: can't open a netlink socket: %s",
+             strerror(errno));
+    return false;
+  }
+
+  struct sockaddr_nl addr = {};
+  addr.nl_family = AF_NETLINK;
+  addr.nl_groups = CN_IDX_PROC;
+  int size = RECEIVE_BUFFER;
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+  if (bind(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0 ||
+      !send_op(fd, PROC_CN_MCAST_LISTEN)) {
+    NORM_ERR("top_proc_events: can't listen to process events: %s",
+             strerror(errno));
+    close(fd);
+    fd = -1;
+    return false;
+  }
+
+  failed = false;
+  lost = true; /* nothing is known yet */
+  return true;
+}
+
+void proc_events::stop() {
+  if (fd < 0) { return; }
+  send_op(fd, PROC_CN_MCAST_IGNORE);
+  close(fd);
+  fd = -1;
+}
+
+bool proc_events::update(std::unordered_set<pid_t> &pids) {
+  if (fd < 0) { return false; }
+
+  alignas(struct nlmsghdr) char buf[8192];
+  for (;;) {
+    struct sockaddr_nl from = {};
+    socklen_t from_length = sizeof(from);
+    ssize_t n = recvfrom(fd, buf, sizeof(buf), 0,
+                         reinterpret_cast<struct sockaddr *>(&from),
+                         &from_length);
+    if (n < 0) {
+      if (errno == EINTR) { continue; }
+      /* the kernel dropped what didn't fit into the socket buffer */
+      if (errno == ENOBUFS) {
+        lost = true;
+        continue;
+      }
+      break; /* EAGAIN: all read */
+    }
+    if (from.nl_pid != 0) { continue; } /* not from the kernel */
+
+    auto *header = reinterpret_cast<struct nlmsghdr *>(buf);
+    for (int left = n; NLMSG_OK(header, left);
+         header = NLMSG_NEXT(header, left)) {
+      if (header->nlmsg_type != NLMSG_DONE) { continue; }
+      auto *message = static_cast<struct cn_msg *>(NLMSG_DATA(header));
+      if (message->id.idx != CN_IDX_PROC || message->id.val != CN_VAL_PROC ||
+          message->len < sizeof(struct proc_event)) {
+        continue;
+      }
+      apply(*reinterpret_cast<struct proc_event *>(message->data), pids);
+    }
+  }
+
+  bool complete = !lost;
+  lost = false;
+  return complete;
+}
+
+void proc_events::apply(const struct proc_event &event,
+                        std::unordered_set<pid_t> &pids) {
+  switch (static_cast<uint32_t>(event.what)) {
+    case EVENT_FORK:
+      if (event.event_data.fork.child_pid ==
+          event.event_data.fork.child_tgid) {
+        pids.insert(event.event_data.fork.child_tgid);
+      }
+      break;
+    case EVENT_EXIT:
+      if (event.event_data.exit.process_pid ==
+          event.event_data.exit.process_tgid) {
+        pids.erase(event.event_data.exit.process_tgid);
+      }
+      break;
+    default:
+      break;
+  }
+}
+}  // namespace conky
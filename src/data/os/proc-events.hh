@@ -0,0 +1,71 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (C) 2010 Pavel Labath et al.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PROC_EVENTS_HH
+#define PROC_EVENTS_HH
+
+#include <sys/types.h>
+#include <unordered_set>
+
+struct proc_event;
+
+namespace conky {
+/*
+ * Keeps track of which processes exist from the fork and exit events the
+ * kernel sends over the netlink proc connector, so that top doesn't have to
+ * list /proc on every update.
+ *
+ * Listening takes CAP_NET_ADMIN, and the kernel only sends events to
+ * listeners in the initial pid and user namespaces; start() fails where
+ * that can't work, and the caller goes on scanning /proc.
+ */
+class proc_events {
+  int fd = -1;
+  bool failed = false; /* start() won't try again */
+  bool lost = false;   /* events were dropped since the last update() */
+
+ public:
+  proc_events() = default;
+  ~proc_events() { stop(); }
+
+  proc_events(const proc_events &) = delete;
+  proc_events &operator=(const proc_events &) = delete;
+
+  /* Subscribes to the events. Returns whether that worked; after it didn't
+   * once, it returns false right away. */
+  bool start();
+  void stop();
+  bool listening() const { return fd >= 0; }
+
+  /* Applies the events received since the last call to pids. Returns false
+   * if pids can't be trusted, because events were lost or this is the first
+   * call after start(), and has to be filled from /proc again. */
+  bool update(std::unordered_set<pid_t> &pids);
+
+  /* Applies one event to pids: forked processes are added and exited ones
+   * removed, threads are ignored. */
+  static void apply(const struct proc_event &event,
+                    std::unordered_set<pid_t> &pids);
+};
+}  // namespace conky
+
+#endif /* PROC_EVENTS_HH */
@@ -0,0 +1,139 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (C) 2010 Pavel Labath et al.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "proc-fields.hh"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace conky {
+namespace {
+#ifdef __SSE2__
+inline __m128i load(const char *p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+inline unsigned blank_mask(__m128i v) {
+  __m128i blanks = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                                _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+  return _mm_movemask_epi8(blanks);
+}
+#endif
+
+/* Classes of bytes, as a test for one and, with SSE2, a mask of the ones in
+ * a block of 16. */
+struct blanks {
+  static bool is(char c) { return c == ' ' || c == '\t'; }
+#ifdef __SSE2__
+  static unsigned mask(__m128i v) { return blank_mask(v); }
+#endif
+};
+
+struct digits {
+  static bool is(char c) { return static_cast<unsigned char>(c - '0') < 10; }
+#ifdef __SSE2__
+  static unsigned mask(__m128i v) {
+    /* c - '0' <= 9, unsigned, which SSE2 only has as max(x, 9) == 9 */
+    __m128i nine = _mm_set1_epi8(9);
+    __m128i d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(d, nine), nine));
+  }
+#endif
+};
+
+/* anything but blanks and what ends a line */
+struct field_bytes {
+  static bool is(char c) { return !blanks::is(c) && c != '\n' && c != '\0'; }
+#ifdef __SSE2__
+  static unsigned mask(__m128i v) {
+    __m128i ends = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                                _mm_cmpeq_epi8(v, _mm_setzero_si128()));
+    return ~(blank_mask(v) | _mm_movemask_epi8(ends));
+  }
+#endif
+};
+
+/* the first byte from p on which isn't of Class, or end */
+template <typename Class>
+inline const char *skip(const char *p, const char *end) {
+#ifdef __SSE2__
+  while (end - p >= 16) {
+    unsigned others = ~Class::mask(load(p)) & 0xffff;
+    if (others != 0) { return p + __builtin_ctz(others); }
+    p += 16;
+  }
+#endif
+  while (p < end && Class::is(*p)) { ++p; }
+  return p;
+}
+
+/* the number in the digits from p to q */
+inline unsigned long long to_number(const char *p, const char *q) {
+  unsigned long long value = 0;
+  for (; p < q; ++p) { value = value * 10 + (*p - '0'); }
+  return value;
+}
+}  // namespace
+
+size_t parse_uints(const char *&p, const char *end, unsigned long long *out,
+                   size_t n) {
+  size_t parsed = 0;
+  while (parsed < n) {
+    const char *start = skip<blanks>(p, end);
+    if (start == end || !digits::is(*start)) { break; }
+    p = skip<digits>(start, end);
+    out[parsed++] = to_number(start, p);
+  }
+  return parsed;
+}
+
+size_t parse_ints(const char *&p, const char *end, long long *out, size_t n) {
+  size_t parsed = 0;
+  while (parsed < n) {
+    const char *start = skip<blanks>(p, end);
+    bool negative = start != end && *start == '-';
+    const char *first = negative ? start + 1 : start;
+    if (first == end || !digits::is(*first)) { break; }
+    p = skip<digits>(first, end);
+    unsigned long long value = to_number(first, p);
+    out[parsed++] = negative ? -static_cast<long long>(value)
+                             : static_cast<long long>(value);
+  }
+  return parsed;
+}
+
+const char *skip_fields(const char *p, const char *end, size_t n) {
+  for (; n > 0; --n) {
+    p = skip<blanks>(p, end);
+    if (p == end || !field_bytes::is(*p)) { break; }
+    p = skip<field_bytes>(p, end);
+  }
+  return p;
+}
+
+size_t next_field(const char *&p, const char *end) {
+  p = skip<blanks>(p, end);
+  if (p == end || !field_bytes::is(*p)) { return 0; }
+  return skip<field_bytes>(p, end) - p;
+}
+}  // namespace conky
@@ -0,0 +1,57 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (C) 2010 Pavel Labath et al.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PROC_FIELDS_HH
+#define PROC_FIELDS_HH
+
+#include <cstddef>
+
+/*
+ * Parsers for the blank separated numbers that most files under /proc are
+ * made of, to use instead of sscanf() where a lot of them are read, e.g. a
+ * line per CPU in /proc/stat. Fields are separated by spaces and tabs; a
+ * newline or NUL ends the line.
+ *
+ * end bounds the memory the parsers may look at: runs of bytes are
+ * classified 16 at a time where SSE2 is available, so end may be well past
+ * the end of the line, e.g. the end of a procfs_file buffer, but must not
+ * be past what is readable.
+ */
+namespace conky {
+/* Parses up to n unsigned numbers at p into out, and moves p past them.
+ * Stops early at the end of the line or at a field which doesn't start
+ * with a digit. Returns how many were parsed. */
+size_t parse_uints(const char *&p, const char *end, unsigned long long *out,
+                   size_t n);
+
+/* Like parse_uints(), but numbers may have a leading '-'. */
+size_t parse_ints(const char *&p, const char *end, long long *out, size_t n);
+
+/* Skips up to n fields of any kind, and the blanks before them. */
+const char *skip_fields(const char *p, const char *end, size_t n);
+
+/* The field at p, after any blanks, is stored in p and its length
+ * returned; 0 at the end of the line. */
+size_t next_field(const char *&p, const char *end);
+}  // namespace conky
+
+#endif /* PROC_FIELDS_HH */
@@ -0,0 +1,117 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (C) 2010 Pavel Labath et al.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "procfs.hh"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+
+#include "../../logging.h"
+
+namespace conky {
+namespace {
+std::mutex root_mutex;
+std::string root;
+std::atomic<unsigned> root_generation{0};
+
+/* what the first read() of a file allocates; most of them fit */
+const size_t initial_size = 4096;
+}  // namespace
+
+void set_procfs_root(const std::string &root_) {
+  std::lock_guard<std::mutex> lock(root_mutex);
+  root = root_;
+  ++root_generation;
+}
+
+std::string procfs_path(const char *path) {
+  std::lock_guard<std::mutex> lock(root_mutex);
+  return root + path;
+}
+
+void procfs_file::close_fd() {
+  if (fd >= 0) {
+    close(fd);
+    fd = -1;
+  }
+}
+
+bool procfs_file::read() {
+  length = cursor = 0;
+  if (buf.empty()) { buf.resize(initial_size); }
+  buf[0] = '\0';
+
+  if (fd >= 0 && generation != root_generation.load()) { close_fd(); }
+  if (fd < 0) {
+    generation = root_generation.load();
+    std::string full = procfs_path(path.c_str());
+    fd = open(full.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      if (reported == 0) {
+        NORM_ERR("can't open %s: %s", full.c_str(), strerror(errno));
+        reported = 1;
+      }
+      return false;
+    }
+  }
+
+  /* the contents of /proc files are made up while they are read, so they
+   * have no size to go by; read until the end, growing the buffer */
+  for (;;) {
+    ssize_t n = pread(fd, buf.data() + length, buf.size() - length - 1, length);
+    if (n < 0) {
+      if (errno == EINTR) { continue; }
+      if (reported == 0) {
+        NORM_ERR("can't read %s: %s", path.c_str(), strerror(errno));
+        reported = 1;
+      }
+      close_fd();
+      length = 0;
+      buf[0] = '\0';
+      return false;
+    }
+    if (n == 0) { break; }
+    length += n;
+    if (length + 1 == buf.size()) { buf.resize(buf.size() * 2); }
+  }
+  buf[length] = '\0';
+  return true;
+}
+
+char *procfs_file::next_line() {
+  if (cursor >= length) { return nullptr; }
+
+  char *line = buf.data() + cursor;
+  auto *end = static_cast<char *>(memchr(line, '\n', length - cursor));
+  if (end == nullptr) {
+    cursor = length;
+  } else {
+    *end = '\0';
+    cursor = end - buf.data() + 1;
+  }
+  return line;
+}
+}  // namespace conky
@@ -0,0 +1,87 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (C) 2010 Pavel Labath et al.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PROCFS_HH
+#define PROCFS_HH
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace conky {
+/*
+ * A file under /proc (or /sys) that is read over and over. It is opened
+ * once, and every read() reads it again from the start with pread() into a
+ * buffer which is kept, and grows, between reads. What was read is handed
+ * out line by line.
+ *
+ * An object is not meant to be used by two threads at once; give every
+ * collector its own.
+ */
+class procfs_file {
+  std::string path;
+  int fd = -1;
+  unsigned generation = 0; /* of set_procfs_root() when fd was opened */
+  int reported = 0;        /* whether an error was told already */
+  std::vector<char> buf;
+  size_t length = 0; /* of what the last read() got */
+  size_t cursor = 0; /* where next_line() continues */
+
+  void close_fd();
+
+ public:
+  /* path is absolute, e.g. "/proc/stat"; it is looked up through
+   * procfs_path() */
+  explicit procfs_file(const char *path_) : path(path_) {}
+  ~procfs_file() { close_fd(); }
+
+  procfs_file(const procfs_file &) = delete;
+  procfs_file &operator=(const procfs_file &) = delete;
+
+  /* Reads the whole file again. Returns false, and tells about it once, if
+   * it can't be opened or read. */
+  bool read();
+
+  /* The next line of what read() got, without its newline and terminated by
+   * a NUL instead, or nullptr after the last one. Lines may be modified in
+   * place and stay valid until the next read(). */
+  char *next_line();
+
+  std::string_view contents() const {
+    return std::string_view(buf.data(), length);
+  }
+
+  /* The end of contents(). The lines from next_line() lie before it, so
+   * it bounds what the parsers in proc-fields.hh may read of them. */
+  const char *end() const { return buf.data() + length; }
+};
+
+/* Where procfs_file looks for /proc and /sys, and what procfs_path()
+ * prefixes. Empty, i.e. the real ones, unless tests point it to fixtures.
+ * Files already open are opened again under the new root on their next
+ * read(). */
+void set_procfs_root(const std::string &root);
+std::string procfs_path(const char *path);
+}  // namespace conky
+
+#endif /* PROCFS_HH */
@@ -210,7 +210,7 @@ int update_running_processes(void) {
   return 0;
 }
 
-int update_net_stats(void) {
+int collect_net_stats(void) {
   struct ifconf ifc;
   int sockfd;
   char buf[1024];
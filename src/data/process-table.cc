@@ -0,0 +1,333 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (C) 2010 Pavel Labath et al.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "process-table.hh"
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <numeric>
+
+#include "../conky.h"
+#include "top.h"
+
+namespace conky {
+namespace {
+struct process *new_view(pid_t pid) {
+  auto *p = static_cast<struct process *>(calloc(1, sizeof(struct process)));
+
+  p->pid = pid;
+  p->previous_user_time = ULONG_MAX;
+  p->previous_kernel_time = ULONG_MAX;
+  p->previous_total_cpu_time = ULONG_MAX;
+#ifdef BUILD_IOSTATS
+  p->previous_read_bytes = ULLONG_MAX;
+  p->previous_write_bytes = ULLONG_MAX;
+#endif /* BUILD_IOSTATS */
+  p->counted = 1;
+
+  return p;
+}
+
+void free_view(struct process *p) {
+  free_and_zero(p->name);
+  free_and_zero(p->basename);
+  free(p);
+}
+
+/* whether a ranks above b; a cpu percentage is NaN when no time passed,
+ * and those rank below everything else */
+inline bool above(float a, float b) { return a > b || (b != b && a == a); }
+template <typename T>
+inline bool above(T a, T b) {
+  return a > b;
+}
+}  // namespace
+
+size_t process_table::home(pid_t pid_) const {
+  /* multiplying by an odd number keeps pids which follow each other apart */
+  return (static_cast<uint32_t>(pid_) * 2654435769U) & (map.size() - 1);
+}
+
+size_t process_table::find_entry(pid_t pid_) const {
+  if (map.empty()) { return SIZE_MAX; }
+  /* the map is at most half full, so there's always an empty entry */
+  for (size_t i = home(pid_);; i = (i + 1) & (map.size() - 1)) {
+    if (map[i].slot == NONE) { return SIZE_MAX; }
+    if (map[i].pid == pid_) { return i; }
+  }
+}
+
+void process_table::grow() {
+  map.assign(std::max<size_t>(64, map.size() * 2), entry{0, NONE});
+  for (size_t slot = 0; slot < size(); ++slot) {
+    size_t i = home(pid[slot]);
+    while (map[i].slot != NONE) { i = (i + 1) & (map.size() - 1); }
+    map[i] = entry{pid[slot], static_cast<uint32_t>(slot)};
+  }
+}
+
+/* Empties entry i. The entries after it which would no longer be found,
+ * because their probe passed through i, are moved back. */
+void process_table::erase_entry(size_t i) {
+  size_t mask = map.size() - 1;
+  for (size_t j = (i + 1) & mask; map[j].slot != NONE; j = (j + 1) & mask) {
+    size_t k = home(map[j].pid);
+    /* whether k, where the probe for j starts, lies cyclically in (i, j] */
+    bool reachable = i <= j ? (i < k && k <= j) : (i < k || k <= j);
+    if (!reachable) {
+      map[i] = map[j];
+      i = j;
+    }
+  }
+  map[i].slot = NONE;
+}
+
+size_t process_table::find(pid_t pid_) const {
+  size_t i = find_entry(pid_);
+  return i == SIZE_MAX ? size() : map[i].slot;
+}
+
+size_t process_table::slot_of(pid_t pid_) {
+  size_t i = find_entry(pid_);
+  if (i != SIZE_MAX) { return map[i].slot; }
+
+  if (2 * (size() + 1) > map.size()) { grow(); }
+  for (i = home(pid_); map[i].slot != NONE; i = (i + 1) & (map.size() - 1)) {}
+  size_t slot = size();
+  map[i] = entry{pid_, static_cast<uint32_t>(slot)};
+
+  struct process *view = new_view(pid_);
+  view->next = first_view;
+  if (first_view != nullptr) { first_view->previous = view; }
+  first_view = view;
+
+  pid.push_back(pid_);
+  uid.push_back(0);
+  time_stamp.push_back(0);
+  user_time.push_back(0);
+  kernel_time.push_back(0);
+  previous_user_time.push_back(ULONG_MAX);
+  previous_kernel_time.push_back(ULONG_MAX);
+  total_cpu_time.push_back(0);
+  vsize.push_back(0);
+  rss.push_back(0);
+  starttime.push_back(0);
+  amount.push_back(0);
+#ifdef BUILD_IOSTATS
+  read_bytes.push_back(0);
+  write_bytes.push_back(0);
+  previous_read_bytes.push_back(ULLONG_MAX);
+  previous_write_bytes.push_back(ULLONG_MAX);
+  io_perc.push_back(0);
+#endif /* BUILD_IOSTATS */
+  read_at.push_back(0);
+  interval.push_back(0);
+  running.push_back(0);
+  views.push_back(view);
+
+  return slot;
+}
+
+void process_table::remove(size_t slot) {
+  struct process *view = views[slot];
+  if (view->next != nullptr) { view->next->previous = view->previous; }
+  if (view->previous != nullptr) {
+    view->previous->next = view->next;
+  } else {
+    first_view = view->next;
+  }
+  free_view(view);
+
+  erase_entry(find_entry(pid[slot]));
+
+  /* the last slot takes the place of the removed one */
+  size_t last = size() - 1;
+  if (slot != last) {
+    each_array([slot, last](auto &array) { array[slot] = array[last]; });
+    map[find_entry(pid[slot])].slot = slot;
+  }
+  each_array([](auto &array) { array.pop_back(); });
+}
+
+void process_table::remove_stale(unsigned int stamp) {
+  for (size_t slot = 0; slot < size();) {
+    if (time_stamp[slot] != stamp) {
+      remove(slot);
+    } else {
+      ++slot;
+    }
+  }
+}
+
+void process_table::clear() {
+  for (struct process *view : views) { free_view(view); }
+  each_array([](auto &array) { array.clear(); });
+  map.clear();
+  first_view = nullptr;
+}
+
+void process_table::from_views() {
+  for (size_t slot = 0; slot < size(); ++slot) {
+    const struct process *view = views[slot];
+    uid[slot] = view->uid;
+    time_stamp[slot] = view->time_stamp;
+    user_time[slot] = view->user_time;
+    kernel_time[slot] = view->kernel_time;
+    previous_user_time[slot] = view->previous_user_time;
+    previous_kernel_time[slot] = view->previous_kernel_time;
+    total_cpu_time[slot] = view->total_cpu_time;
+    vsize[slot] = view->vsize;
+    rss[slot] = view->rss;
+    starttime[slot] = view->starttime;
+    amount[slot] = view->amount;
+#ifdef BUILD_IOSTATS
+    read_bytes[slot] = view->read_bytes;
+    write_bytes[slot] = view->write_bytes;
+    previous_read_bytes[slot] = view->previous_read_bytes;
+    previous_write_bytes[slot] = view->previous_write_bytes;
+    io_perc[slot] = view->io_perc;
+#endif /* BUILD_IOSTATS */
+  }
+}
+
+void process_table::to_views() {
+  for (size_t slot = 0; slot < size(); ++slot) {
+    struct process *view = views[slot];
+    view->uid = uid[slot];
+    view->time_stamp = time_stamp[slot];
+    view->user_time = user_time[slot];
+    view->kernel_time = kernel_time[slot];
+    view->previous_user_time = previous_user_time[slot];
+    view->previous_kernel_time = previous_kernel_time[slot];
+    view->total_cpu_time = total_cpu_time[slot];
+    view->vsize = vsize[slot];
+    view->rss = rss[slot];
+    view->starttime = starttime[slot];
+    view->amount = amount[slot];
+#ifdef BUILD_IOSTATS
+    view->read_bytes = read_bytes[slot];
+    view->write_bytes = write_bytes[slot];
+    view->previous_read_bytes = previous_read_bytes[slot];
+    view->previous_write_bytes = previous_write_bytes[slot];
+    view->io_perc = io_perc[slot];
+#endif /* BUILD_IOSTATS */
+  }
+}
+
+void process_table::record_times(size_t slot, unsigned long user,
+                                 unsigned long kernel,
+                                 unsigned long long ticks) {
+  total_cpu_time[slot] = user + kernel;
+  if (previous_user_time[slot] == ULONG_MAX) {
+    previous_user_time[slot] = user;
+  }
+  if (previous_kernel_time[slot] == ULONG_MAX) {
+    previous_kernel_time[slot] = kernel;
+  }
+
+  /* strangely, the values aren't monotonous */
+  previous_user_time[slot] = std::min(previous_user_time[slot], user);
+  previous_kernel_time[slot] = std::min(previous_kernel_time[slot], kernel);
+
+  /* store only the differences here... */
+  user_time[slot] = user - previous_user_time[slot];
+  kernel_time[slot] = kernel - previous_kernel_time[slot];
+  previous_user_time[slot] = user;
+  previous_kernel_time[slot] = kernel;
+  /* ...and how long it took */
+  interval[slot] = ticks - read_at[slot];
+  read_at[slot] = ticks;
+}
+
+void calc_cpu_amounts(process_table &table, float mul) {
+  const unsigned long *user = table.user_time.data();
+  const unsigned long *kernel = table.kernel_time.data();
+  const unsigned long long *interval = table.interval.data();
+  float *amount = table.amount.data();
+  for (size_t i = 0, n = table.size(); i < n; ++i) {
+    amount[i] = mul * (user[i] + kernel[i]) / (float)interval[i];
+  }
+}
+
+unsigned int pick_processes(process_table &table,
+                            const std::vector<size_t> &slots,
+                            const std::vector<size_t> &shown, size_t count,
+                            size_t least, unsigned int stamp,
+                            std::vector<size_t> &picked) {
+  static std::vector<size_t> rest;
+
+  picked.clear();
+  rest.clear();
+  for (size_t slot : slots) {
+    if (std::binary_search(shown.begin(), shown.end(), slot)) {
+      picked.push_back(slot);
+    } else {
+      rest.push_back(slot);
+    }
+  }
+
+  size_t more = count > picked.size() ? count - picked.size() : 0;
+  more = std::min(std::max(more, least), rest.size());
+  std::nth_element(rest.begin(), rest.begin() + more, rest.end(),
+                   [&table](size_t a, size_t b) {
+                     return table.read_at[a] < table.read_at[b];
+                   });
+  picked.insert(picked.end(), rest.begin(), rest.begin() + more);
+
+  unsigned int running = 0;
+  for (auto it = rest.begin() + more; it != rest.end(); ++it) {
+    table.time_stamp[*it] = stamp;
+    running += table.running[*it];
+  }
+  return running;
+}
+
+template <typename T>
+void find_top(const process_table &table, const std::vector<T> &key,
+              size_t n, struct process **list) {
+  static std::vector<uint32_t> order;
+  /* equal keys go by pid, so the order doesn't flicker between updates */
+  auto before = [&table, &key](uint32_t a, uint32_t b) {
+    if (above(key[a], key[b])) { return true; }
+    if (above(key[b], key[a])) { return false; }
+    return table.pid[a] < table.pid[b];
+  };
+
+  order.resize(table.size());
+  std::iota(order.begin(), order.end(), 0);
+  size_t found = std::min(n, order.size());
+  std::partial_sort(order.begin(), order.begin() + found, order.end(), before);
+
+  for (size_t i = 0; i < found; ++i) { list[i] = table.views[order[i]]; }
+  std::fill(list + found, list + n, nullptr);
+}
+
+template void find_top(const process_table &, const std::vector<float> &,
+                       size_t, struct process **);
+template void find_top(const process_table &,
+                       const std::vector<unsigned long> &, size_t,
+                       struct process **);
+template void find_top(const process_table &,
+                       const std::vector<unsigned long long> &, size_t,
+                       struct process **);
+}  // namespace conky
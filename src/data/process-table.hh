@@ -0,0 +1,178 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (C) 2010 Pavel Labath et al.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef PROCESS_TABLE_HH
+#define PROCESS_TABLE_HH
+
+#include <sys/types.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "config.h"
+
+struct process;
+
+namespace conky {
+/*
+ * The processes top knows about. Each lives in a slot, and the slots of all
+ * of them are 0 to size() - 1. The numbers the loops over all processes go
+ * through on every update are kept in an array per field, indexed by slot,
+ * so those loops run over contiguous memory. Processes are found by pid
+ * through an open addressing map from pid to slot.
+ *
+ * Every slot also has a struct process, the view text objects read and
+ * the backends other than Linux still fill; from_views() and to_views()
+ * copy the fields below between them and the arrays. The views are linked
+ * in a list, see first(), and don't move while their process lives.
+ */
+class process_table {
+  /* pid -> slot, with linear probing; empty entries have slot NONE */
+  struct entry {
+    pid_t pid;
+    uint32_t slot;
+  };
+  static const uint32_t NONE = UINT32_MAX;
+  std::vector<entry> map;
+  struct process *first_view = nullptr;
+
+  size_t home(pid_t pid) const;
+  size_t find_entry(pid_t pid) const;
+  void grow();
+  void erase_entry(size_t i);
+  void remove(size_t slot);
+
+  /* calls fn with every array */
+  template <typename Fn>
+  void each_array(Fn fn) {
+    fn(pid);
+    fn(uid);
+    fn(time_stamp);
+    fn(user_time);
+    fn(kernel_time);
+    fn(previous_user_time);
+    fn(previous_kernel_time);
+    fn(total_cpu_time);
+    fn(vsize);
+    fn(rss);
+    fn(starttime);
+    fn(amount);
+#ifdef BUILD_IOSTATS
+    fn(read_bytes);
+    fn(write_bytes);
+    fn(previous_read_bytes);
+    fn(previous_write_bytes);
+    fn(io_perc);
+#endif /* BUILD_IOSTATS */
+    fn(read_at);
+    fn(interval);
+    fn(running);
+    fn(views);
+  }
+
+ public:
+  /* the fields of struct process of the same names */
+  std::vector<pid_t> pid;
+  std::vector<uid_t> uid;
+  std::vector<unsigned int> time_stamp;
+  std::vector<unsigned long> user_time;
+  std::vector<unsigned long> kernel_time;
+  std::vector<unsigned long> previous_user_time;
+  std::vector<unsigned long> previous_kernel_time;
+  std::vector<unsigned long> total_cpu_time;
+  std::vector<unsigned long long> vsize;
+  std::vector<unsigned long long> rss;
+  std::vector<unsigned long long> starttime;
+  std::vector<float> amount;
+#ifdef BUILD_IOSTATS
+  std::vector<unsigned long long> read_bytes;
+  std::vector<unsigned long long> write_bytes;
+  std::vector<unsigned long long> previous_read_bytes;
+  std::vector<unsigned long long> previous_write_bytes;
+  std::vector<float> io_perc;
+#endif /* BUILD_IOSTATS */
+  /* Only in the table, and only kept by Linux: when the process was last
+   * read and how long before that it was read, both in cpu time (the times
+   * above are the differences over that interval), and whether it was
+   * running then. */
+  std::vector<unsigned long long> read_at;
+  std::vector<unsigned long long> interval;
+  std::vector<unsigned char> running;
+  std::vector<struct process *> views;
+
+  process_table() = default;
+  ~process_table() { clear(); }
+
+  process_table(const process_table &) = delete;
+  process_table &operator=(const process_table &) = delete;
+
+  size_t size() const { return pid.size(); }
+  struct process *first() const { return first_view; }
+
+  /* The slot of pid, or size() if there's none. */
+  size_t find(pid_t pid_) const;
+  /* The slot of pid, which is added if it's new. Slots of other processes
+   * stay where they are, but the arrays may be reallocated. */
+  size_t slot_of(pid_t pid_);
+
+  /* Removes the processes whose time_stamp isn't stamp. The last slots
+   * move into the ones which were freed. */
+  void remove_stale(unsigned int stamp);
+  void clear();
+
+  /* copy the fields in the arrays from or to the views */
+  void from_views();
+  void to_views();
+
+  /* Keeps user and kernel, the times process slot has run in all as read
+   * when the cpus had run for ticks: the times become what it ran since
+   * it was read before, and interval how long ago that was. */
+  void record_times(size_t slot, unsigned long user, unsigned long kernel,
+                    unsigned long long ticks);
+};
+
+/* Sets the amount of every process to the share of the cpu it had over
+ * the interval it was last read in, times mul. A process which wasn't
+ * read again keeps its times and interval, and so its amount. */
+void calc_cpu_amounts(process_table &table, float mul);
+
+/* Picks the processes in slots which are read this update when not all
+ * of them can be: those in shown, which is sorted, and of the others the
+ * ones read the longest ago, count in all but always at least least of
+ * them, so every process gets its turn. The rest keep what was read
+ * before, and their time_stamp becomes stamp, as they are still alive.
+ * Returns how many of the rest were running when last read. */
+unsigned int pick_processes(process_table &table,
+                            const std::vector<size_t> &slots,
+                            const std::vector<size_t> &shown, size_t count,
+                            size_t least, unsigned int stamp,
+                            std::vector<size_t> &picked);
+
+/* Puts the views of the n processes with the largest key, one of the
+ * arrays of table, into list, largest first. If there are fewer than n
+ * processes, the rest of list is nullptr. */
+template <typename T>
+void find_top(const process_table &table, const std::vector<T> &key,
+              size_t n, struct process **list);
+}  // namespace conky
+
+#endif /* PROCESS_TABLE_HH */
@@ -79,20 +79,30 @@ void scan_tztime(struct text_object *obj, const char *arg) {
   obj->data.opaque = ts;
 }
 
-void print_time(struct text_object *obj, char *p, unsigned int p_max_size) {
+size_t print_time(struct text_object *obj, char *p,
+                  unsigned int p_max_size) {
   time_t t = time(nullptr);
   struct tm *tm = localtime(&t);
 
   setlocale(LC_TIME, "");
-  strftime(p, p_max_size, static_cast<char *>(obj->data.opaque), tm);
+  /* strftime() leaves the buffer undefined when it returns 0 */
+  size_t len =
+      strftime(p, p_max_size, static_cast<char *>(obj->data.opaque), tm);
+  if (len == 0 && p_max_size > 0) { p[0] = '\0'; }
+  return len;
 }
 
-void print_utime(struct text_object *obj, char *p, unsigned int p_max_size) {
+size_t print_utime(struct text_object *obj, char *p,
+                  unsigned int p_max_size) {
   time_t t = time(nullptr);
   struct tm *tm = gmtime(&t);
 
   setlocale(LC_TIME, "");
-  strftime(p, p_max_size, static_cast<char *>(obj->data.opaque), tm);
+  /* strftime() leaves the buffer undefined when it returns 0 */
+  size_t len =
+      strftime(p, p_max_size, static_cast<char *>(obj->data.opaque), tm);
+  if (len == 0 && p_max_size > 0) { p[0] = '\0'; }
+  return len;
 }
 
 void print_tztime(struct text_object *obj, char *p, unsigned int p_max_size) {
@@ -41,8 +41,8 @@ void scan_time(struct text_object *, const char *);
 void scan_tztime(struct text_object *, const char *);
 
 /* print the time */
-void print_time(struct text_object *, char *, unsigned int);
-void print_utime(struct text_object *, char *, unsigned int);
+size_t print_time(struct text_object *, char *, unsigned int);
+size_t print_utime(struct text_object *, char *, unsigned int);
 void print_tztime(struct text_object *, char *, unsigned int);
 void print_format_time(struct text_object *obj, char *p,
                        unsigned int p_max_size);
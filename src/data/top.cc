@@ -33,76 +33,16 @@
 #include <cstring>
 
 #include "../logging.h"
-#include "../prioqueue.h"
-
-/* hash table size - always a power of 2 */
-#define HTABSIZE 256
-
-struct process *first_process = nullptr;
+#include "process-table.hh"
 
 unsigned long g_time = 0;
 
-/* a simple hash table to speed up find_process() */
-struct proc_hash_entry {
-  struct proc_hash_entry *next;
-  struct process *proc;
-};
-static struct proc_hash_entry proc_hash_table[HTABSIZE];
-
-static void hash_process(struct process *p) {
-  struct proc_hash_entry *phe;
-  static char first_run = 1;
-  int bucket;
-
-  /* better make sure all next pointers are zero upon first access */
-  if (first_run != 0) {
-    memset(proc_hash_table, 0, sizeof(struct proc_hash_entry) * HTABSIZE);
-    first_run = 0;
-  }
-
-  /* get the bucket index */
-  bucket = p->pid & (HTABSIZE - 1);
-
-  /* insert a new element on bucket's top */
-  phe = static_cast<struct proc_hash_entry *>(
-      malloc(sizeof(struct proc_hash_entry)));
-  phe->proc = p;
-  phe->next = proc_hash_table[bucket].next;
-  proc_hash_table[bucket].next = phe;
-}
-
-static void unhash_process(struct process *p) {
-  struct proc_hash_entry *phe, *tmp;
-
-  /* get the bucket head */
-  phe = &proc_hash_table[p->pid & (HTABSIZE - 1)];
-  /* find the entry pointing to p and drop it */
-  while (phe->next != nullptr) {
-    if (phe->next->proc == p) {
-      tmp = phe->next;
-      phe->next = phe->next->next;
-      free(tmp);
-      return;
-    }
-    phe = phe->next;
-  }
-}
-
-static void __unhash_all_processes(struct proc_hash_entry *phe) {
-  if (phe->next != nullptr) { __unhash_all_processes(phe->next); }
-  free(phe->next);
+conky::process_table &top_processes() {
+  static conky::process_table table;
+  return table;
 }
 
-static void unhash_all_processes() {
-  int i;
-
-  for (i = 0; i < HTABSIZE; i++) {
-    __unhash_all_processes(&proc_hash_table[i]);
-    proc_hash_table[i].next = nullptr;
-  }
-}
-
-struct process *get_first_process() { return first_process; }
+struct process *get_first_process() { return top_processes().first(); }
 
 void free_all_processes() {
   // Before freeing all the things, we need to clear globals pointing 'em.
@@ -113,23 +53,11 @@ void free_all_processes() {
   std::memset(info.io, 0, sizeof(info.io));
 #endif
 
-  struct process *next = nullptr, *pr = first_process;
-
-  while (pr != nullptr) {
-    next = pr->next;
-    free_and_zero(pr->name);
-    free_and_zero(pr->basename);
-    free(pr);
-    pr = next;
-  }
-  first_process = nullptr;
-
-  /* drop the whole hash table */
-  unhash_all_processes();
+  top_processes().clear();
 }
 
 struct process *get_process_by_name(std::string_view name) {
-  struct process *p = first_process;
+  struct process *p = get_first_process();
 
   while (p != nullptr) {
     // Try matching against the full command line first.
@@ -145,172 +73,19 @@ bool is_process_running(std::string_view name) {
   return get_process_by_name(name) != nullptr;
 }
 
-static struct process *find_process(pid_t pid) {
-  struct proc_hash_entry *phe;
-
-  phe = &proc_hash_table[pid & (HTABSIZE - 1)];
-  while (phe->next != nullptr) {
-    if (phe->next->proc->pid == pid) { return phe->next->proc; }
-    phe = phe->next;
-  }
-  return nullptr;
-}
-
-static struct process *new_process(pid_t pid) {
-  auto *p = static_cast<struct process *>(malloc(sizeof(struct process)));
-
-  /* Do stitching necessary for doubly linked list */
-  p->previous = nullptr;
-  p->next = first_process;
-  if (p->next != nullptr) { p->next->previous = p; }
-  first_process = p;
-
-  p->pid = pid;
-  p->name = nullptr;
-  p->basename = nullptr;
-  p->amount = 0;
-  p->user_time = 0;
-  p->total = 0;
-  p->kernel_time = 0;
-  p->previous_user_time = ULONG_MAX;
-  p->previous_kernel_time = ULONG_MAX;
-  p->total_cpu_time = 0;
-  p->previous_total_cpu_time = ULONG_MAX;
-  p->vsize = 0;
-  p->rss = 0;
-#ifdef BUILD_IOSTATS
-  p->read_bytes = 0;
-  p->previous_read_bytes = ULLONG_MAX;
-  p->write_bytes = 0;
-  p->previous_write_bytes = ULLONG_MAX;
-  p->io_perc = 0;
-#endif /* BUILD_IOSTATS */
-  p->time_stamp = 0;
-  p->counted = 1;
-  p->changed = 0;
-
-  /* process_find_name(p); */
-
-  /* add the process to the hash table */
-  hash_process(p);
-
-  return p;
-}
-
 /* Get / create a new process object and insert it into the process list */
 struct process *get_process(pid_t pid) {
-  struct process *p = find_process(pid);
-  return p != nullptr ? p : new_process(pid);
-}
-
-/******************************************
- * Functions							  *
- ******************************************/
-
-/******************************************
- * Destroy and remove a process           *
- ******************************************/
-
-static void delete_process(struct process *p) {
-#if defined(PARANOID)
-  assert(p->id == 0x0badfeed);
-
-  /*
-   * Ensure that deleted processes aren't reused.
-   */
-  p->id = 0x007babe;
-#endif /* defined(PARANOID) */
-
-  /*
-   * Maintain doubly linked list.
-   */
-  if (p->next != nullptr) { p->next->previous = p->previous; }
-  if (p->previous != nullptr) {
-    p->previous->next = p->next;
-  } else {
-    first_process = p->next;
-  }
-
-  free_and_zero(p->name);
-  free_and_zero(p->basename);
-  /* remove the process from the hash table */
-  unhash_process(p);
-  free(p);
-}
-
-/******************************************
- * Strip dead process entries			  *
- ******************************************/
-
-static void process_cleanup() {
-  struct process *p = first_process;
-
-  while (p != nullptr) {
-    struct process *current = p;
-
-#if defined(PARANOID)
-    assert(p->id == 0x0badfeed);
-#endif /* defined(PARANOID) */
-
-    p = p->next;
-    /* Delete processes that have died */
-    if (current->time_stamp != g_time) {
-      delete_process(current);
-      if (current == first_process) { first_process = nullptr; }
-      current = nullptr;
-    }
-  }
+  conky::process_table &table = top_processes();
+  return table.views[table.slot_of(pid)];
 }
 
 /******************************************
  * Find the top processes				  *
  ******************************************/
 
-/* cpu comparison function for prio queue */
-static int compare_cpu(void *va, void *vb) {
-  auto *a = static_cast<struct process *>(va),
-       *b = static_cast<struct process *>(vb);
-
-  if (b->amount > a->amount) { return 1; }
-  if (a->amount > b->amount) { return -1; }
-  return 0;
-}
-
-/* mem comparison function for prio queue */
-static int compare_mem(void *va, void *vb) {
-  auto *a = static_cast<struct process *>(va),
-       *b = static_cast<struct process *>(vb);
-
-  if (b->rss > a->rss) { return 1; }
-  if (a->rss > b->rss) { return -1; }
-  return 0;
-}
-
-/* CPU time comparison function for prio queue */
-static int compare_time(void *va, void *vb) {
-  auto *a = static_cast<struct process *>(va),
-       *b = static_cast<struct process *>(vb);
-
-  if (b->total_cpu_time > a->total_cpu_time) { return 1; }
-  if (b->total_cpu_time < a->total_cpu_time) { return -1; }
-  return 0;
-}
-
-#ifdef BUILD_IOSTATS
-/* I/O comparison function for prio queue */
-static int compare_io(void *va, void *vb) {
-  auto *a = static_cast<struct process *>(va),
-       *b = static_cast<struct process *>(vb);
-
-  if (b->io_perc > a->io_perc) { return 1; }
-  if (a->io_perc > b->io_perc) { return -1; }
-  return 0;
-}
-#endif /* BUILD_IOSTATS */
-
 /* ****************************************************************** *
  * Get a sorted list of the top cpu hogs and top mem hogs. * Results are stored
- * in the cpu,mem arrays in decreasing order[0-9]. *
+ * in the cpu,mem arrays in decreasing order, as many as the text shows. *
  * ****************************************************************** */
 
 static void process_find_top(struct process **cpu, struct process **mem,
@@ -320,13 +95,6 @@ static void process_find_top(struct process **cpu, struct process **mem,
                              struct process **io
 #endif /* BUILD_IOSTATS */
 ) {
-  prio_queue_t cpu_queue, mem_queue, time_queue;
-#ifdef BUILD_IOSTATS
-  prio_queue_t io_queue;
-#endif
-  struct process *cur_proc = nullptr;
-  int i;
-
   if ((top_cpu == 0) && (top_mem == 0) && (top_time == 0)
 #ifdef BUILD_IOSTATS
       && (top_io == 0)
@@ -335,68 +103,33 @@ static void process_find_top(struct process **cpu, struct process **mem,
     return;
   }
 
-  cpu_queue = init_prio_queue();
-  pq_set_compare(cpu_queue, &compare_cpu);
-  pq_set_max_size(cpu_queue, MAX_SP);
-
-  mem_queue = init_prio_queue();
-  pq_set_compare(mem_queue, &compare_mem);
-  pq_set_max_size(mem_queue, MAX_SP);
-
-  time_queue = init_prio_queue();
-  pq_set_compare(time_queue, &compare_time);
-  pq_set_max_size(time_queue, MAX_SP);
-
-#ifdef BUILD_IOSTATS
-  io_queue = init_prio_queue();
-  pq_set_compare(io_queue, &compare_io);
-  pq_set_max_size(io_queue, MAX_SP);
-#endif
-
   /* g_time is the time_stamp entry for process.  It is updated when the
    * process information is updated to indicate that the process is still
-   * alive (and must not be removed from the process list in
-   * process_cleanup()) */
+   * alive (and must not be removed from the process list by
+   * remove_stale()) */
   ++g_time;
 
   /* OS-specific function updating process list */
   get_top_info();
 
-  process_cleanup(); /* cleanup list from exited processes */
-
-  cur_proc = first_process;
-
-  while (cur_proc != nullptr) {
-    if (top_cpu != 0) { insert_prio_elem(cpu_queue, cur_proc); }
-    if (top_mem != 0) { insert_prio_elem(mem_queue, cur_proc); }
-    if (top_time != 0) { insert_prio_elem(time_queue, cur_proc); }
-#ifdef BUILD_IOSTATS
-    if (top_io != 0) { insert_prio_elem(io_queue, cur_proc); }
-#endif /* BUILD_IOSTATS */
-    cur_proc = cur_proc->next;
-  }
-
-  for (i = 0; i < MAX_SP; i++) {
-    if (top_cpu != 0) {
-      cpu[i] = static_cast<process *>(pop_prio_elem(cpu_queue));
-    }
-    if (top_mem != 0) {
-      mem[i] = static_cast<process *>(pop_prio_elem(mem_queue));
-    }
-    if (top_time != 0) {
-      ptime[i] = static_cast<process *>(pop_prio_elem(time_queue));
-    }
-#ifdef BUILD_IOSTATS
-    if (top_io != 0) {
-      io[i] = static_cast<process *>(pop_prio_elem(io_queue));
-    }
-#endif /* BUILD_IOSTATS */
+  conky::process_table &table = top_processes();
+#if !defined(__linux__)
+  /* the other backends still fill the views */
+  table.from_views();
+#endif /* !defined(__linux__) */
+  /* cleanup list from exited processes */
+  table.remove_stale(static_cast<unsigned int>(g_time));
+#if defined(__linux__)
+  table.to_views();
+#endif /* defined(__linux__) */
+
+  if (top_cpu != 0) { conky::find_top(table, table.amount, top_cpu, cpu); }
+  if (top_mem != 0) { conky::find_top(table, table.rss, top_mem, mem); }
+  if (top_time != 0) {
+    conky::find_top(table, table.total_cpu_time, top_time, ptime);
   }
-  free_prio_queue(cpu_queue);
-  free_prio_queue(mem_queue);
-  free_prio_queue(time_queue);
 #ifdef BUILD_IOSTATS
-  free_prio_queue(io_queue);
+  if (top_io != 0) { conky::find_top(table, table.io_perc, top_io, io); }
 #endif /* BUILD_IOSTATS */
 }
 
@@ -464,91 +197,102 @@ static conky::range_config_setting<unsigned int> top_name_width(
 static conky::simple_config_setting<bool> top_name_verbose("top_name_verbose",
                                                            false, true);
 
-static void print_top_name(struct text_object *obj, char *p,
-                           unsigned int p_max_size) {
+static size_t print_top_name(struct text_object *obj, char *p,
+                             unsigned int p_max_size) {
   auto *td = static_cast<struct top_data *>(obj->data.opaque);
   int width;
 
   if ((td == nullptr) || (td->list == nullptr) ||
       (td->list[td->num] == nullptr)) {
-    return;
+    return 0;
   }
 
   width = std::min(p_max_size,
                    static_cast<unsigned int>(top_name_width.get(*state)) + 1);
   if (top_name_verbose.get(*state)) {
     /* print the full command line */
-    snprintf(p, width + 1, "%-*s", width, td->list[td->num]->name);
-  } else {
-    /* print only the basename (i.e. executable name) */
-    snprintf(p, width + 1, "%-*s", width, td->list[td->num]->basename);
+    return written_length(
+        snprintf(p, width + 1, "%-*s", width, td->list[td->num]->name),
+        width + 1);
   }
+  /* print only the basename (i.e. executable name) */
+  return written_length(
+      snprintf(p, width + 1, "%-*s", width, td->list[td->num]->basename),
+      width + 1);
 }
 
-static void print_top_mem(struct text_object *obj, char *p,
-                          unsigned int p_max_size) {
+static size_t print_top_mem(struct text_object *obj, char *p,
+                            unsigned int p_max_size) {
   auto *td = static_cast<struct top_data *>(obj->data.opaque);
   int width;
 
   if ((td == nullptr) || (td->list == nullptr) ||
       (td->list[td->num] == nullptr)) {
-    return;
+    return 0;
   }
 
   width = std::min(p_max_size, static_cast<unsigned int>(7));
-  snprintf(p, width, "%6.2f",
-           (static_cast<float>(td->list[td->num]->rss) / info.memmax) / 10);
+  return written_length(
+      snprintf(p, width, "%6.2f",
+               (static_cast<float>(td->list[td->num]->rss) / info.memmax) / 10),
+      width);
 }
 
-static void print_top_time(struct text_object *obj, char *p,
-                           unsigned int p_max_size) {
+static size_t print_top_time(struct text_object *obj, char *p,
+                             unsigned int p_max_size) {
   auto *td = static_cast<struct top_data *>(obj->data.opaque);
   int width;
   char *timeval;
 
   if ((td == nullptr) || (td->list == nullptr) ||
       (td->list[td->num] == nullptr)) {
-    return;
+    return 0;
   }
 
   width = std::min(p_max_size, static_cast<unsigned int>(10));
   timeval = format_time(td->list[td->num]->total_cpu_time, 9);
-  snprintf(p, width, "%9s", timeval);
+  size_t len = written_length(snprintf(p, width, "%9s", timeval), width);
   free(timeval);
+  return len;
 }
 
-static void print_top_user(struct text_object *obj, char *p,
-                           unsigned int p_max_size) {
+static size_t print_top_user(struct text_object *obj, char *p,
+                             unsigned int p_max_size) {
   auto *td = static_cast<struct top_data *>(obj->data.opaque);
   struct passwd *pw;
 
   if ((td == nullptr) || (td->list == nullptr) ||
       (td->list[td->num] == nullptr)) {
-    return;
+    return 0;
   }
 
   pw = getpwuid(td->list[td->num]->uid);
   if (pw != nullptr) {
-    snprintf(p, p_max_size, "%.8s", pw->pw_name);
-  } else {
-    snprintf(p, p_max_size, "%d", td->list[td->num]->uid);
+    return written_length(snprintf(p, p_max_size, "%.8s", pw->pw_name),
+                          p_max_size);
   }
+  return written_length(snprintf(p, p_max_size, "%d", td->list[td->num]->uid),
+                        p_max_size);
 }
 
-#define PRINT_TOP_GENERATOR(name, width, fmt, field)                         \
-  static void print_top_##name(struct text_object *obj, char *p,             \
-                               unsigned int p_max_size) {                    \
-    struct top_data *td = (struct top_data *)obj->data.opaque;               \
-    if (!td || !td->list || !td->list[td->num]) return;                      \
-    snprintf(p, std::min(p_max_size, width), fmt, td->list[td->num]->field); \
+#define PRINT_TOP_GENERATOR(name, width, fmt, field)                        \
+  static size_t print_top_##name(struct text_object *obj, char *p,          \
+                                 unsigned int p_max_size) {                 \
+    struct top_data *td = (struct top_data *)obj->data.opaque;              \
+    if (!td || !td->list || !td->list[td->num]) return 0;                   \
+    unsigned int size = std::min(p_max_size, width);                        \
+    return written_length(snprintf(p, size, fmt, td->list[td->num]->field), \
+                          size);                                            \
   }
 
-#define PRINT_TOP_HR_GENERATOR(name, field, denom)                     \
-  static void print_top_##name(struct text_object *obj, char *p,       \
-                               unsigned int p_max_size) {              \
-    struct top_data *td = (struct top_data *)obj->data.opaque;         \
-    if (!td || !td->list || !td->list[td->num]) return;                \
-    human_readable(td->list[td->num]->field / (denom), p, p_max_size); \
+#define PRINT_TOP_HR_GENERATOR(name, field, denom)                         \
+  static size_t print_top_##name(struct text_object *obj, char *p,         \
+                                 unsigned int p_max_size) {                \
+    struct top_data *td = (struct top_data *)obj->data.opaque;             \
+    if (!td || !td->list || !td->list[td->num]) return 0;                  \
+    return written_length(                                                 \
+        human_readable(td->list[td->num]->field / (denom), p, p_max_size), \
+        p_max_size);                                                       \
   }
 
 PRINT_TOP_GENERATOR(cpu, (unsigned int)7, "%6.2f", amount)
@@ -574,6 +318,8 @@ int parse_top_args(const char *s, const char *arg, struct text_object *obj) {
   struct top_data *td;
   char buf[64];
   int n;
+  /* how many processes the list of this kind of top has to hold */
+  int *shown;
 
   if (arg == nullptr) {
     NORM_ERR("top needs arguments");
@@ -586,17 +332,17 @@ int parse_top_args(const char *s, const char *arg, struct text_object *obj) {
 
   if (s[3] == 0) {
     td->list = info.cpu;
-    top_cpu = 1;
+    shown = &top_cpu;
   } else if (strcmp(&s[3], "_mem") == EQUAL) {
     td->list = info.memu;
-    top_mem = 1;
+    shown = &top_mem;
   } else if (strcmp(&s[3], "_time") == EQUAL) {
     td->list = info.time;
-    top_time = 1;
+    shown = &top_time;
 #ifdef BUILD_IOSTATS
   } else if (strcmp(&s[3], "_io") == EQUAL) {
     td->list = info.io;
-    top_io = 1;
+    shown = &top_io;
 #endif /* BUILD_IOSTATS */
   } else {
 #ifdef BUILD_IOSTATS
@@ -612,30 +358,30 @@ int parse_top_args(const char *s, const char *arg, struct text_object *obj) {
 
   if (sscanf(arg, "%63s %i", buf, &n) == 2) {
     if (strcmp(buf, "name") == EQUAL) {
-      obj->callbacks.print = &print_top_name;
+      obj->callbacks.print_len = &print_top_name;
     } else if (strcmp(buf, "cpu") == EQUAL) {
-      obj->callbacks.print = &print_top_cpu;
+      obj->callbacks.print_len = &print_top_cpu;
     } else if (strcmp(buf, "pid") == EQUAL) {
-      obj->callbacks.print = &print_top_pid;
+      obj->callbacks.print_len = &print_top_pid;
     } else if (strcmp(buf, "mem") == EQUAL) {
-      obj->callbacks.print = &print_top_mem;
+      obj->callbacks.print_len = &print_top_mem;
     } else if (strcmp(buf, "time") == EQUAL) {
-      obj->callbacks.print = &print_top_time;
+      obj->callbacks.print_len = &print_top_time;
     } else if (strcmp(buf, "mem_res") == EQUAL) {
-      obj->callbacks.print = &print_top_mem_res;
+      obj->callbacks.print_len = &print_top_mem_res;
     } else if (strcmp(buf, "mem_vsize") == EQUAL) {
-      obj->callbacks.print = &print_top_mem_vsize;
+      obj->callbacks.print_len = &print_top_mem_vsize;
     } else if (strcmp(buf, "uid") == EQUAL) {
-      obj->callbacks.print = &print_top_uid;
+      obj->callbacks.print_len = &print_top_uid;
     } else if (strcmp(buf, "user") == EQUAL) {
-      obj->callbacks.print = &print_top_user;
+      obj->callbacks.print_len = &print_top_user;
 #ifdef BUILD_IOSTATS
     } else if (strcmp(buf, "io_read") == EQUAL) {
-      obj->callbacks.print = &print_top_read_bytes;
+      obj->callbacks.print_len = &print_top_read_bytes;
     } else if (strcmp(buf, "io_write") == EQUAL) {
-      obj->callbacks.print = &print_top_write_bytes;
+      obj->callbacks.print_len = &print_top_write_bytes;
     } else if (strcmp(buf, "io_perc") == EQUAL) {
-      obj->callbacks.print = &print_top_io_perc;
+      obj->callbacks.print_len = &print_top_io_perc;
 #endif /* BUILD_IOSTATS */
     } else {
       NORM_ERR("invalid type arg for top");
@@ -657,6 +403,7 @@ int parse_top_args(const char *s, const char *arg, struct text_object *obj) {
       return 0;
     }
     td->num = n - 1;
+    *shown = std::max(*shown, n);
 
   } else {
     NORM_ERR("invalid argument count for top");
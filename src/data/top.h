@@ -77,8 +77,6 @@
  * and it'll take me a while to write a replacement. */
 #define BUFFER_LEN 1024
 
-#define MAX_SP 10  // number of elements to sort
-
 /******************************************
  * Process class						  *
  ******************************************/
@@ -102,6 +100,9 @@ struct process {
   unsigned long previous_total_cpu_time;
   unsigned long long vsize;
   unsigned long long rss;
+  // When the process started, in clock ticks since boot; tells a process
+  // from an earlier one with the same pid (Linux only, 0 until known)
+  unsigned long long starttime;
 #ifdef BUILD_IOSTATS
   unsigned long long read_bytes;
   unsigned long long previous_read_bytes;
@@ -142,9 +143,14 @@ int update_top(void);
 
 void get_top_info(void);
 
-extern struct process *first_process;
 extern unsigned long g_time;
 
+namespace conky {
+class process_table;
+}
+/* all processes top knows about, see process-table.hh */
+conky::process_table &top_processes();
+
 struct process *get_process(pid_t pid);
 
 #endif /* _top_h_ */
@@ -0,0 +1,98 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (C) 2010 Pavel Labath et al.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef LATENCY_HISTOGRAM_HH
+#define LATENCY_HISTOGRAM_HH
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace conky {
+/*
+ * A histogram of durations in microseconds with logarithmic buckets: values
+ * below 4 get a bucket each, every power of two above that is split into 4
+ * buckets, so a bucket is at most 25% wide. The last bucket, which starts at
+ * about 22 days, takes anything longer. Recording takes a few
+ * relaxed atomic increments and may be done from any thread concurrently
+ * with reading.
+ */
+class latency_histogram {
+ public:
+  enum { SUB_BITS = 2, SUB_BUCKETS = 1 << SUB_BITS, BUCKETS = 40 * 4 };
+
+  static size_t bucket_of(uint64_t us) {
+    if (us < SUB_BUCKETS) { return us; }
+    unsigned msb = 63 - __builtin_clzll(us);
+    size_t b = ((msb - SUB_BITS + 1) << SUB_BITS) +
+               ((us >> (msb - SUB_BITS)) & (SUB_BUCKETS - 1));
+    return b < BUCKETS ? b : BUCKETS - 1;
+  }
+
+  /* the smallest value falling into bucket b */
+  static uint64_t bucket_floor(size_t b) {
+    if (b < SUB_BUCKETS) { return b; }
+    unsigned msb = (b >> SUB_BITS) + SUB_BITS - 1;
+    return uint64_t(SUB_BUCKETS + (b & (SUB_BUCKETS - 1)))
+           << (msb - SUB_BITS);
+  }
+
+  void record(uint64_t us) {
+    buckets[bucket_of(us)].fetch_add(1, std::memory_order_relaxed);
+    samples.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(us, std::memory_order_relaxed);
+    uint64_t m = highest.load(std::memory_order_relaxed);
+    while (us > m &&
+           !highest.compare_exchange_weak(m, us, std::memory_order_relaxed)) {
+    }
+  }
+
+  uint64_t count() const { return samples.load(std::memory_order_relaxed); }
+  uint64_t total() const { return sum.load(std::memory_order_relaxed); }
+  uint64_t max() const { return highest.load(std::memory_order_relaxed); }
+
+  /* The value below which the fraction q of the samples lie, rounded down to
+   * its bucket, but never more than max(). 0 without samples. */
+  uint64_t percentile(double q) const {
+    uint64_t n = count();
+    if (n == 0) { return 0; }
+
+    uint64_t rank = static_cast<uint64_t>(q * n);
+    if (rank >= n) { rank = n - 1; }
+    uint64_t seen = 0;
+    for (size_t b = 0; b < BUCKETS; ++b) {
+      seen += buckets[b].load(std::memory_order_relaxed);
+      if (seen > rank) { return std::min(bucket_floor(b), max()); }
+    }
+    return max();
+  }
+
+ private:
+  std::atomic<uint64_t> buckets[BUCKETS]{};
+  std::atomic<uint64_t> samples{0};
+  std::atomic<uint64_t> sum{0};
+  std::atomic<uint64_t> highest{0};
+};
+}  // namespace conky
+
+#endif /* LATENCY_HISTOGRAM_HH */
@@ -29,6 +29,7 @@
 #include "../conky.h"
 #include "../geometry.h"
 #include "../logging.h"
+#include "../update-cb.hh"
 #include "build.h"
 #include "llua.h"
 
@@ -162,6 +163,36 @@ static int llua_conky_parse(lua_State *L) {
   return 1; /* number of results */
 }
 
+/* conky_cb_stats(): what the update callbacks have been up to, a table for
+ * each, see conky::callback_reports(). Times are in seconds. Built only when
+ * called, as it takes a few allocations per callback. */
+static int llua_conky_cb_stats(lua_State *L) {
+  auto reports = conky::callback_reports();
+  auto set_number = [L](const char *key, double value) {
+    lua_pushnumber(L, value);
+    lua_setfield(L, -2, key);
+  };
+
+  lua_createtable(L, reports.size(), 0);
+  for (size_t n = 0; n < reports.size(); ++n) {
+    const auto &r = reports[n];
+
+    lua_createtable(L, 0, 9);
+    lua_pushstring(L, r.name.c_str());
+    lua_setfield(L, -2, "name");
+    set_number("runs", r.runs);
+    set_number("skipped", r.skipped);
+    set_number("timeouts", r.timeouts);
+    set_number("waited", r.waited / 1e6);
+    set_number("total", r.total / 1e6);
+    set_number("p50", r.p50 / 1e6);
+    set_number("p99", r.p99 / 1e6);
+    set_number("max", r.max / 1e6);
+    lua_rawseti(L, -2, n + 1);
+  }
+  return 1; /* number of results */
+}
+
 static int llua_conky_set_update_interval(lua_State *L) {
   int n = lua_gettop(L); /* number of arguments */
   if (n != 1) {
@@ -250,6 +281,9 @@ void llua_init() {
   lua_pushcfunction(lua_L, &llua_conky_set_update_interval);
   lua_setglobal(lua_L, "conky_set_update_interval");
 
+  lua_pushcfunction(lua_L, &llua_conky_cb_stats);
+  lua_setglobal(lua_L, "conky_cb_stats");
+
 #if defined(BUILD_X11)
   /* register tolua++ user types */
   tolua_open(lua_L);
@@ -757,7 +791,7 @@ void print_lua_parse(struct text_object *obj, char *p,
                      unsigned int p_max_size) {
   char *str = llua_getstring(obj->data.s);
   if (str != nullptr) {
-    evaluate(str, p, p_max_size);
+    evaluate(str, p, p_max_size, &obj->evaluated);
     free(str);
   }
 }
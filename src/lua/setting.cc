@@ -26,6 +26,7 @@
 
 #include <algorithm>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -160,6 +161,25 @@ size_t get_next_seq_no() {
 
 namespace priv {
 
+std::atomic<uint64_t> config_setting_base::generation{0};
+
+namespace {
+/* snapshots replaced since the last reclaim_config_snapshots(), and those
+ * replaced before it, which the next one frees */
+std::mutex retired_mutex;
+std::vector<const snapshot_base *> retired, retiring;
+}  // namespace
+
+void config_setting_base::retire(const snapshot_base *snap) {
+  if (snap == nullptr) { return; }
+  std::lock_guard<std::mutex> lock(retired_mutex);
+  retired.push_back(snap);
+}
+
+void config_setting_base::invalidate_snapshots() {
+  generation.fetch_add(1, std::memory_order_acq_rel);
+}
+
 config_setting_base::config_setting_base(std::string name_)
     : name(std::move(name_)), seq_no(get_next_seq_no()) {
   bool inserted = settings->insert({name, this}).second;
@@ -198,6 +218,7 @@ void config_setting_base::process_setting(lua::state &l, bool init) {
   l.pushvalue(-2);
   l.insert(-2);
   l.rawset(-4);
+  invalidate_snapshots();
 }
 
 /*
@@ -255,6 +276,8 @@ void set_config_settings(lua::state &l) {
 
   // Force creation of settings map. In the off chance we have no settings.
   get_next_seq_no();
+  // values cached from a previous config (or state) are no longer valid
+  priv::config_setting_base::invalidate_snapshots();
 
   l.getglobal("conky");
   {
@@ -298,6 +321,16 @@ void set_config_settings(lua::state &l) {
   l.pop();
 }
 
+void reclaim_config_snapshots() {
+  std::vector<const priv::snapshot_base *> done;
+  {
+    std::lock_guard<std::mutex> lock(priv::retired_mutex);
+    done.swap(priv::retiring);
+    priv::retiring.swap(priv::retired);
+  }
+  for (auto snap : done) { delete snap; }
+}
+
 void cleanup_config_settings(lua::state &l) {
   lua::stack_sentry s(l);
   l.checkstack(2);
@@ -313,6 +346,9 @@ void cleanup_config_settings(lua::state &l) {
   }
 
   l.pop();
+
+  priv::config_setting_base::invalidate_snapshots();
+  for (auto setting : v) { setting->drop_snapshots(); }
 }
 
 }  // namespace conky
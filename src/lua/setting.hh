@@ -23,9 +23,13 @@
 #ifndef SETTING_HH
 #define SETTING_HH
 
+#include <atomic>
+#include <cstdint>
 #include <limits>
+#include <memory>
 #include <string>
 #include <type_traits>
+#include <vector>
 
 #include "../logging.h"
 #include "luamm.hh"
@@ -48,6 +52,13 @@ void set_config_settings(lua::state &l);
  */
 void cleanup_config_settings(lua::state &l);
 
+/*
+ * Frees the values cached by get() which were replaced before the previous
+ * call. Called by the main loop once per update, so that a get() has a whole
+ * update to finish reading a value after it was replaced.
+ */
+void reclaim_config_snapshots();
+
 template <typename T, bool is_integral = std::is_integral<T>::value,
           bool floating_point = std::is_floating_point<T>::value,
           bool is_enum = std::is_enum<T>::value>
@@ -139,6 +150,11 @@ struct lua_traits<T, false, false, true> {
 };
 
 namespace priv {
+/* a value cached by get(), see config_setting_template */
+struct snapshot_base {
+  virtual ~snapshot_base() {}
+};
+
 class config_setting_base {
  private:
   static void process_setting(lua::state &l, bool init);
@@ -165,6 +181,21 @@ class config_setting_base {
    */
   virtual void cleanup(lua::state &l) { l.pop(); }
 
+  /*
+   * Bumped whenever the value of any setting may have changed, i.e. when the
+   * config is (re)loaded or cleaned up and when a lua_setter runs. Values
+   * cached by get() are only valid for the generation they were read in.
+   */
+  static std::atomic<uint64_t> generation;
+
+  // Called from cleanup_config_settings(), when the state the cached values
+  // came from is about to go away.
+  virtual void drop_snapshots() {}
+
+  // Frees a snapshot which get() no longer returns, once no get() can still
+  // be reading it, see reclaim_config_snapshots().
+  static void retire(const snapshot_base *snap);
+
  public:
   const std::string name;
   const size_t seq_no;
@@ -184,6 +215,20 @@ class config_setting_base {
    */
   void lua_set(lua::state &l);
 
+  /*
+   * Make every get() go back to the lua state. Only needed if conky.config
+   * was changed behind the back of the setters.
+   */
+  static void invalidate_snapshots();
+
+  /*
+   * The current settings generation, for callers caching something derived
+   * from a setting's value: it changes whenever that value may have.
+   */
+  static uint64_t current_generation() {
+    return generation.load(std::memory_order_acquire);
+  }
+
   friend void conky::set_config_settings(lua::state &l);
   friend void conky::cleanup_config_settings(lua::state &l);
 };
@@ -195,26 +240,63 @@ template <typename T>
 class config_setting_template : public priv::config_setting_base {
  public:
   explicit config_setting_template(const std::string &name_)
-      : config_setting_base(name_) {}
+      : config_setting_base(name_), current(nullptr) {}
+  ~config_setting_template() override { delete current.load(); }
 
   // get the value of the setting as a C++ type
   T get(lua::state &l);
 
  protected:
+  void drop_snapshots() override;
+
   /*
    * Convert the value into a C++ type.
    * stack on entry: | ... value |
    * stack on exit:  | ... |
    */
   virtual T getter(lua::state &l) = 0;
+
+ private:
+  /*
+   * The value as of some generation of some state. Snapshots are immutable
+   * once published, so get() can read the current one with a single atomic
+   * load, without taking the lua lock or touching a reference count. One
+   * which is replaced is retire()d rather than freed, as other threads may
+   * still be copying its value.
+   */
+  struct snapshot : priv::snapshot_base {
+    T value;
+    const lua::state *state;
+    uint64_t generation;
+
+    snapshot(T value_, const lua::state *state_, uint64_t generation_)
+        : value(std::move(value_)), state(state_), generation(generation_) {}
+  };
+  std::atomic<const snapshot *> current;
+
+  T refresh(lua::state &l);
 };
 
 template <typename T>
 T config_setting_template<T>::get(lua::state &l) {
+  const snapshot *snap = current.load(std::memory_order_acquire);
+  if (snap != nullptr && snap->state == &l &&
+      snap->generation == generation.load(std::memory_order_acquire)) {
+    return snap->value;
+  }
+  return refresh(l);
+}
+
+template <typename T>
+T config_setting_template<T>::refresh(lua::state &l) {
   std::lock_guard<lua::state> guard(l);
   lua::stack_sentry s(l);
   l.checkstack(2);
 
+  // read before the lookup, so a setter running meanwhile leaves the
+  // snapshot stale rather than wrong
+  uint64_t gen = generation.load(std::memory_order_acquire);
+
   l.getglobal("conky");
   l.getfield(-1, "config");
   l.replace(-2);
@@ -222,7 +304,15 @@ T config_setting_template<T>::get(lua::state &l) {
   l.getfield(-1, name.c_str());
   l.replace(-2);
 
-  return getter(l);
+  auto *snap = new snapshot(getter(l), &l, gen);
+  T value = snap->value;
+  retire(current.exchange(snap, std::memory_order_acq_rel));
+  return value;
+}
+
+template <typename T>
+void config_setting_template<T>::drop_snapshots() {
+  retire(current.exchange(nullptr, std::memory_order_acq_rel));
 }
 
 /*
@@ -24,8 +24,10 @@
 #define SEMAPHORE_HH
 
 #include <cerrno>
+#include <chrono>
 #include <cstdlib>
 #include <cstring>
+#include <ctime>
 #include <stdexcept>
 
 #if defined(__APPLE__) && defined(__MACH__)
@@ -56,6 +58,13 @@ class semaphore {
 
   void wait() { dispatch_semaphore_wait(sem, DISPATCH_TIME_FOREVER); }
 
+  /* false if the semaphore was not posted within timeout */
+  bool timedwait(std::chrono::nanoseconds timeout) {
+    if (timeout.count() < 0) timeout = std::chrono::nanoseconds(0);
+    return dispatch_semaphore_wait(
+               sem, dispatch_time(DISPATCH_TIME_NOW, timeout.count())) == 0;
+  }
+
   bool trywait() {
     /* XXX Quick patch */
 #define DISPATCH_EAGAIN 49
@@ -100,6 +109,24 @@ class semaphore {
     }
   }
 
+  /* false if the semaphore was not posted within timeout */
+  bool timedwait(std::chrono::nanoseconds timeout) {
+    struct timespec ts;
+    long long ns = timeout.count() > 0 ? timeout.count() : 0;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ns += ts.tv_nsec;
+    ts.tv_sec += ns / 1000000000;
+    ts.tv_nsec = ns % 1000000000;
+    while (sem_timedwait(&sem, &ts)) {
+      if (errno == ETIMEDOUT)
+        return false;
+      else if (errno != EINTR)
+        abort();
+    }
+    return true;
+  }
+
   bool trywait() {
     while (sem_trywait(&sem)) {
       if (errno == EAGAIN)
@@ -0,0 +1,185 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (C) 2010 Pavel Labath et al.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef TIMER_WHEEL_HH
+#define TIMER_WHEEL_HH
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace conky {
+/*
+ * A hierarchical timer wheel holding pointers to T, each with a deadline in
+ * ticks. Level 0 has one slot per tick for the next 64 ticks, each level above
+ * has slots 64 times as wide. Items move down a level whenever the time
+ * reaches their slot ("cascading"), so scheduling, cancelling and firing are
+ * all O(1) regardless of how many items there are or how far their deadlines
+ * lie in the future.
+ *
+ * An item is scheduled at most once; scheduling it again moves it. The wheel
+ * does no locking.
+ */
+template <typename T>
+class timer_wheel {
+ public:
+  typedef uint64_t tick_t;
+
+  explicit timer_wheel(tick_t now = 0) : current(now) {}
+
+  tick_t now() const { return current; }
+  bool empty() const { return where.empty(); }
+  bool contains(T *item) const { return where.count(item) != 0; }
+
+  /* fire item once the time reaches deadline, or on the next tick if it
+   * already has */
+  void schedule(T *item, tick_t deadline) {
+    cancel(item);
+    place(item, std::max(deadline, current + 1));
+  }
+
+  bool cancel(T *item) {
+    auto i = where.find(item);
+    if (i == where.end()) { return false; }
+
+    auto &slot = slots[i->second.first][i->second.second];
+    for (auto e = slot.begin(); e != slot.end(); ++e) {
+      if (e->item == item) {
+        *e = slot.back();
+        slot.pop_back();
+        break;
+      }
+    }
+    where.erase(i);
+    return true;
+  }
+
+  /*
+   * Move the time forward to now, calling expired(item) for every item whose
+   * deadline has passed, in order of deadline. expired may schedule items
+   * again.
+   */
+  template <typename F>
+  void advance(tick_t now, F &&expired) {
+    while (current < now) {
+      tick_t next = next_event();
+      if (next > now) {
+        current = now;
+        break;
+      }
+      current = next - 1;
+      step(expired);
+    }
+  }
+
+  /*
+   * The first tick at which advance() has something to do, i.e. an item
+   * expires or one has to be cascaded. Returns UINT64_MAX if the wheel is
+   * empty.
+   */
+  tick_t next_event() const {
+    tick_t next = UINT64_MAX;
+    if (empty()) { return next; }
+
+    for (tick_t t = current + 1; t <= current + SLOTS; ++t) {
+      if (!slots[0][t & MASK].empty()) {
+        next = t;
+        break;
+      }
+    }
+    for (unsigned l = 1; l < LEVELS; ++l) {
+      const unsigned shift = LEVEL_BITS * l;
+      for (tick_t k = 1; k <= SLOTS; ++k) {
+        tick_t t = ((current >> shift) + k) << shift;
+        if (t >= next) { break; }
+        if (!slots[l][(t >> shift) & MASK].empty()) {
+          next = t;
+          break;
+        }
+      }
+    }
+    return next;
+  }
+
+ private:
+  static const unsigned LEVEL_BITS = 6;
+  static const unsigned LEVELS = 4;
+  static const tick_t SLOTS = tick_t(1) << LEVEL_BITS;
+  static const tick_t MASK = SLOTS - 1;
+  /* the top level spans one slot less than it has, so that an item never
+   * lands in the slot the time is currently in */
+  static const tick_t MAX_SPAN = (SLOTS - 1) << (LEVEL_BITS * (LEVELS - 1));
+
+  struct entry {
+    T *item;
+    tick_t deadline;
+  };
+
+  tick_t current;
+  std::vector<entry> slots[LEVELS][SLOTS];
+  std::unordered_map<T *, std::pair<uint8_t, uint8_t>> where;
+  std::vector<entry> firing;
+
+  void place(T *item, tick_t deadline) {
+    /* items beyond the top level are parked at its far end and placed again
+     * when they are cascaded from there */
+    tick_t d = std::min(std::max(deadline, current), current + MAX_SPAN - 1);
+    tick_t delta = d - current;
+    unsigned l = 0;
+    while (l < LEVELS - 1 && delta >= (SLOTS << (LEVEL_BITS * l))) { ++l; }
+
+    uint8_t s = (d >> (LEVEL_BITS * l)) & MASK;
+    slots[l][s].push_back(entry{item, deadline});
+    where[item] = std::make_pair(static_cast<uint8_t>(l), s);
+  }
+
+  void cascade(unsigned l, unsigned s) {
+    std::vector<entry> moving;
+    moving.swap(slots[l][s]);
+    for (auto &e : moving) { place(e.item, e.deadline); }
+  }
+
+  template <typename F>
+  void step(F &&expired) {
+    ++current;
+    /* higher levels first: what comes down may land in a lower slot which
+     * is due for cascading at this very tick */
+    for (unsigned l = LEVELS - 1; l > 0; --l) {
+      const unsigned shift = LEVEL_BITS * l;
+      if ((current & ((tick_t(1) << shift) - 1)) == 0) {
+        cascade(l, (current >> shift) & MASK);
+      }
+    }
+
+    auto &slot = slots[0][current & MASK];
+    if (slot.empty()) { return; }
+    firing.clear();
+    firing.swap(slot);
+    for (auto &e : firing) { where.erase(e.item); }
+    for (auto &e : firing) { expired(e.item); }
+  }
+};
+}  // namespace conky
+
+#endif /* TIMER_WHEEL_HH */
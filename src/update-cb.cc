@@ -24,22 +24,410 @@
 #include "logging.h"
 
 #include "update-cb.hh"
+#include "timer-wheel.hh"
 
+#include <cxxabi.h>
 #include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
 #include <typeinfo>
+#include <vector>
 
 namespace conky {
 namespace {
 semaphore sem_wait;
 enum { UNUSED_MAX = 5 };
+/* most threads the pool of blocking callbacks grows to */
+enum { BLOCKING_WORKERS_MAX = 16 };
+
+/* the callback with wait which posted sem_wait last, so that the time
+ * run_all_callbacks() spent blocked can be put down to it */
+std::atomic<priv::callback_base *> last_posted{nullptr};
+std::atomic<uint64_t> total_waited{0};
+
+uint64_t micros_since(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+/* Microseconds left until the deadline of an update; a callback which may
+ * take longer must not run on the thread doing the update, where it could
+ * not be left behind. Unlimited without a deadline. */
+uint64_t budget_until(std::chrono::steady_clock::time_point until,
+                      double deadline) {
+  if (deadline <= 0) { return UINT64_MAX; }
+
+  auto now = std::chrono::steady_clock::now();
+  if (now >= until) { return 0; }
+  return std::chrono::duration_cast<std::chrono::microseconds>(until - now)
+      .count();
+}
+
+/* resolution of the deadlines of timed callbacks */
+typedef std::chrono::duration<uint64_t, std::milli> tick;
+
+uint64_t ticks_now() {
+  return std::chrono::duration_cast<tick>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
 }  // namespace
 
 namespace priv {
+/*
+ * A set of worker threads that run the work() of callbacks without a done
+ * pipe. Every worker has its own queue, which run() fills round-robin; a
+ * worker whose queue is empty steals from the back of the others. A callback
+ * is in at most one queue at a time and never runs on two workers at once.
+ *
+ * There are two pools. get() has one worker per core. blocking() is for
+ * callbacks which declare_blocking(). It starts with a single worker and
+ * adds another whenever a callback is queued while all workers are busy,
+ * which for these usually means blocked. It stops growing at
+ * BLOCKING_WORKERS_MAX, so a config with hundreds of execi objects still
+ * uses a bounded number of threads.
+ */
+class callback_pool {
+  struct task_queue {
+    std::mutex mutex;
+    std::deque<callback_base *> tasks;
+  };
+
+  /* one per worker the pool may grow to */
+  std::vector<std::unique_ptr<task_queue>> queues;
+  std::atomic<size_t> next_queue{0};
+  /* workers started so far; changed with mutex held */
+  std::atomic<size_t> workers{0};
+
+  /* see run_parallel() */
+  struct parallel_job {
+    const std::function<void(size_t)> &fn;
+    const size_t count;
+    std::atomic<size_t> next{0}; /* what to call fn with next */
+    std::atomic<size_t> left;    /* calls which have not returned yet */
+
+    parallel_job(const std::function<void(size_t)> &fn_, size_t count_)
+        : fn(fn_), count(count_), left(count_) {}
+
+    /* makes calls until there are none left; returns whether it made the
+     * one which returned last */
+    bool work() {
+      for (size_t i; (i = next++) < count;) {
+        fn(i);
+        if (--left == 0) { return true; }
+      }
+      return false;
+    }
+  };
+
+  std::mutex mutex;
+  std::condition_variable wakeup;
+  std::condition_variable finished;
+  long pending = 0; /* queued tasks; protected by mutex */
+  long idle = 0;    /* workers waiting for tasks; protected by mutex */
+  /* jobs of run_parallel() which may have calls left; protected by mutex */
+  std::vector<std::shared_ptr<parallel_job>> jobs;
+
+  callback_base *take(size_t self);
+  bool help_parallel();
+  void forget_job(const std::shared_ptr<parallel_job> &job);
+  void worker(size_t self);
+  void start_worker();
+
+ public:
+  callback_pool(size_t size, size_t initial);
+
+  void submit(callback_base *cb);
+  bool run_one_waited(uint64_t budget);
+  void wait_idle(callback_base *cb);
+  void notify_finished();
+  void run_parallel(size_t count, const std::function<void(size_t)> &fn);
+
+  /* the pool is never destroyed: callbacks living in static storage may still
+   * need it while they are stopped at exit */
+  static callback_pool &get() {
+    static size_t cores = std::max(1U, std::thread::hardware_concurrency());
+    static callback_pool *pool = new callback_pool(cores, cores);
+    return *pool;
+  }
+
+  static callback_pool &blocking() {
+    static callback_pool *pool = new callback_pool(BLOCKING_WORKERS_MAX, 1);
+    return *pool;
+  }
+};
+
+callback_pool::callback_pool(size_t size, size_t initial) {
+  for (size_t i = 0; i < size; ++i) {
+    queues.emplace_back(new task_queue);
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  while (workers < initial) { start_worker(); }
+}
+
+/* called with mutex held */
+void callback_pool::start_worker() {
+  std::thread(&callback_pool::worker, this, workers.load()).detach();
+  ++workers;
+}
+
+void callback_pool::submit(callback_base *cb) {
+  task_queue &q = *queues[next_queue++ % workers.load()];
+  {
+    std::lock_guard<std::mutex> lock(q.mutex);
+    q.tasks.push_back(cb);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++pending;
+    /* nobody is free to take it */
+    if (pending > idle && workers < queues.size()) { start_worker(); }
+  }
+  wakeup.notify_one();
+}
+
+callback_base *callback_pool::take(size_t self) {
+  callback_base *cb = nullptr;
+
+  for (size_t i = 0; i < queues.size() && cb == nullptr; ++i) {
+    task_queue &q = *queues[(self + i) % queues.size()];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty()) { continue; }
+    /* own tasks are taken from the front, stolen ones from the back */
+    if (i == 0) {
+      cb = q.tasks.front();
+      q.tasks.pop_front();
+    } else {
+      cb = q.tasks.back();
+      q.tasks.pop_back();
+    }
+  }
+  if (cb != nullptr) {
+    std::lock_guard<std::mutex> lock(mutex);
+    --pending;
+  }
+  return cb;
+}
+
+void callback_pool::worker(size_t self) {
+  for (;;) {
+    /* someone is waiting for those */
+    if (help_parallel()) { continue; }
+
+    callback_base *cb = take(self);
+    if (cb == nullptr) {
+      std::unique_lock<std::mutex> lock(mutex);
+      ++idle;
+      wakeup.wait(lock, [this] { return pending > 0 || !jobs.empty(); });
+      --idle;
+      continue;
+    }
+    cb->run_pooled();
+  }
+}
+
+/* Joins the latest job of run_parallel(). Returns false if there was none. */
+bool callback_pool::help_parallel() {
+  std::shared_ptr<parallel_job> job;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (jobs.empty()) { return false; }
+    job = jobs.back();
+  }
+  if (job->work()) { notify_finished(); }
+  forget_job(job);
+  return true;
+}
+
+/* no calls of job are left to make, stop handing it out */
+void callback_pool::forget_job(const std::shared_ptr<parallel_job> &job) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto i = std::find(jobs.begin(), jobs.end(), job);
+  if (i != jobs.end()) { jobs.erase(i); }
+}
+
+void callback_pool::run_parallel(size_t count,
+                                 const std::function<void(size_t)> &fn) {
+  if (count <= 1) {
+    if (count == 1) { fn(0); }
+    return;
+  }
+
+  auto job = std::make_shared<parallel_job>(fn, count);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    jobs.push_back(job);
+  }
+  wakeup.notify_all();
+
+  /* The caller works on it, too, so this never waits for a worker to free
+   * up, even when called from work() on the pool. */
+  job->work();
+  forget_job(job);
+
+  std::unique_lock<std::mutex> lock(mutex);
+  finished.wait(lock, [&job] { return job->left.load() == 0; });
+}
+
+/*
+ * Called by run_all_callbacks() while it waits: runs one queued callback
+ * which the update is waiting for, so that an update never has to wait for
+ * background callbacks to free up a worker. Only callbacks which never took
+ * longer than budget microseconds qualify; ones which have not run yet only
+ * when the budget is unlimited, as they might block for any time. Returns
+ * false if there was none.
+ *
+ * Past the deadline, the update waits for nothing but the writers of shared
+ * state, so it runs those whatever they cost rather than have them queue up
+ * behind callbacks it has left behind.
+ */
+bool callback_pool::run_one_waited(uint64_t budget) {
+  callback_base *cb = nullptr;
+
+  for (auto &q : queues) {
+    std::lock_guard<std::mutex> lock(q->mutex);
+    auto i = std::find_if(
+        q->tasks.begin(), q->tasks.end(), [budget](callback_base *c) {
+          return c->waiting.load() == callback_base::wait_state::WAITED &&
+                 (budget == UINT64_MAX || (c->stats.work.count() != 0 &&
+                                           c->stats.work.max() < budget));
+        });
+    if (i != q->tasks.end()) {
+      cb = *i;
+      q->tasks.erase(i);
+      break;
+    }
+  }
+  if (cb == nullptr) { return false; }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    --pending;
+  }
+  cb->run_pooled();
+  return true;
+}
+
+/*
+ * Wait until cb is neither queued nor running. A queued callback is simply
+ * taken out of its queue.
+ */
+void callback_pool::wait_idle(callback_base *cb) {
+  for (auto &q : queues) {
+    std::unique_lock<std::mutex> qlock(q->mutex);
+    auto i = std::find(q->tasks.begin(), q->tasks.end(), cb);
+    if (i != q->tasks.end()) {
+      q->tasks.erase(i);
+      qlock.unlock();
+      std::lock_guard<std::mutex> lock(mutex);
+      --pending;
+      cb->requests = 0;
+      return;
+    }
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  finished.wait(lock, [cb] { return cb->requests.load() == 0; });
+}
+
+void callback_pool::notify_finished() {
+  { std::lock_guard<std::mutex> lock(mutex); }
+  finished.notify_all();
+}
+
+/*
+ * Starts the timed callbacks without wait from a thread of its own, at their
+ * deadlines, whether an update is going on or not. The timed callbacks with
+ * wait are left to run_all_callbacks().
+ */
+class callback_timer {
+  std::mutex mutex;
+  std::condition_variable wakeup;
+  timer_wheel<callback_base> wheel;
+
+  void fire(callback_base *cb, uint64_t now);
+  void loop();
+
+ public:
+  callback_timer() : wheel(ticks_now()) {
+    std::thread(&callback_timer::loop, this).detach();
+  }
+
+  void schedule(callback_base *cb);
+  void cancel(callback_base *cb);
+  void set_interval(callback_base *cb, uint64_t interval);
+
+  /* never destroyed, for the same reason as the pool */
+  static callback_timer &get() {
+    static callback_timer *timer = new callback_timer;
+    return *timer;
+  }
+};
+
+void callback_timer::schedule(callback_base *cb) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    cb->in_timer = true;
+    wheel.schedule(cb, cb->deadline);
+  }
+  wakeup.notify_one();
+}
+
+void callback_timer::cancel(callback_base *cb) {
+  std::lock_guard<std::mutex> lock(mutex);
+  wheel.cancel(cb);
+}
+
+/*
+ * Changes the interval of a callback the timer may be firing right now. fire()
+ * runs with the mutex held, so once it is ours the callback is not in there,
+ * and an interval of zero takes it off the wheel for good.
+ */
+void callback_timer::set_interval(callback_base *cb, uint64_t interval) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (interval == 0) { wheel.cancel(cb); }
+  cb->interval = interval;
+}
+
+void callback_timer::fire(callback_base *cb, uint64_t now) {
+  uint64_t interval = cb->interval.load();
+
+  /* merged into a callback driven by period */
+  if (interval == 0) { return; }
+
+  cb->run();
+  cb->next_deadline(now, interval);
+  wheel.schedule(cb, cb->deadline);
+}
+
+void callback_timer::loop() {
+  std::unique_lock<std::mutex> lock(mutex);
+  for (;;) {
+    uint64_t now = ticks_now();
+    wheel.advance(now, [this, now](callback_base *cb) { fire(cb, now); });
+
+    uint64_t next = wheel.next_event();
+    if (next == UINT64_MAX) {
+      wakeup.wait(lock);
+    } else {
+      std::chrono::steady_clock::time_point until(
+          std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+              tick(next)));
+      wakeup.wait_until(lock, until);
+    }
+  }
+}
+
 callback_base::~callback_base() { stop(); }
 
 void callback_base::stop() {
+  done = true;
+  if (in_timer) { callback_timer::get().cancel(this); }
+  if (requests.load() != 0) { pool().wait_idle(this); }
   if (thread != nullptr) {
-    done = true;
     sem_start.post();
     if (pipefd.second >= 0) {
       if (write(pipefd.second, "X", 1) != 1) {
@@ -78,10 +466,18 @@ inline bool callback_base::is_equal(const handle &a, const handle &b) {
  * If a callback is not successfully inserted into the set, it must have
  * the same hash as an existing callback. If this is so, merge the incoming
  * callback with the one that prevented insertion. Keep the smaller of the
- * two periods.
+ * two periods. A callback driven by period runs at least once per update, so
+ * it wins over a timed one.
  */
 void callback_base::merge(callback_base &&other) {
-  if (other.period < period) {
+  uint64_t other_interval = other.interval.load();
+  if (interval != 0 && other_interval == 0) {
+    set_interval(0);
+    period = other.period;
+    remaining = 0;
+  } else if (other_interval != 0 && other_interval < interval) {
+    set_interval(other_interval);
+  } else if (other_interval == 0 && other.period < period) {
     period = other.period;
     remaining = 0;
   }
@@ -89,6 +485,15 @@ void callback_base::merge(callback_base &&other) {
   unused = 0;
 }
 
+/* goes through the timer while it may fire the callback */
+void callback_base::set_interval(uint64_t ticks) {
+  if (in_timer) {
+    callback_timer::get().set_interval(this, ticks);
+  } else {
+    interval = ticks;
+  }
+}
+
 /*
  * Register a callback (i.e. insert it into the callbacks set)
  */
@@ -96,19 +501,86 @@ callback_base::handle callback_base::do_register_cb(const handle &h) {
   const auto &p = callbacks.insert(h);
 
   /* insertion failed; callback already exists */
-  if (!p.second) { (*p.first)->merge(std::move(*h)); }
+  if (!p.second) {
+    (*p.first)->merge(std::move(*h));
+  } else if (h->interval != 0) {
+    /* timed callbacks run right away, then every interval */
+    h->deadline = ticks_now();
+    if (!h->wait) { callback_timer::get().schedule(&*h); }
+  }
 
   return *p.first;
 }
 
+/*
+ * The next deadline is the previous one plus the interval, so that a late run
+ * does not shift the ones after it. Runs missed altogether are skipped.
+ */
+void callback_base::next_deadline(uint64_t now, uint64_t step) {
+  deadline += step;
+  if (deadline <= now) { deadline += (now - deadline) / step * step + step; }
+}
+
+uint64_t callback_base::interval_ticks(double seconds) {
+  return std::max<uint64_t>(
+      std::chrono::duration_cast<tick>(
+          std::chrono::duration<double>(seconds))
+          .count(),
+      1);
+}
+
+callback_pool &callback_base::pool() const {
+  return blocking ? callback_pool::blocking() : callback_pool::get();
+}
+
+std::string callback_base::name() const {
+  const char *mangled = typeid(*this).name();
+  int status = -1;
+  char *demangled = abi::__cxa_demangle(mangled, nullptr, nullptr, &status);
+  std::string result(status == 0 ? demangled : mangled);
+  free(demangled);
+  return result;
+}
+
 void callback_base::run() {
-  if (thread == nullptr) {
-    thread = new std::thread(&callback_base::start_routine, this);
+  if (pipefd.first < 0) {
+    if (requests++ == 0) { pool().submit(this); }
+    return;
   }
 
+  /* the timer and the update may both be the first to run() it */
+  std::call_once(thread_started, [this] {
+    thread = new std::thread(&callback_base::start_routine, this);
+  });
+
   sem_start.post();
 }
 
+/* run() for a callback which run_all_callbacks() is going to wait for */
+void callback_base::run_waited() {
+  waiting = wait_state::WAITED;
+  run();
+}
+
+/*
+ * Runs on a pool worker (or the main thread, see run_one_waited()). Like
+ * start_routine(), it folds the run() calls which came in while work() was
+ * busy into one more run.
+ */
+void callback_base::run_pooled() {
+  for (;;) {
+    uint32_t served = requests.load();
+
+    if (!done) {
+      stats.skipped += served - 1;
+      work_timed();
+    }
+    if (requests.fetch_sub(served) == served) { break; }
+  }
+  /* this may be gone as soon as requests dropped to zero */
+  pool().notify_finished();
+}
+
 void callback_base::start_routine() {
   for (;;) {
     sem_start.wait();
@@ -116,34 +588,201 @@ void callback_base::start_routine() {
 
     // clear any remaining posts in case the previous iteration was very slow
     // (this should only happen if wait == false)
-    while (sem_start.trywait()) {
-      // do nothing
-    }
+    while (sem_start.trywait()) { ++stats.skipped; }
+
+    work_timed();
+  }
+}
 
-    work();
-    if (wait) { sem_wait.post(); }
+void callback_base::work_timed() {
+  auto start = std::chrono::steady_clock::now();
+  work();
+  stats.work.record(micros_since(start));
+  generation.fetch_add(1, std::memory_order_release);
+  /* nobody waits any more for a run which was given up on */
+  if (wait && waiting.exchange(wait_state::IDLE) == wait_state::WAITED) {
+    stale = false;
+    last_posted = this;
+    sem_wait.post();
   }
 }
 
 callback_base::Callbacks callback_base::callbacks(1, get_hash, is_equal);
+
+/*
+ * Callbacks with wait and declared parts, due in the current update, and what
+ * became of them. run_all_callbacks() starts each one as soon as nothing it
+ * conflicts with is running or has to run before it.
+ */
+class declared_callbacks {
+  enum class status : uint8_t { PENDING, RUNNING, DONE };
+  struct entry {
+    callback_base *cb;
+    uint64_t generation; /* when it was started */
+    status st;
+  };
+
+  /* kept between updates to not allocate */
+  std::vector<entry> entries;
+  std::vector<entry> ordered;
+
+  static bool conflict(const callback_base *a, const callback_base *b) {
+    return ((a->writes & (b->reads | b->writes)) | (b->writes & a->reads)) !=
+           0;
+  }
+
+  /* whether a has to run before b: it writes what b reads, and not the other
+   * way around */
+  static bool before(const callback_base *a, const callback_base *b) {
+    return (a->writes & b->reads) != 0 && (b->writes & a->reads) == 0;
+  }
+
+ public:
+  bool empty() const { return entries.empty(); }
+
+  /* late callbacks are still busy with a run an earlier update gave up on,
+   * they count as running until that is done */
+  void add(callback_base *cb, bool late) {
+    if (late) {
+      entries.push_back(entry{cb, cb->get_generation(), status::RUNNING});
+    } else {
+      entries.push_back(entry{cb, 0, status::PENDING});
+    }
+  }
+
+  /* Sort writers before readers, keeping the order of the set otherwise.
+   * Should the declarations form a cycle, it is broken at the first
+   * callback of it. */
+  void order() {
+    ordered.clear();
+    while (!entries.empty()) {
+      size_t pick = 0;
+      for (size_t i = 0; i < entries.size(); ++i) {
+        bool waits = false;
+        for (size_t j = 0; j < entries.size() && !waits; ++j) {
+          waits = j != i && before(entries[j].cb, entries[i].cb);
+        }
+        if (!waits) {
+          pick = i;
+          break;
+        }
+      }
+      ordered.push_back(entries[pick]);
+      entries.erase(entries.begin() + pick);
+    }
+    entries.swap(ordered);
+  }
+
+  /* start what may start now, adding it to started */
+  void start_ready(std::vector<callback_base *> &started) {
+    for (size_t i = 0; i < entries.size(); ++i) {
+      if (entries[i].st != status::PENDING) { continue; }
+
+      bool blocked = false;
+      for (size_t j = 0; j < entries.size() && !blocked; ++j) {
+        blocked = j != i &&
+                  (entries[j].st == status::RUNNING ||
+                   (entries[j].st == status::PENDING && j < i)) &&
+                  conflict(entries[j].cb, entries[i].cb);
+      }
+      if (blocked) { continue; }
+
+      entries[i].generation = entries[i].cb->get_generation();
+      entries[i].st = status::RUNNING;
+      entries[i].cb->run_waited();
+      started.push_back(entries[i].cb);
+    }
+  }
+
+  /* notice the callbacks which have finished */
+  void reap() {
+    for (auto &e : entries) {
+      if (e.st == status::RUNNING &&
+          e.cb->get_generation() != e.generation) {
+        e.st = status::DONE;
+      }
+    }
+  }
+
+  /* the ones which could not start before the deadline, or before the
+   * update stopped waiting for late ones, keep their old results */
+  void give_up() {
+    for (auto &e : entries) {
+      if (e.st == status::PENDING) {
+        e.cb->stale = true;
+        ++e.cb->stats.timeouts;
+      }
+    }
+  }
+
+  void clear() { entries.clear(); }
+};
 }  // namespace priv
 
-void run_all_callbacks() {
+void run_all_callbacks(double deadline) {
   using priv::callback_base;
+  static priv::declared_callbacks declared;
+  /* the callbacks with wait started by this update, kept to not allocate */
+  static std::vector<callback_base *> waited;
+
+  auto until = std::chrono::steady_clock::now() +
+               std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::duration<double>(deadline));
+  /* stop waiting for the callbacks which have not finished yet, except for
+   * the ones writing shared state, returns how many there were */
+  auto give_up = [] {
+    using wait_state = callback_base::wait_state;
+    size_t late = 0;
+    for (auto *cb : waited) {
+      if (cb->shared_state) { continue; }
+      wait_state expected = wait_state::WAITED;
+      if (cb->waiting.compare_exchange_strong(expected, wait_state::LATE)) {
+        cb->stale = true;
+        ++cb->stats.timeouts;
+        ++late;
+      }
+    }
+    return late;
+  };
+  auto start = [](callback_base &cb) {
+    bool late = cb.waiting.load() == callback_base::wait_state::LATE;
+    if (cb.wait && (cb.writes | cb.reads) != 0) {
+      declared.add(&cb, late);
+    } else if (!cb.wait) {
+      cb.run();
+    } else if (late) {
+      /* still busy with the run an earlier update gave up on */
+      ++cb.stats.timeouts;
+    } else {
+      cb.run_waited();
+      waited.push_back(&cb);
+    }
+  };
 
-  size_t wait = 0;
   for (auto i = callback_base::callbacks.begin();
        i != callback_base::callbacks.end();) {
     callback_base &cb = **i;
+    uint64_t interval = cb.interval.load();
 
-    /* check whether enough update intervals have elapsed (up to period) */
-    if (cb.remaining-- == 0) {
-      /* run the callback as long as someone holds a pointer to it;
-       * if no one owns the callback, run it at most UNUSED_MAX times */
+    if (interval != 0) {
+      /* timed; the timer takes care of those without wait */
+      if (i->use_count() > 1) {
+        cb.unused = 0;
+      } else {
+        ++cb.unused;
+      }
+      uint64_t now = ticks_now();
+      if (cb.wait && cb.deadline <= now && cb.unused < UNUSED_MAX) {
+        cb.next_deadline(now, interval);
+        start(cb);
+      }
+    } else if (cb.remaining-- == 0) {
+      /* enough update intervals have elapsed (up to period): run the callback
+       * as long as someone holds a pointer to it; if no one owns the
+       * callback, run it at most UNUSED_MAX times */
       if (i->use_count() > 1 || ++cb.unused < UNUSED_MAX) {
         cb.remaining = cb.period - 1;
-        cb.run();
-        if (cb.wait) { ++wait; }
+        start(cb);
       }
     }
     if (cb.unused == UNUSED_MAX) {
@@ -155,6 +794,82 @@ void run_all_callbacks() {
     }
   }
 
-  while (wait-- > 0) { sem_wait.wait(); }
+  declared.order();
+  declared.start_ready(waited);
+
+  size_t wait = waited.size();
+  bool gave_up = false;
+  while (wait > 0) {
+    if (sem_wait.trywait()) {
+      --wait;
+    } else if (!priv::callback_pool::get().run_one_waited(
+                   gave_up ? UINT64_MAX : budget_until(until, deadline))) {
+      /* Once the deadline has passed, the posts still to come are of
+       * callbacks which have just finished, or write shared state. */
+      auto blocked = std::chrono::steady_clock::now();
+      bool posted = true;
+      if (deadline > 0 && !gave_up) {
+        posted = sem_wait.timedwait(until - blocked);
+      } else {
+        sem_wait.wait();
+      }
+      uint64_t us = micros_since(blocked);
+      total_waited += us;
+      if (posted) {
+        last_posted.load()->stats.waited += us;
+        --wait;
+      } else {
+        wait -= give_up();
+        gave_up = true;
+      }
+    }
+    /* Past the deadline the update still blocks on the writers of shared
+     * state, so it keeps starting what has become ready meanwhile, but only
+     * waits for the ones which write shared state themselves. */
+    if (!declared.empty()) {
+      size_t started = waited.size();
+      declared.reap();
+      declared.start_ready(waited);
+      wait += waited.size() - started;
+      if (gave_up && waited.size() != started) { wait -= give_up(); }
+    }
+  }
+  declared.give_up();
+  declared.clear();
+  waited.clear();
+}
+
+std::vector<callback_report> callback_reports() {
+  std::vector<callback_report> reports;
+
+  reports.reserve(priv::callback_base::callbacks.size());
+  for (const auto &h : priv::callback_base::callbacks) {
+    const auto &stats = h->stats;
+    reports.push_back(callback_report{
+        h->name(), stats.work.count(), stats.skipped.load(),
+        stats.timeouts.load(), stats.waited.load(), stats.work.total(),
+        stats.work.percentile(0.5), stats.work.percentile(0.99),
+        stats.work.max()});
+  }
+  std::stable_sort(reports.begin(), reports.end(),
+                   [](const callback_report &a, const callback_report &b) {
+                     return a.total > b.total;
+                   });
+  return reports;
+}
+
+uint64_t callbacks_waited() { return total_waited.load(); }
+
+bool callbacks_stale(const char *name) {
+  for (const auto &h : priv::callback_base::callbacks) {
+    if (h->is_stale() && (name == nullptr || h->name() == name)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void run_parallel(size_t count, const std::function<void(size_t)> &fn) {
+  priv::callback_pool::get().run_parallel(count, fn);
 }
 }  // namespace conky
@@ -27,41 +27,95 @@
 #include <memory>
 #include <thread>
 // the following probably requires a is-gcc-4.7.0 check
+#include <atomic>
+#include <functional>
 #include <mutex>
+#include <string>
 #include <tuple>
 #include <unordered_set>
+#include <vector>
 
 #include <assert.h>
 
 #include "c++wrap.hh"
+#include "latency-histogram.hh"
 #include "semaphore.hh"
 
 namespace conky {
 // forward declarations
 template <typename Callback>
 class callback_handle;
-void run_all_callbacks();
+void run_all_callbacks(double deadline = 0);
+struct callback_report;
+std::vector<callback_report> callback_reports();
+bool callbacks_stale(const char *name);
 template <typename Callback, typename... Params>
 callback_handle<Callback> register_cb(uint32_t period, Params &&...params);
+template <typename Callback, typename... Params>
+callback_handle<Callback> register_timed_cb(double interval,
+                                            Params &&...params);
 
 namespace priv {
+class callback_pool;
+class callback_timer;
+class declared_callbacks;
+
 class callback_base {
   typedef callback_handle<callback_base> handle;
   typedef std::unordered_set<handle, size_t (*)(const handle &),
                              bool (*)(const handle &, const handle &)>
       Callbacks;
 
+  /* Callbacks with a done pipe may block in work() until they are stopped, so
+   * they get a thread of their own. All others run on a callback_pool, see
+   * pool(). */
   semaphore sem_start;
   std::thread *thread;
+  std::once_flag thread_started; /* thread is created by the first run() */
+  /* run() calls not yet served by the pool; non-zero while the callback is
+   * queued or running there */
+  std::atomic<uint32_t> requests;
   const size_t hash; /* used to determined callback uniqueness */
   uint32_t period;   /* how often to run a callback */
   uint32_t
       remaining; /* update intervals remaining until we can run a callback */
+  /* For callbacks registered with register_timed_cb(): how often to run, in
+   * timer ticks, and when to run next. Zero for the ones driven by period. */
+  std::atomic<uint64_t> interval;
+  uint64_t deadline;
+  bool in_timer; /* whether the callback_timer may hold a pointer to it */
+  /* Parts of some shared state that work() writes and reads, as bit masks.
+   * Callbacks with wait whose parts overlap never run at the same time, and
+   * writers run before readers, see run_all_callbacks(). */
+  uint32_t writes;
+  uint32_t reads;
+  /* work() writes state which others read without locking, see
+   * writes_shared_state() */
+  bool shared_state;
+  bool blocking; /* see declare_blocking() */
   std::pair<int, int> pipefd;
   const bool wait; /* whether or not to wait for a callback to finish */
-  bool done;       /* if true, callback is being stopped and destroyed */
+  /* if true, callback is being stopped and destroyed */
+  std::atomic<bool> done;
   uint8_t unused;  /* number of update intervals during which no one owns a
                       callback */
+  std::atomic<uint64_t> generation; /* number of completed work() runs */
+  /* For callbacks with wait: whether run_all_callbacks() is waiting for the
+   * current run, or gave up on it at its deadline. Whoever changes it from
+   * WAITED first decides whether sem_wait gets posted. */
+  enum class wait_state : uint8_t { IDLE, WAITED, LATE };
+  std::atomic<wait_state> waiting;
+  /* the result is older than the last update, see is_stale() */
+  std::atomic<bool> stale;
+
+  /* what became of the runs so far, see callback_reports() */
+  struct statistics {
+    latency_histogram work; /* how long work() took, in microseconds */
+    std::atomic<uint64_t> skipped{0}; /* run()s folded into another run */
+    std::atomic<uint64_t> timeouts{0}; /* updates which gave up waiting */
+    /* microseconds run_all_callbacks() spent blocked until it finished */
+    std::atomic<uint64_t> waited{0};
+  } stats;
 
   callback_base(const callback_base &) = delete;
   callback_base &operator=(const callback_base &) = delete;
@@ -69,8 +123,14 @@ class callback_base {
   virtual bool operator==(const callback_base &) = 0;
 
   void run();
+  void run_waited();
   void start_routine();
+  void run_pooled();
+  void work_timed();
   void stop();
+  void set_interval(uint64_t ticks);
+  /* where run() queues it: the blocking one if it declare_blocking() */
+  callback_pool &pool() const;
 
   static void deleter(callback_base *ptr) {
     ptr->stop();
@@ -85,12 +145,22 @@ class callback_base {
   static inline bool is_equal(const handle &a, const handle &b);
 
   static handle do_register_cb(const handle &h);
+  static uint64_t interval_ticks(double seconds);
+  void next_deadline(uint64_t now, uint64_t step);
 
   template <typename Callback, typename... Params>
   friend callback_handle<Callback> conky::register_cb(uint32_t period,
                                                       Params &&...params);
+  template <typename Callback, typename... Params>
+  friend callback_handle<Callback> conky::register_timed_cb(
+      double interval, Params &&...params);
 
-  friend void conky::run_all_callbacks();
+  friend void conky::run_all_callbacks(double);
+  friend std::vector<callback_report> conky::callback_reports();
+  friend bool conky::callbacks_stale(const char *name);
+  friend class callback_pool;
+  friend class callback_timer;
+  friend class declared_callbacks;
 
   template <typename Callback>
   friend class conky::callback_handle;
@@ -98,18 +168,45 @@ class callback_base {
  protected:
   callback_base(size_t hash_, uint32_t period_, bool wait_, bool use_pipe)
       : thread(nullptr),
+        requests(0),
         hash(hash_),
         period(period_),
         remaining(0),
+        interval(0),
+        deadline(0),
+        in_timer(false),
+        writes(0),
+        reads(0),
+        shared_state(false),
+        blocking(false),
         pipefd(use_pipe ? pipe2(O_CLOEXEC) : std::pair<int, int>(-1, -1)),
         wait(wait_),
         done(false),
-        unused(0) {}
+        unused(0),
+        generation(0),
+        waiting(wait_state::IDLE),
+        stale(false) {}
 
   int donefd() { return pipefd.first; }
 
   bool is_done() { return done; }
 
+  void declare_parts(uint32_t writes_, uint32_t reads_) {
+    writes = writes_;
+    reads = reads_;
+  }
+
+  /* For work() which writes state that is read without locking result_mutex,
+   * like the global info: run_all_callbacks() then waits for it even past its
+   * deadline, as a run left behind would write while the update reads. */
+  void writes_shared_state() { shared_state = true; }
+
+  /* For work() which waits on commands, sockets or the network, for as long
+   * as they take: the callback then runs on a pool of its own kind, so that
+   * a few of them hanging cannot take up every worker of the one the others
+   * run on. Call it from the constructor. */
+  void declare_blocking() { blocking = true; }
+
   // to be implemented by descendant classes
   virtual void work() = 0;
 
@@ -120,6 +217,19 @@ class callback_base {
  public:
   std::mutex result_mutex;
 
+  /* changes every time work() has finished, i.e. whenever the result may have
+   * changed */
+  uint64_t get_generation() const {
+    return generation.load(std::memory_order_acquire);
+  }
+
+  /* Whether the last update went on without waiting for the result, which
+   * is then the one of an earlier update; only callbacks with wait. */
+  bool is_stale() const { return stale.load(); }
+
+  /* how the callback is called in callback_reports(), its type by default */
+  virtual std::string name() const;
+
   virtual ~callback_base();
 };
 
@@ -137,12 +247,43 @@ class callback_handle : private std::shared_ptr<Callback> {
   using Base::operator->;
   using Base::operator*;
 
-  friend void conky::run_all_callbacks();
+  friend void conky::run_all_callbacks(double);
   template <typename Callback_, typename... Params>
   friend callback_handle<Callback_> register_cb(uint32_t period,
                                                 Params &&...params);
+  template <typename Callback_, typename... Params>
+  friend callback_handle<Callback_> register_timed_cb(double interval,
+                                                      Params &&...params);
+};
+
+/* What a registered callback has been up to, times are in microseconds. */
+struct callback_report {
+  std::string name;
+  uint64_t runs;     /* how often work() ran */
+  uint64_t skipped;  /* run()s which came while it was busy, see run() */
+  uint64_t timeouts; /* updates which went on without it, see is_stale() */
+  uint64_t waited;   /* time run_all_callbacks() spent blocked on it */
+  uint64_t total;    /* time spent in work() */
+  uint64_t p50, p99, max;
 };
 
+/* reports of all registered callbacks, the ones which spent the most time in
+ * work() first */
+std::vector<callback_report> callback_reports();
+
+/* microseconds run_all_callbacks() spent blocked waiting for callbacks */
+uint64_t callbacks_waited();
+
+/* whether the callback called name is_stale(), or any callback if name is
+ * null */
+bool callbacks_stale(const char *name);
+
+/* Calls fn(0) to fn(count - 1), in any order and at the same time, on the
+ * threads of the callback pool which are idle and on the calling one, and
+ * returns when all of them returned. For work() which falls apart into
+ * pieces that don't share state. */
+void run_parallel(size_t count, const std::function<void(size_t)> &fn);
+
 template <typename Callback, typename... Params>
 callback_handle<Callback> register_cb(uint32_t period, Params &&...params) {
   return std::dynamic_pointer_cast<Callback>(
@@ -150,6 +291,23 @@ callback_handle<Callback> register_cb(uint32_t period, Params &&...params) {
           new Callback(period, std::forward<Params>(params)...))));
 }
 
+/*
+ * Like register_cb(), but the callback runs every interval seconds, measured
+ * from when it was registered, independently of update_interval. An interval
+ * of zero or less means on every update.
+ */
+template <typename Callback, typename... Params>
+callback_handle<Callback> register_timed_cb(double interval,
+                                            Params &&...params) {
+  priv::callback_base::handle h(
+      new Callback(1, std::forward<Params>(params)...));
+  if (interval > 0) {
+    h->interval = priv::callback_base::interval_ticks(interval);
+  }
+  return std::dynamic_pointer_cast<Callback>(
+      priv::callback_base::do_register_cb(h));
+}
+
 /*
  * Callback uniqueness is determined by the hash computed here.
  */
@@ -185,6 +343,13 @@ struct hash_tuple<0, Elements...> {
  * get_result_copy() returns a copy of the result object and it handles the
  * necessary locking. Don't call it if you hold a lock on the result_mutex.
  *
+ * Instead of writing the result variable, work() may also publish() a new
+ * result once it is complete. Readers then call get_result_ptr(), which
+ * returns the last published result without locking result_mutex or copying
+ * it. A published result is never modified, so a reader may keep using it
+ * for as long as it holds the pointer, even while work() publishes the next
+ * one. This suits large results, like the output of a command.
+ *
  * You should implement the work() function to do the actual updating and store
  * the result in the result variable (lock the mutex while you are doing it,
  * especially if you have wait=false).
@@ -206,6 +371,31 @@ struct hash_tuple<0, Elements...> {
  * periodicity). It should be called from somewhere inside the main loop,
  * according to the update_interval setting. It waits for the callbacks which
  * have wait=true. It leaves the rest to run in background.
+ *
+ * Callbacks registered with register_timed_cb() instead run on a deadline:
+ * every interval seconds, without drifting, whatever update_interval is. With
+ * wait=false they are started by a timer thread, even between updates; with
+ * wait=true, by the first run_all_callbacks() after the deadline.
+ *
+ * run_all_callbacks() may be given a deadline in seconds. Callbacks with
+ * wait=true which have not finished by then are left to finish in the
+ * background; until they have, they are not run again and is_stale() tells
+ * that their result is the one of an earlier update. Such a result may be
+ * written while it is being read, so readers should lock result_mutex or
+ * use a published result. Callbacks which called writes_shared_state() are
+ * never left behind; the update waits for them however long they take, and
+ * meanwhile goes on starting the declared callbacks which become ready.
+ *
+ * Callbacks with wait=true run concurrently, unless they used declare_parts()
+ * to say which parts of some shared state they write and read. Those whose
+ * parts overlap run one after the other, writers before readers.
+ *
+ * work() runs on a pool with one worker thread per core, so it may run on a
+ * different thread each time, but never concurrently with itself. Callbacks
+ * which called declare_blocking() run on a second pool, which grows to a
+ * bounded number of threads while they are blocked. Callbacks created with
+ * use_pipe get a thread of their own instead, as their work() may block until
+ * donefd() becomes readable.
  */
 template <typename Result, typename... Keys>
 class callback : public priv::callback_base {
@@ -220,6 +410,21 @@ class callback : public priv::callback_base {
   const Tuple tuple;
   Result result;
 
+ private:
+  /* accessed with the atomic shared_ptr functions only */
+  std::shared_ptr<const Result> published;
+
+ protected:
+  /* make r the result get_result_ptr() returns, unless it is equal to the
+   * current one, which readers may then keep */
+  void publish(Result r) {
+    auto current = get_result_ptr();
+    if (*current == r) { return; }
+    std::atomic_store_explicit(&published,
+                               std::make_shared<const Result>(std::move(r)),
+                               std::memory_order_release);
+  }
+
   template <size_t i>
   typename std::add_lvalue_reference<
       const typename std::tuple_element<i, Tuple>::type>::type
@@ -232,10 +437,16 @@ class callback : public priv::callback_base {
            bool use_pipe = false)
       : callback_base(priv::hash_tuple<sizeof...(Keys), Keys...>::hash(tuple_),
                       period_, wait_, use_pipe),
-        tuple(tuple_) {}
+        tuple(tuple_),
+        published(std::make_shared<const Result>()) {}
 
   const Result &get_result() { return result; }
 
+  /* the last result publish()ed, a default constructed one before that */
+  std::shared_ptr<const Result> get_result_ptr() const {
+    return std::atomic_load_explicit(&published, std::memory_order_acquire);
+  }
+
   Result get_result_copy() {
     std::lock_guard<std::mutex> l(result_mutex);
     return result;
@@ -1,8 +1,11 @@
 #include "catch2/catch.hpp"
 
 #include <content/algebra.h>
+#include <content/text_object.h>
 #include <config.h>
 
+#include <cstdio>
+
 TEST_CASE("GetMatchTypeTest - ValidOperators") {
   REQUIRE(get_match_type("a==b") == OP_EQ);
   REQUIRE(get_match_type("a!=b") == OP_NEQ);
@@ -131,3 +134,123 @@ TEST_CASE("CompareTest - More test cases") {
   REQUIRE(compare("\"FRITZ!Box 7520 HI\" == \"off/any\"") ==
           0);  // "FRITZ!Box 7520 HI" == "off/any"
 }
+
+namespace {
+uint8_t percentage_value = 0;
+uint8_t test_percentage(struct text_object *) { return percentage_value; }
+
+const char *printed_value = "";
+int print_calls = 0;
+void test_print(struct text_object *, char *p, unsigned int p_max_size) {
+  print_calls++;
+  snprintf(p, p_max_size, "%s", printed_value);
+}
+
+/* the objects the parser builds from an if_match argument like
+ * "${foo} > 50": literal text, an object and literal text again */
+struct match_sub {
+  struct text_object root {};
+  struct text_object objs[3] {};
+  struct match_expression *expr = nullptr;
+
+  match_sub(const char *before, struct obj_cb cb, const char *after) {
+    obj_be_plain_text(&objs[0], before);
+    objs[1].callbacks = cb;
+    obj_be_plain_text(&objs[2], after);
+    for (auto &obj : objs) { append_object(&root, &obj); }
+    expr = parse_match_expression(&root);
+  }
+  ~match_sub() {
+    free_match_expression(expr);
+    gen_free_opaque(&objs[0]);
+    gen_free_opaque(&objs[2]);
+  }
+  int evaluate() { return evaluate_match_expression(expr, &root, 256); }
+};
+
+struct obj_cb percentage_cb() {
+  struct obj_cb cb {};
+  cb.percentage = &test_percentage;
+  return cb;
+}
+
+struct obj_cb print_cb() {
+  struct obj_cb cb {};
+  cb.print = &test_print;
+  return cb;
+}
+
+/* prints "7", then evaluates another expression as an object like
+ * $if_match in the operand would */
+struct match_sub *nested_sub = nullptr;
+int nested_result = 0;
+void nested_print(struct text_object *, char *p, unsigned int p_max_size) {
+  snprintf(p, p_max_size, "7");
+  nested_result = nested_sub->evaluate();
+}
+
+struct obj_cb nested_cb() {
+  struct obj_cb cb {};
+  cb.print = &nested_print;
+  return cb;
+}
+}  // namespace
+
+TEST_CASE("Pre-compiled if_match expressions") {
+  SECTION("constant operands") {
+    struct text_object root {};
+    struct text_object text {};
+    obj_be_plain_text(&text, "1.5 < 2");
+    append_object(&root, &text);
+    struct match_expression *expr = parse_match_expression(&root);
+    REQUIRE(evaluate_match_expression(expr, &root, 256) == 1);
+    free_match_expression(expr);
+    gen_free_opaque(&text);
+  }
+
+  SECTION("percentage objects are compared as numbers") {
+    match_sub sub("", percentage_cb(), " > 50");
+    percentage_value = 70;
+    REQUIRE(sub.evaluate() == 1);
+    percentage_value = 30;
+    REQUIRE(sub.evaluate() == 0);
+    percentage_value = 50;
+    REQUIRE(sub.evaluate() == 0);
+  }
+
+  SECTION("quoted operands are strings whatever they render to") {
+    match_sub sub("\"", print_cb(), "\" == \"42\"");
+    printed_value = "42";
+    REQUIRE(sub.evaluate() == 1);
+    printed_value = "4";
+    REQUIRE(sub.evaluate() == 0);
+  }
+
+  SECTION("unquoted operands are classified on update") {
+    match_sub sub("2.5 <= ", print_cb(), "");
+    printed_value = "3";
+    print_calls = 0;
+    REQUIRE(sub.evaluate() == 1);
+    printed_value = "2";
+    REQUIRE(sub.evaluate() == 0);
+    REQUIRE(print_calls == 2);
+    printed_value = "\"abc\"";
+    REQUIRE(sub.evaluate() == -2);
+  }
+
+  SECTION("expressions in operands render into their own space") {
+    match_sub inner("", print_cb(), " == 9");
+    match_sub outer("", nested_cb(), " == 7");
+    printed_value = "9";
+    nested_sub = &inner;
+    REQUIRE(outer.evaluate() == 1);
+    REQUIRE(nested_result == 1);
+    nested_sub = nullptr;
+  }
+
+  SECTION("operator characters in rendered output are not operators") {
+    match_sub sub("\"", print_cb(), "\" != \"a<b\"");
+    printed_value = "a<b";
+    REQUIRE(sub.evaluate() == 0);
+  }
+}
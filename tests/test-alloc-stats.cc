@@ -0,0 +1,111 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#include <config.h>
+
+#ifdef BUILD_ALLOC_STATS
+#include <alloc-stats.hh>
+#include <conky.h>
+#include <lua/lua-config.hh>
+#include <lua/llua.h>
+
+#include <memory>
+
+/* calls operator new directly, which the compiler may not optimise away the
+ * way it can with new-expressions whose result is unused */
+static void allocate() { ::operator delete(::operator new(16)); }
+
+/* what the main loop does on every update; only graphical outputs lay the
+ * text out */
+static void frame() {
+  update_text();
+#ifdef BUILD_GUI
+  update_text_area();
+#endif /* BUILD_GUI */
+  draw_stuff();
+}
+
+TEST_CASE("allocations are counted per phase", "[alloc-stats]") {
+  SECTION("alloc_counter sees allocations of its thread") {
+    conky::alloc_counter counter;
+    allocate();
+    allocate();
+    REQUIRE(counter.count() == 2);
+  }
+
+  SECTION("phases are attributed and reported per frame") {
+    conky::alloc_frame_done();
+    {
+      conky::alloc_phase_scope phase(conky::alloc_phase::LAYOUT);
+      allocate();
+      allocate();
+    }
+    REQUIRE(conky::set_alloc_phase(conky::alloc_phase::OTHER) ==
+            conky::alloc_phase::OTHER);
+    conky::alloc_frame_done();
+
+    REQUIRE(conky::last_frame_allocs(conky::alloc_phase::LAYOUT) == 2);
+    REQUIRE(conky::last_frame_allocs(conky::alloc_phase::DRAW) == 0);
+  }
+}
+
+TEST_CASE("a steady-state frame does not allocate", "[alloc-stats]") {
+  state = std::make_unique<lua::state>();
+  conky::export_symbols(*state);
+  /* update_text() hands conky_info to lua scripts */
+  llua_init();
+  llua_setup_info(&info, 1);
+
+  load_text(
+      "${conky_version} ${uptime}\n${hr}\n"
+      "${color red}RAM:${color} ${mem}/${memmax} ${memperc}% ${membar 4}\n"
+      "Swap: ${swap} Procs: ${processes}\n"
+      "${scroll 10 1 some text longer than ten characters}\n");
+
+  /* the first frames fill the caches which later frames reuse, and start
+   * the callbacks */
+  for (int i = 0; i < 2; i++) { frame(); }
+
+  /* all phases, including what runs outside of them like the lua hooks */
+  for (int i = 0; i < 3; i++) {
+    conky::alloc_frame_done();
+    frame();
+    conky::alloc_frame_done();
+
+    for (size_t phase = 0; phase < conky::alloc_phase_count; phase++) {
+      INFO("phase " << phase);
+      REQUIRE(conky::last_frame_allocs(
+                  static_cast<conky::alloc_phase>(phase)) == 0);
+    }
+  }
+
+  load_text("");
+}
+#endif /* BUILD_ALLOC_STATS */
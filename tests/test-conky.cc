@@ -43,4 +43,56 @@ TEST_CASE("Expressions can be evaluated", "[evaluate]") {
     evaluate(input, result, kMaxSize);
     REQUIRE(strncmp(input, result, kMaxSize) == 0);
   }
+
+  SECTION("Repeated expressions evaluate like the first time") {
+    constexpr int kMaxSize = 10;
+    char result[kMaxSize]{'\0'};
+
+    for (int i = 0; i < 3; i++) {
+      evaluate("text", result, kMaxSize);
+      REQUIRE(strncmp("text", result, kMaxSize) == 0);
+      evaluate("other", result, kMaxSize);
+      REQUIRE(strncmp("other", result, kMaxSize) == 0);
+    }
+  }
+
+  SECTION("A caller's parsed text is kept until its text changes") {
+    constexpr int kMaxSize = 10;
+    char result[kMaxSize]{'\0'};
+    struct evaluated_text *cache = nullptr;
+
+    evaluate("text", result, kMaxSize, &cache);
+    struct evaluated_text *first = cache;
+    REQUIRE(first != nullptr);
+    evaluate("text", result, kMaxSize, &cache);
+    REQUIRE(cache == first);
+    REQUIRE(strncmp("text", result, kMaxSize) == 0);
+
+    evaluate("other", result, kMaxSize, &cache);
+    REQUIRE(strncmp("other", result, kMaxSize) == 0);
+
+    free_evaluated_text(&cache);
+    REQUIRE(cache == nullptr);
+  }
+}
+
+TEST_CASE("wrap_text breaks lines after max_text_width characters",
+          "[wrap_text]") {
+  char out[32];
+
+  SECTION("long lines are broken, short ones are left alone") {
+    REQUIRE(wrap_text("abcdefg\nab\nabcd", out, sizeof(out), 3));
+    REQUIRE(std::string(out) == "abc\ndef\ng\nab\nabc\nd");
+  }
+
+  SECTION("a multibyte character counts as one column") {
+    REQUIRE(wrap_text("äöüß", out, sizeof(out), 2));
+    REQUIRE(std::string(out) == "äö\nüß");
+  }
+
+  SECTION("breaks which don't fit are left out") {
+    char small[8];
+    REQUIRE_FALSE(wrap_text("abcdef", small, sizeof(small), 2));
+    REQUIRE(std::string(small) == "ab\ncdef");
+  }
 }
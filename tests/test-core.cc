@@ -29,6 +29,10 @@
 #include "catch2/catch.hpp"
 
 #include <core.h>
+#include <lua/lua-config.hh>
+
+#include <string>
+#include <vector>
 
 TEST_CASE("remove_comments returns correct value") {
   SECTION("for no comments") {
@@ -66,3 +70,30 @@ TEST_CASE("remove_comments returns correct value") {
     REQUIRE(removed_chars == 6);
   }
 }
+
+TEST_CASE("construct 10k text objects", "[.][benchmark][core]") {
+  state = std::make_unique<lua::state>();
+  conky::export_symbols(*state);
+
+  // extract_variable_text_internal() caps its input at max_user_text, so the
+  // synthetic config is parsed as a series of 100-object lines.
+  static const char *names[] = {"conky_version", "nodename", "kernel",
+                                "machine",       "uptime",   "mem",
+                                "hr",            "alignr",   "loadavg",
+                                "time"};
+  std::string line;
+  for (int i = 0; i < 100; i++) {
+    line += "${";
+    line += names[i % (sizeof(names) / sizeof(names[0]))];
+    line += "} ";
+  }
+
+  BENCHMARK("parse") {
+    std::vector<struct text_object> roots(100);
+    for (auto &root : roots) {
+      extract_variable_text_internal(&root, line.c_str());
+    }
+    for (auto &root : roots) { free_text_objects(&root); }
+    return roots.size();
+  };
+}
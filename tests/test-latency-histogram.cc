@@ -0,0 +1,83 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#include <latency-histogram.hh>
+
+#include <thread>
+#include <vector>
+
+using conky::latency_histogram;
+
+TEST_CASE("latency_histogram buckets are contiguous", "[latency-histogram]") {
+  for (size_t b = 0; b < latency_histogram::BUCKETS; ++b) {
+    uint64_t floor = latency_histogram::bucket_floor(b);
+    REQUIRE(latency_histogram::bucket_of(floor) == b);
+    if (b > 0) { REQUIRE(latency_histogram::bucket_of(floor - 1) == b - 1); }
+    /* no bucket is wider than a quarter of its values */
+    if (b >= latency_histogram::SUB_BUCKETS &&
+        b + 1 < latency_histogram::BUCKETS) {
+      REQUIRE(latency_histogram::bucket_floor(b + 1) - floor <= floor / 4);
+    }
+  }
+  REQUIRE(latency_histogram::bucket_of(UINT64_MAX) ==
+          latency_histogram::BUCKETS - 1);
+}
+
+TEST_CASE("latency_histogram percentiles", "[latency-histogram]") {
+  latency_histogram h;
+  REQUIRE(h.percentile(0.5) == 0);
+
+  for (uint64_t us = 1; us <= 1000; ++us) { h.record(us); }
+  REQUIRE(h.count() == 1000);
+  REQUIRE(h.total() == 500500);
+  REQUIRE(h.max() == 1000);
+
+  /* rounded down to the bucket, at most 25% off */
+  REQUIRE(h.percentile(0.5) <= 501);
+  REQUIRE(h.percentile(0.5) >= 501 * 3 / 4);
+  REQUIRE(h.percentile(0.99) <= 991);
+  REQUIRE(h.percentile(0.99) >= 991 * 3 / 4);
+  REQUIRE(h.percentile(1) <= h.max());
+}
+
+TEST_CASE("latency_histogram records from many threads",
+          "[latency-histogram]") {
+  latency_histogram h;
+  std::vector<std::thread> threads;
+
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&h, t] {
+      for (uint64_t i = 0; i < 10000; ++i) { h.record(i + t); }
+    });
+  }
+  for (auto &t : threads) { t.join(); }
+  REQUIRE(h.count() == 40000);
+  REQUIRE(h.max() == 10002);
+}
@@ -0,0 +1,132 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#include <data/os/proc-events.hh>
+
+#include <linux/cn_proc.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+namespace {
+struct proc_event fork_event(pid_t pid, pid_t tgid) {
+  struct proc_event event;
+  memset(&event, 0, sizeof(event));
+  event.what = static_cast<decltype(event.what)>(0x00000001);
+  event.event_data.fork.parent_pid = event.event_data.fork.parent_tgid = 1;
+  event.event_data.fork.child_pid = pid;
+  event.event_data.fork.child_tgid = tgid;
+  return event;
+}
+
+struct proc_event exit_event(pid_t pid, pid_t tgid) {
+  struct proc_event event;
+  memset(&event, 0, sizeof(event));
+  event.what = static_cast<decltype(event.what)>(0x80000000);
+  event.event_data.exit.process_pid = pid;
+  event.event_data.exit.process_tgid = tgid;
+  return event;
+}
+}  // namespace
+
+TEST_CASE("process events keep the set of pids", "[proc-events]") {
+  std::unordered_set<pid_t> pids{1, 100};
+
+  SECTION("forked processes are added") {
+    conky::proc_events::apply(fork_event(200, 200), pids);
+    REQUIRE(pids == std::unordered_set<pid_t>{1, 100, 200});
+  }
+
+  SECTION("exited processes are removed") {
+    conky::proc_events::apply(exit_event(100, 100), pids);
+    REQUIRE(pids == std::unordered_set<pid_t>{1});
+  }
+
+  SECTION("threads are not processes") {
+    conky::proc_events::apply(fork_event(101, 100), pids);
+    conky::proc_events::apply(exit_event(102, 100), pids);
+    REQUIRE(pids == std::unordered_set<pid_t>{1, 100});
+  }
+
+  SECTION("other events change nothing") {
+    struct proc_event exec = fork_event(300, 300);
+    exec.what = static_cast<decltype(exec.what)>(0x00000002);
+    conky::proc_events::apply(exec, pids);
+    REQUIRE(pids == std::unordered_set<pid_t>{1, 100});
+  }
+}
+
+TEST_CASE("process events are received or refused", "[proc-events]") {
+  conky::proc_events events;
+  std::unordered_set<pid_t> pids;
+
+  if (!events.start()) {
+    /* unprivileged or in a container, like most test runs */
+    REQUIRE_FALSE(events.listening());
+    REQUIRE_FALSE(events.start());
+    REQUIRE_FALSE(events.update(pids));
+    return;
+  }
+
+  /* what's known right after start() is not to be trusted */
+  REQUIRE_FALSE(events.update(pids));
+
+  /* the child lives until the pipe is closed */
+  int lifeline[2];
+  REQUIRE(pipe(lifeline) == 0);
+  pid_t child = fork();
+  if (child == 0) {
+    char c;
+    close(lifeline[1]);
+    while (read(lifeline[0], &c, 1) > 0) {}
+    _exit(0);
+  }
+  REQUIRE(child > 0);
+  close(lifeline[0]);
+
+  for (int i = 0; i < 1000 && pids.count(child) == 0; ++i) {
+    REQUIRE(events.update(pids));
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  REQUIRE(pids.count(child) == 1);
+
+  close(lifeline[1]);
+  waitpid(child, nullptr, 0);
+  for (int i = 0; i < 1000 && pids.count(child) == 1; ++i) {
+    REQUIRE(events.update(pids));
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  REQUIRE(pids.count(child) == 0);
+
+  events.stop();
+  REQUIRE_FALSE(events.listening());
+}
@@ -0,0 +1,195 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#include <data/os/proc-fields.hh>
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+
+namespace {
+/* the parsers look past the end of a line, so keep lines in a string and
+ * let them read to its end, like to the end of a procfs_file buffer */
+size_t parse(const std::string &text, unsigned long long *out, size_t n) {
+  const char *p = text.data();
+  return conky::parse_uints(p, text.data() + text.size(), out, n);
+}
+
+/* a /proc/stat like the one of a machine with that many CPUs */
+std::string make_stat(int cpus) {
+  std::mt19937_64 random(cpus);
+  std::string stat;
+  for (int i = -1; i < cpus; ++i) {
+    stat += i < 0 ? "cpu " : "cpu" + std::to_string(i);
+    for (int j = 0; j < 10; ++j) {
+      stat += ' ' + std::to_string(random() % 100000000000ULL);
+    }
+    stat += '\n';
+  }
+  stat += "intr 1234567 0 9 0 0 0 0 0 0 0 0\nctxt 987654321\n";
+  stat += "procs_running 3\nprocs_blocked 0\n";
+  return stat;
+}
+}  // namespace
+
+TEST_CASE("parse_uints reads blank separated numbers", "[proc-fields]") {
+  unsigned long long out[8] = {0};
+
+  SECTION("numbers of any length") {
+    std::string text = "0 7 42 18446744073709551615 1234567890123456789\n";
+    REQUIRE(parse(text, out, 8) == 5);
+    REQUIRE(out[0] == 0);
+    REQUIRE(out[1] == 7);
+    REQUIRE(out[2] == 42);
+    REQUIRE(out[3] == 18446744073709551615ULL);
+    REQUIRE(out[4] == 1234567890123456789ULL);
+  }
+
+  SECTION("runs of blanks, like in /proc/net/dev") {
+    std::string text = "  1\t2     3                                 4";
+    REQUIRE(parse(text, out, 8) == 4);
+    REQUIRE(out[3] == 4);
+  }
+
+  SECTION("no more than asked for") {
+    std::string text = "1 2 3 4";
+    const char *p = text.data();
+    REQUIRE(conky::parse_uints(p, text.data() + text.size(), out, 2) == 2);
+    REQUIRE(std::string(p) == " 3 4");
+  }
+
+  SECTION("up to the end of the line") {
+    std::string text = "1 2\n3 4\n";
+    REQUIRE(parse(text, out, 8) == 2);
+  }
+
+  SECTION("up to a field which isn't a number") {
+    std::string text = "1 2 sda 3";
+    REQUIRE(parse(text, out, 8) == 2);
+    REQUIRE(parse("-1 2", out, 8) == 0);
+  }
+
+  SECTION("up to where it may read") {
+    std::string text = "12345 678";
+    const char *p = text.data();
+    REQUIRE(conky::parse_uints(p, text.data() + 3, out, 8) == 1);
+    REQUIRE(out[0] == 123);
+  }
+}
+
+TEST_CASE("parse_ints reads negative numbers", "[proc-fields]") {
+  std::string text = "-20 0 19 - 5";
+  long long out[4];
+  const char *p = text.data();
+  REQUIRE(conky::parse_ints(p, text.data() + text.size(), out, 4) == 3);
+  REQUIRE(out[0] == -20);
+  REQUIRE(out[1] == 0);
+  REQUIRE(out[2] == 19);
+}
+
+TEST_CASE("fields can be skipped and taken", "[proc-fields]") {
+  std::string text =
+      "   8       0 sda 1 2 3 4\n 259       0 a-rather-long-device-name 5";
+  const char *end = text.data() + text.size();
+  const char *p = text.data();
+  unsigned long long out[4];
+
+  REQUIRE(conky::parse_uints(p, end, out, 2) == 2);
+  size_t length = conky::next_field(p, end);
+  REQUIRE(std::string(p, length) == "sda");
+  p += length;
+  REQUIRE(conky::parse_uints(p, end, out, 4) == 4);
+  REQUIRE(out[3] == 4);
+  REQUIRE(conky::next_field(p, end) == 0);
+
+  p = conky::skip_fields(p + 1, end, 2);
+  length = conky::next_field(p, end);
+  REQUIRE(std::string(p, length) == "a-rather-long-device-name");
+
+  /* skipping stops at the end of the line, too */
+  p = text.data();
+  p = conky::skip_fields(p, end, 100);
+  REQUIRE(*p == '\n');
+}
+
+TEST_CASE("parse_uints agrees with sscanf", "[proc-fields]") {
+  /* lines of random blanks and numbers, long enough to be classified 16
+   * bytes at a time, but also ending anywhere in a block */
+  std::mt19937 random(42);
+  for (int i = 0; i < 1000; ++i) {
+    std::string text;
+    unsigned long long expected[6];
+    for (auto &number : expected) {
+      text.append(1 + random() % 20, random() % 4 ? ' ' : '\t');
+      number = std::uniform_int_distribution<unsigned long long>()(random) >>
+               (random() % 64);
+      text += std::to_string(number);
+    }
+
+    unsigned long long scanned[6], parsed[6];
+    REQUIRE(sscanf(text.c_str(), "%llu %llu %llu %llu %llu %llu", &scanned[0],
+                   &scanned[1], &scanned[2], &scanned[3], &scanned[4],
+                   &scanned[5]) == 6);
+    REQUIRE(parse(text, parsed, 6) == 6);
+    for (int j = 0; j < 6; ++j) {
+      REQUIRE(parsed[j] == expected[j]);
+      REQUIRE(scanned[j] == expected[j]);
+    }
+  }
+}
+
+TEST_CASE("parse /proc/stat of 256 CPUs", "[.][benchmark][proc-fields]") {
+  std::string stat = make_stat(256);
+  const char *end = stat.data() + stat.size();
+
+  BENCHMARK("sscanf") {
+    unsigned long long total = 0, v[8];
+    for (const char *line = stat.data(); line < end;
+         line = strchr(line, '\n') + 1) {
+      if (strncmp(line, "cpu", 3) != 0) { continue; }
+      sscanf(line, "%*s %llu %llu %llu %llu %llu %llu %llu %llu", &v[0],
+             &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7]);
+      total += v[0] + v[7];
+    }
+    return total;
+  };
+  BENCHMARK("parse_uints") {
+    unsigned long long total = 0, v[8];
+    for (const char *line = stat.data(); line < end;
+         line = strchr(line, '\n') + 1) {
+      if (strncmp(line, "cpu", 3) != 0) { continue; }
+      const char *p = conky::skip_fields(line, end, 1);
+      conky::parse_uints(p, end, v, 8);
+      total += v[0] + v[7];
+    }
+    return total;
+  };
+}
@@ -0,0 +1,358 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#include <common.h>
+#include <conky.h>
+#include <content/text_object.h>
+#include <data/hardware/diskio.h>
+#include <data/network/net_stat.h>
+#include <data/os/linux.h>
+#include <data/os/procfs.hh>
+#include <lua/lua-config.hh>
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <sys/stat.h>
+
+namespace {
+/* the collectors read config settings, which need a state */
+void ensure_lua_state() {
+  if (state) { return; }
+  state = std::make_unique<lua::state>();
+  conky::export_symbols(*state);
+}
+
+/* a directory standing in for the root of /proc and /sys */
+struct fixture_root {
+  std::string dir;
+
+  fixture_root() {
+    char tmpl[] = "/tmp/conky-procfs-XXXXXX";
+    dir = mkdtemp(tmpl);
+    mkdir((dir + "/proc").c_str(), 0755);
+    conky::set_procfs_root(dir);
+  }
+  ~fixture_root() {
+    conky::set_procfs_root("");
+    std::filesystem::remove_all(dir);
+  }
+
+  void write(const char *path, const std::string &text) const {
+    std::ofstream(dir + path, std::ios::trunc) << text;
+  }
+
+  void make_dirs(const char *path) const {
+    std::filesystem::create_directories(dir + path);
+  }
+};
+
+/* a /proc/stat line of a cpu with 25% of total jiffies active */
+std::string stat_line(const std::string &cpu, unsigned long long total) {
+  return cpu + " " + std::to_string(total / 4) + " 0 0 " +
+         std::to_string(total - total / 4) + " 0 0 0 0 0 0\n";
+}
+}  // namespace
+
+TEST_CASE("procfs_file reads files line by line", "[procfs]") {
+  fixture_root root;
+  conky::procfs_file file("/proc/stat");
+
+  SECTION("lines lose their newlines") {
+    root.write("/proc/stat", "cpu 1 2 3\ncpu0 1 2 3\nintr 5\n");
+    REQUIRE(file.read());
+    REQUIRE(std::string(file.next_line()) == "cpu 1 2 3");
+    REQUIRE(std::string(file.next_line()) == "cpu0 1 2 3");
+    REQUIRE(std::string(file.next_line()) == "intr 5");
+    REQUIRE(file.next_line() == nullptr);
+  }
+
+  SECTION("the last line doesn't need a newline") {
+    root.write("/proc/stat", "one\ntwo");
+    REQUIRE(file.read());
+    REQUIRE(std::string(file.next_line()) == "one");
+    REQUIRE(std::string(file.next_line()) == "two");
+    REQUIRE(file.next_line() == nullptr);
+    REQUIRE(file.contents() == std::string_view("one\0two", 7));
+  }
+
+  SECTION("files larger than the buffer are read whole") {
+    std::string text;
+    for (int i = 0; i < 1000; ++i) {
+      text += "line " + std::to_string(i) + "\n";
+    }
+    REQUIRE(text.size() > 4096);
+    root.write("/proc/stat", text);
+
+    REQUIRE(file.read());
+    REQUIRE(file.contents().size() == text.size());
+    int lines = 0;
+    while (char *line = file.next_line()) {
+      REQUIRE(std::string(line) == "line " + std::to_string(lines));
+      ++lines;
+    }
+    REQUIRE(lines == 1000);
+  }
+
+  SECTION("reading again sees new contents") {
+    root.write("/proc/stat", "first version\n");
+    REQUIRE(file.read());
+    REQUIRE(std::string(file.next_line()) == "first version");
+
+    /* rewritten in place, like the kernel regenerates it */
+    root.write("/proc/stat", "second\n");
+    REQUIRE(file.read());
+    REQUIRE(file.contents() == "second\n");
+    REQUIRE(std::string(file.next_line()) == "second");
+    REQUIRE(file.next_line() == nullptr);
+  }
+
+  SECTION("missing files fail to read") {
+    conky::procfs_file missing("/proc/does-not-exist");
+    REQUIRE_FALSE(missing.read());
+    REQUIRE(missing.next_line() == nullptr);
+    REQUIRE(missing.contents().empty());
+  }
+}
+
+TEST_CASE("procfs_file follows the procfs root", "[procfs]") {
+  fixture_root first;
+  first.write("/proc/loadavg", "0.10 0.20 0.30 1/100 42\n");
+
+  conky::procfs_file file("/proc/loadavg");
+  REQUIRE(file.read());
+  REQUIRE(file.contents() == "0.10 0.20 0.30 1/100 42\n");
+
+  {
+    fixture_root second;
+    second.write("/proc/loadavg", "1.00 2.00 3.00 2/200 43\n");
+    REQUIRE(conky::procfs_path("/sys/block/") == second.dir + "/sys/block/");
+
+    REQUIRE(file.read());
+    REQUIRE(file.contents() == "1.00 2.00 3.00 2/200 43\n");
+  }
+
+  /* back on the real /proc */
+  REQUIRE(conky::procfs_path("/proc/loadavg") == "/proc/loadavg");
+  REQUIRE(file.read());
+  REQUIRE(file.contents().find('/') != std::string_view::npos);
+}
+
+TEST_CASE("update_meminfo fills the memory fields of info", "[procfs]") {
+  ensure_lua_state();
+  fixture_root root;
+  root.write("/proc/meminfo",
+             "MemTotal:        1000 kB\n"
+             "MemFree:          200 kB\n"
+             "MemAvailable:     600 kB\n"
+             "Buffers:           50 kB\n"
+             "Cached:           300 kB\n"
+             "SwapCached:         9 kB\n"
+             "SwapTotal:        500 kB\n"
+             "SwapFree:         100 kB\n"
+             "Dirty:              7 kB\n"
+             "Shmem:             20 kB\n"
+             "SReclaimable:      30 kB\n");
+
+  update_meminfo();
+  REQUIRE(info.memmax == 1000);
+  REQUIRE(info.memfree == 200);
+  REQUIRE(info.memavail == 600);
+  REQUIRE(info.buffers == 50);
+  REQUIRE(info.cached == 300);
+  REQUIRE(info.memdirty == 7);
+  REQUIRE(info.shmem == 20);
+  REQUIRE(info.swapmax == 500);
+  REQUIRE(info.swapfree == 100);
+  REQUIRE(info.swap == 400);
+  REQUIRE(info.memwithbuffers == 800);
+  /* cached without shmem, plus buffers and the reclaimable slab */
+  REQUIRE(info.bufmem == 360);
+  REQUIRE(info.legacymem == 420);
+  REQUIRE(info.free_cached == 330);
+  REQUIRE(info.free_bufcache == 380);
+  /* no_buffers is on by default */
+  REQUIRE(info.mem == 400);
+  REQUIRE(info.memeasyfree == 560);
+
+  SECTION("a missing file zeroes them") {
+    fixture_root empty;
+    update_meminfo();
+    REQUIRE(info.memmax == 0);
+    REQUIRE(info.swapmax == 0);
+  }
+}
+
+TEST_CASE("update_stat computes cpu usage from /proc/stat", "[procfs]") {
+  ensure_lua_state();
+  fixture_root root;
+  get_cpu_count();
+  REQUIRE(info.cpu_usage != nullptr);
+
+  /* every cpu, and all of them, gain 100 jiffies per update, 25 active */
+  for (unsigned long long total = 100; total <= 300; total += 100) {
+    std::string text = stat_line("cpu", total * info.cpu_count);
+    for (unsigned int i = 0; i < info.cpu_count; ++i) {
+      text += stat_line("cpu" + std::to_string(i), total);
+    }
+    root.write("/proc/stat", text + "intr 5\nprocs_running 3\n");
+
+    /* usage is only sampled this far apart */
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    current_update_time = get_time();
+    update_stat();
+  }
+
+  /* the average of the last two samples, both 25% */
+  for (unsigned int i = 0; i <= info.cpu_count; ++i) {
+    REQUIRE_THAT(info.cpu_usage[i], Catch::Matchers::WithinRel(0.25, 0.001));
+  }
+  REQUIRE(info.run_threads == 3);
+
+  /* like a reload does, so the next get_cpu_count() starts afresh */
+  free_and_zero(info.cpu_usage);
+}
+
+TEST_CASE("calc_cpu_total counts the jiffies since its last call",
+          "[procfs]") {
+  fixture_root root;
+  root.write("/proc/stat", "cpu 10 0 0 0 5 5 5 5 7 7\ncpu0 1 2 3 4\n");
+  calc_cpu_total();
+
+  /* the guest fields at the end are part of user already */
+  root.write("/proc/stat", "cpu 20 1 2 3 5 5 5 5 99 99\ncpu0 1 2 3 4\n");
+  REQUIRE(calc_cpu_total() == 16);
+  REQUIRE(calc_cpu_total() == 0);
+}
+
+TEST_CASE("update_diskio reads sectors from /proc/diskstats", "[procfs]") {
+  ensure_lua_state();
+  fixture_root root;
+  root.make_dirs("/sys/block/conkytestd");
+  struct diskio_stat *disk = prepare_diskio_stat("conkytestd");
+  struct diskio_stat *part = prepare_diskio_stat("conkytestd1");
+
+  /* a disk has reads merged sectors ms writes merged sectors ..., a
+   * partition of an old kernel reads sectors writes sectors; loop devices
+   * are left out of the totals */
+  auto diskstats = [&root](unsigned int n) {
+    root.write("/proc/diskstats",
+               "   8       0 conkytestd 9 9 " + std::to_string(2000 + 200 * n) +
+                   " 9 9 9 " + std::to_string(4000 + 400 * n) +
+                   " 9 9 9 9\n"
+                   "   8       1 conkytestd1 9 " +
+                   std::to_string(200 + 60 * n) + " 9 " +
+                   std::to_string(400 + 40 * n) +
+                   "\n"
+                   "   7       0 loop0 9 9 5000 9 9 9 5000 9 9 9 9\n");
+  };
+  diskstats(0);
+  update_diskio();
+  diskstats(1);
+  update_diskio();
+
+  /* in bytes, over diskio_avg_samples of 2, the first of which was 0 */
+  REQUIRE(disk->current_read == 100 * 1024 / 2);
+  REQUIRE(disk->current_write == 200 * 1024 / 2);
+  REQUIRE(disk->current == 300 * 1024 / 2);
+  REQUIRE(part->current_read == 30 * 1024 / 2);
+  REQUIRE(part->current_write == 20 * 1024 / 2);
+  REQUIRE(stats.current_read == disk->current_read);
+  REQUIRE(stats.current_write == disk->current_write);
+
+  clear_diskio_stats();
+}
+
+TEST_CASE("update_net_stats reads bytes from /proc/net/dev", "[procfs]") {
+  ensure_lua_state();
+  fixture_root root;
+  root.make_dirs("/proc/net");
+
+  /* received bytes are field 0, transmitted ones field 8 */
+  auto net_dev = [&root](unsigned int recv, unsigned int trans) {
+    root.write("/proc/net/dev",
+               "Inter-|   Receive |  Transmit\n"
+               " face |bytes packets errs drop fifo frame compressed "
+               "multicast|bytes packets errs drop fifo colls carrier "
+               "compressed\n"
+               "conkytest0: " +
+                   std::to_string(recv) + " 1 2 3 4 5 6 7 " +
+                   std::to_string(trans) + " 9 10 11 12 13 14 15\n");
+  };
+  last_update_time = 10;
+  current_update_time = 11;
+  net_dev(1000, 2000);
+  update_net_stats();
+  struct net_stat *ns = get_net_stat("conkytest0", nullptr, nullptr);
+  REQUIRE(ns->recv == 1000);
+  REQUIRE(ns->trans == 2000);
+
+  last_update_time = 11;
+  current_update_time = 12;
+  net_dev(1500, 2100);
+  update_net_stats();
+  REQUIRE(ns->up == 1);
+  REQUIRE(ns->recv == 1500);
+  REQUIRE(ns->trans == 2100);
+  /* per second, over net_avg_samples of 2, the first of which was 0 */
+  REQUIRE(ns->recv_speed == 250);
+  REQUIRE(ns->trans_speed == 50);
+
+  SECTION("text objects see what was published") {
+    struct text_object obj {};
+    obj.data.opaque = ns;
+    char shown[64], expected[64];
+    print_totaldown(&obj, shown, sizeof(shown));
+    human_readable(1500, expected, sizeof(expected));
+    REQUIRE(std::string(shown) == expected);
+  }
+
+  clear_net_stats();
+}
+
+TEST_CASE("update_load_average reads /proc/loadavg", "[procfs]") {
+  fixture_root root;
+  root.write("/proc/loadavg", "0.50 1.25 2.00 1/100 42\n");
+  update_load_average();
+  REQUIRE(info.loadavg[0] == 0.5f);
+  REQUIRE(info.loadavg[1] == 1.25f);
+  REQUIRE(info.loadavg[2] == 2.0f);
+
+  SECTION("a missing file zeroes it") {
+    fixture_root empty;
+    update_load_average();
+    REQUIRE(info.loadavg[0] == 0.0f);
+  }
+}
@@ -30,7 +30,27 @@
 
 #include <data/os/linux.h>
 
+#include <chrono>
+
+#include <common.h>
+#include <conky.h>
+
 TEST_CASE("get_entropy_avail returns 0", "[get_entropy_avail]") {
   unsigned int unused = 0;
   REQUIRE(get_entropy_avail(&unused) == 0);
 }
+
+TEST_CASE("update_cpu_usage does not block", "[update_cpu_usage]") {
+  /* takes the first snapshot */
+  get_cpu_count();
+  REQUIRE(info.cpu_usage != nullptr);
+
+  auto start = std::chrono::steady_clock::now();
+  current_update_time = get_time();
+  update_cpu_usage();
+  REQUIRE(std::chrono::steady_clock::now() - start <
+          std::chrono::milliseconds(50));
+
+  /* too soon after the snapshot to compute anything */
+  REQUIRE(info.cpu_usage[0] == 0.0f);
+}
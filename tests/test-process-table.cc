@@ -0,0 +1,400 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#include <data/process-table.hh>
+#include <data/top.h>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <random>
+
+namespace {
+/* whether table holds exactly the pids in expected, each in a slot of its
+ * own whose view agrees, and whose views are all on the list */
+bool matches(const conky::process_table &table,
+             const std::map<pid_t, unsigned int> &expected) {
+  if (table.size() != expected.size()) { return false; }
+  for (const auto &[pid, stamp] : expected) {
+    size_t slot = table.find(pid);
+    if (slot == table.size()) { return false; }
+    if (table.pid[slot] != pid || table.time_stamp[slot] != stamp) {
+      return false;
+    }
+    if (table.views[slot]->pid != pid) { return false; }
+  }
+  size_t listed = 0;
+  for (struct process *p = table.first(); p != nullptr; p = p->next) {
+    if (expected.count(p->pid) == 0) { return false; }
+    if (p->next != nullptr && p->next->previous != p) { return false; }
+    ++listed;
+  }
+  return listed == expected.size();
+}
+}  // namespace
+
+TEST_CASE("process table finds processes by pid", "[process-table]") {
+  conky::process_table table;
+
+  REQUIRE(table.find(42) == 0);
+
+  size_t first = table.slot_of(42);
+  size_t second = table.slot_of(7);
+  REQUIRE(first != second);
+  REQUIRE(table.size() == 2);
+  REQUIRE(table.slot_of(42) == first);
+  REQUIRE(table.find(7) == second);
+  REQUIRE(table.find(8) == table.size());
+  REQUIRE(table.pid[second] == 7);
+
+  SECTION("new processes start out like the views did") {
+    REQUIRE(table.previous_user_time[first] == ULONG_MAX);
+    REQUIRE(table.previous_kernel_time[first] == ULONG_MAX);
+    REQUIRE(table.views[first]->previous_user_time == ULONG_MAX);
+    REQUIRE(table.views[first]->name == nullptr);
+    REQUIRE(table.read_at[first] == 0);
+    REQUIRE(table.running[first] == 0);
+  }
+
+  SECTION("the last slot moves into a removed one") {
+    size_t third = table.slot_of(3);
+    table.user_time[third] = 1234;
+    table.time_stamp[second] = table.time_stamp[third] = 1;
+
+    table.remove_stale(1);
+    REQUIRE(table.size() == 2);
+    REQUIRE(table.find(42) == table.size());
+    REQUIRE(table.find(3) == first);
+    REQUIRE(table.user_time[first] == 1234);
+    REQUIRE(table.views[first]->pid == 3);
+    REQUIRE(table.first()->pid == 3);
+    REQUIRE(table.first()->next->pid == 7);
+    REQUIRE(table.first()->next->next == nullptr);
+  }
+
+  SECTION("clearing forgets everything") {
+    table.clear();
+    REQUIRE(table.size() == 0);
+    REQUIRE(table.first() == nullptr);
+    REQUIRE(table.find(42) == 0);
+    REQUIRE(table.slot_of(42) == 0);
+  }
+}
+
+TEST_CASE("process table copies fields to and from the views",
+          "[process-table]") {
+  conky::process_table table;
+  size_t slot = table.slot_of(100);
+
+  table.user_time[slot] = 5;
+  table.rss[slot] = 4096;
+  table.amount[slot] = 12.5;
+  table.to_views();
+  REQUIRE(table.views[slot]->user_time == 5);
+  REQUIRE(table.views[slot]->rss == 4096);
+  REQUIRE(table.views[slot]->amount == 12.5);
+
+  table.views[slot]->kernel_time = 9;
+  table.views[slot]->time_stamp = 3;
+  table.from_views();
+  REQUIRE(table.kernel_time[slot] == 9);
+  REQUIRE(table.time_stamp[slot] == 3);
+  REQUIRE(table.user_time[slot] == 5);
+}
+
+TEST_CASE("process table survives many pids coming and going",
+          "[process-table]") {
+  conky::process_table table;
+  std::map<pid_t, unsigned int> expected;
+  std::mt19937 random(20);
+  /* few enough pids that they are often reused, and spaced so they
+   * collide in the map */
+  std::uniform_int_distribution<pid_t> pids(1, 600);
+
+  for (unsigned int round = 1; round <= 50; ++round) {
+    for (int i = 0; i < 200; ++i) {
+      pid_t pid = pids(random) * 64;
+      table.time_stamp[table.slot_of(pid)] = round;
+      expected[pid] = round;
+    }
+    /* what stays from the last round is what was seen again */
+    if (round % 2 == 0) {
+      table.remove_stale(round);
+      for (auto it = expected.begin(); it != expected.end();) {
+        it = it->second != round ? expected.erase(it) : std::next(it);
+      }
+    }
+    REQUIRE(matches(table, expected));
+  }
+}
+
+TEST_CASE("process table finds the top processes", "[process-table]") {
+  conky::process_table table;
+  const float amounts[] = {5, 20, NAN, 20, 1, 30};
+  for (pid_t pid = 1; pid <= 6; ++pid) {
+    table.amount[table.slot_of(pid)] = amounts[pid - 1];
+  }
+  struct process *list[8];
+
+  SECTION("largest first, equal ones by pid, no cpu time last") {
+    conky::find_top(table, table.amount, 6, list);
+    pid_t pids[6];
+    for (int i = 0; i < 6; ++i) { pids[i] = list[i]->pid; }
+    REQUIRE(std::vector<pid_t>(pids, pids + 6) ==
+            std::vector<pid_t>{6, 2, 4, 1, 5, 3});
+  }
+
+  SECTION("only as many as asked for") {
+    list[2] = nullptr;
+    conky::find_top(table, table.amount, 2, list);
+    REQUIRE(list[0]->pid == 6);
+    REQUIRE(list[1]->pid == 2);
+    REQUIRE(list[2] == nullptr);
+  }
+
+  SECTION("the rest of the list is empty when there are few processes") {
+    conky::find_top(table, table.amount, 8, list);
+    REQUIRE(list[5]->pid == 3);
+    REQUIRE(list[6] == nullptr);
+    REQUIRE(list[7] == nullptr);
+  }
+}
+
+TEST_CASE("process table keeps the cpu times read", "[process-table]") {
+  conky::process_table table;
+  size_t slot = table.slot_of(1);
+
+  table.record_times(slot, 50, 10, 100);
+  REQUIRE(table.user_time[slot] == 0);
+  REQUIRE(table.total_cpu_time[slot] == 60);
+
+  table.record_times(slot, 80, 20, 300);
+  REQUIRE(table.user_time[slot] == 30);
+  REQUIRE(table.kernel_time[slot] == 10);
+  REQUIRE(table.interval[slot] == 200);
+  REQUIRE(table.read_at[slot] == 300);
+  conky::calc_cpu_amounts(table, 100);
+  REQUIRE(table.amount[slot] == 20);
+
+  SECTION("times going back count as no time") {
+    table.record_times(slot, 70, 20, 400);
+    REQUIRE(table.user_time[slot] == 0);
+    REQUIRE(table.previous_user_time[slot] == 70);
+  }
+}
+
+namespace {
+/* One update under top_scan_budget of the processes in slots: those
+ * pick_processes() picks are read, having run for ran each since they
+ * were read before, and the amounts are worked out. */
+std::vector<size_t> scan(conky::process_table &table,
+                         const std::vector<size_t> &slots,
+                         const std::vector<size_t> &shown, size_t count,
+                         unsigned long long ticks, unsigned long ran) {
+  std::vector<size_t> picked;
+  conky::pick_processes(table, slots, shown, count, 1, ticks, picked);
+  for (size_t slot : picked) {
+    table.record_times(slot, table.total_cpu_time[slot] + ran, 0, ticks);
+  }
+  conky::calc_cpu_amounts(table, 100);
+  return picked;
+}
+}  // namespace
+
+TEST_CASE("process table spreads a budgeted scan", "[process-table]") {
+  conky::process_table table;
+  std::vector<size_t> slots;
+  for (pid_t pid = 1; pid <= 10; ++pid) { slots.push_back(table.slot_of(pid)); }
+  /* the first time, all are read */
+  scan(table, slots, {}, slots.size(), 100, 0);
+  scan(table, slots, {}, slots.size(), 200, 50);
+  for (size_t slot : slots) { REQUIRE(table.amount[slot] == 50); }
+
+  SECTION("a skipped process keeps its rate") {
+    std::vector<size_t> picked = scan(table, slots, {}, 3, 300, 100);
+    REQUIRE(picked.size() == 3);
+    for (size_t slot : slots) {
+      bool read = std::count(picked.begin(), picked.end(), slot) != 0;
+      REQUIRE(table.amount[slot] == (read ? 100 : 50));
+      /* the rest are still alive, only not read */
+      if (!read) { REQUIRE(table.time_stamp[slot] == 300); }
+    }
+  }
+
+  SECTION("a process shown before is always read") {
+    std::vector<size_t> shown{slots[9], slots[4]};
+    std::sort(shown.begin(), shown.end());
+    for (unsigned long long ticks = 300; ticks < 1000; ticks += 100) {
+      std::vector<size_t> picked = scan(table, slots, shown, 3, ticks, 10);
+      REQUIRE(picked.size() == 3);
+      for (size_t slot : shown) {
+        REQUIRE(std::count(picked.begin(), picked.end(), slot) == 1);
+        REQUIRE(table.read_at[slot] == ticks);
+      }
+    }
+  }
+
+  SECTION("the others take turns") {
+    std::map<size_t, int> reads;
+    for (unsigned long long ticks = 300; ticks < 800; ticks += 100) {
+      for (size_t slot : scan(table, slots, {}, 2, ticks, 10)) {
+        ++reads[slot];
+      }
+    }
+    /* five updates of two cover all ten, each once */
+    REQUIRE(reads.size() == slots.size());
+    for (const auto &[slot, n] : reads) { REQUIRE(n == 1); }
+  }
+
+  SECTION("at least some are read") {
+    std::vector<size_t> shown{slots[0], slots[1]};
+    std::vector<size_t> picked = scan(table, slots, shown, 1, 300, 10);
+    REQUIRE(picked.size() == 3);
+  }
+}
+
+namespace {
+/* What top did before find_top(), kept from the removed prioqueue.cc for
+ * the benchmark: a list of at most max_size elements sorted by amount,
+ * largest first, with one malloc() per insertion. */
+struct prio_elem {
+  struct prio_elem *next, *prev;
+  struct process *data;
+};
+
+struct prio_queue {
+  int max_size;
+  struct prio_elem *head, *tail;
+  int cur_size;
+};
+
+int compare_amount(struct process *a, struct process *b) {
+  if (b->amount > a->amount) { return 1; }
+  if (a->amount > b->amount) { return -1; }
+  return 0;
+}
+
+struct prio_elem *init_prio_elem(struct process *data) {
+  auto *elem = static_cast<struct prio_elem *>(calloc(1, sizeof(prio_elem)));
+  elem->data = data;
+  return elem;
+}
+
+void insert_prio_elem(struct prio_queue *queue, struct process *data) {
+  if (queue->cur_size == 0) {
+    queue->cur_size++;
+    queue->head = queue->tail = init_prio_elem(data);
+    return;
+  }
+
+  /* short-cut 1: new item is lower than all others */
+  if (compare_amount(queue->tail->data, data) <= 0) {
+    if (queue->cur_size < queue->max_size) {
+      queue->cur_size++;
+      queue->tail->next = init_prio_elem(data);
+      queue->tail->next->prev = queue->tail;
+      queue->tail = queue->tail->next;
+    }
+    return;
+  }
+
+  if (compare_amount(queue->head->data, data) >= 0) {
+    /* short-cut 2: we have a new maximum */
+    queue->cur_size++;
+    queue->head->prev = init_prio_elem(data);
+    queue->head->prev->next = queue->head;
+    queue->head = queue->head->prev;
+  } else {
+    for (struct prio_elem *cur = queue->head->next; cur != nullptr;
+         cur = cur->next) {
+      if (compare_amount(cur->data, data) >= 0) {
+        queue->cur_size++;
+        cur->prev->next = init_prio_elem(data);
+        cur->prev->next->prev = cur->prev;
+        cur->prev->next->next = cur;
+        cur->prev = cur->prev->next;
+        break;
+      }
+    }
+  }
+
+  /* drop the lowest item if queue overrun */
+  if (queue->cur_size > queue->max_size) {
+    queue->cur_size--;
+    queue->tail = queue->tail->prev;
+    free(queue->tail->next);
+    queue->tail->next = nullptr;
+  }
+}
+
+struct process *pop_prio_elem(struct prio_queue *queue) {
+  if (queue->cur_size <= 0) { return nullptr; }
+
+  struct prio_elem *tmp = queue->head;
+  struct process *data = tmp->data;
+  queue->head = queue->head->next;
+  queue->cur_size--;
+  if (queue->head != nullptr) {
+    queue->head->prev = nullptr;
+  } else {
+    queue->tail = nullptr;
+  }
+  free(tmp);
+  return data;
+}
+}  // namespace
+
+TEST_CASE("find the top 50 of 50000 processes",
+          "[.][benchmark][process-table]") {
+  conky::process_table table;
+  std::mt19937 random(50);
+  std::exponential_distribution<float> amounts(1);
+  for (pid_t pid = 1; pid <= 50000; ++pid) {
+    table.amount[table.slot_of(pid)] = amounts(random);
+  }
+  table.to_views();
+  struct process *list[50];
+
+  BENCHMARK("prio_queue") {
+    struct prio_queue queue {50, nullptr, nullptr, 0};
+    for (struct process *p = table.first(); p != nullptr; p = p->next) {
+      insert_prio_elem(&queue, p);
+    }
+    for (int i = 0; i < 50; ++i) { list[i] = pop_prio_elem(&queue); }
+    while (pop_prio_elem(&queue) != nullptr) {}
+    return list[49];
+  };
+  BENCHMARK("find_top") {
+    conky::find_top(table, table.amount, 50, list);
+    return list[49];
+  };
+}
@@ -0,0 +1,116 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#include <lua/setting.hh>
+
+#include <thread>
+
+namespace {
+conky::simple_config_setting<int> snapshot_test_setting("snapshot_test_setting",
+                                                        0, true);
+
+void set_config_table(lua::state &l, const char *code) {
+  l.loadstring(code);
+  l.call(0, 0);
+}
+}  // namespace
+
+TEST_CASE("config settings are read from a snapshot", "[setting]") {
+  lua::state l;
+  set_config_table(l, "conky = { config = { snapshot_test_setting = 42 } }");
+  conky::priv::config_setting_base::invalidate_snapshots();
+
+  REQUIRE(snapshot_test_setting.get(l) == 42);
+
+  SECTION("changes behind the back of the setters need an invalidation") {
+    set_config_table(l, "conky.config.snapshot_test_setting = 7");
+    REQUIRE(snapshot_test_setting.get(l) == 42);
+
+    conky::priv::config_setting_base::invalidate_snapshots();
+    REQUIRE(snapshot_test_setting.get(l) == 7);
+  }
+
+  SECTION("another state is never served from the snapshot") {
+    lua::state other;
+    set_config_table(other,
+                     "conky = { config = { snapshot_test_setting = 3 } }");
+    REQUIRE(snapshot_test_setting.get(other) == 3);
+    REQUIRE(snapshot_test_setting.get(l) == 42);
+  }
+
+  SECTION("two states can be read from two threads at once") {
+    lua::state other;
+    set_config_table(other,
+                     "conky = { config = { snapshot_test_setting = 3 } }");
+    bool other_ok = true;
+    std::thread reader([&other, &other_ok] {
+      for (int i = 0; i < 1000; ++i) {
+        other_ok = other_ok && snapshot_test_setting.get(other) == 3;
+      }
+    });
+    bool ok = true;
+    for (int i = 0; i < 1000; ++i) {
+      ok = ok && snapshot_test_setting.get(l) == 42;
+    }
+    reader.join();
+    REQUIRE(ok);
+    REQUIRE(other_ok);
+
+    /* the replaced snapshots go away two updates later */
+    conky::reclaim_config_snapshots();
+    conky::reclaim_config_snapshots();
+    REQUIRE(snapshot_test_setting.get(l) == 42);
+  }
+
+  SECTION("a snapshot stays readable for an update after it is replaced") {
+    conky::reclaim_config_snapshots();
+    conky::reclaim_config_snapshots();
+    conky::priv::config_setting_base::invalidate_snapshots();
+    REQUIRE(snapshot_test_setting.get(l) == 42);
+    conky::reclaim_config_snapshots();
+    conky::priv::config_setting_base::invalidate_snapshots();
+    REQUIRE(snapshot_test_setting.get(l) == 42);
+    REQUIRE(snapshot_test_setting.get(l) == 42);
+  }
+}
+
+TEST_CASE("config setting lookup", "[.][benchmark]") {
+  lua::state l;
+  set_config_table(l, "conky = { config = { snapshot_test_setting = 42 } }");
+
+  BENCHMARK("get() from the lua state") {
+    conky::priv::config_setting_base::invalidate_snapshots();
+    return snapshot_test_setting.get(l);
+  };
+
+  BENCHMARK("get() from the snapshot") {
+    return snapshot_test_setting.get(l);
+  };
+}
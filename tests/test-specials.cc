@@ -0,0 +1,65 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#include <content/specials.h>
+
+TEST_CASE("specials are reused from one frame to the next", "[specials]") {
+  char buf[2];
+
+  special_count = 0;
+  specials.clear();
+
+  for (int i = 0; i < 3; i++) { new_special(buf, text_node_t::FG); }
+  REQUIRE(special_count == 3);
+  REQUIRE(specials.size() == 3);
+  REQUIRE(buf[0] == SPECIAL_CHAR);
+
+  specials[1].graph_width = 42;
+  const special_node *nodes = specials.data();
+
+  SECTION("a frame with as many specials takes the same nodes") {
+    special_count = 0;
+    for (int i = 0; i < 3; i++) { new_special(buf, text_node_t::GRAPH); }
+    REQUIRE(specials.data() == nodes);
+    REQUIRE(specials.size() == 3);
+    REQUIRE(specials[1].type == text_node_t::GRAPH);
+    REQUIRE(specials[1].graph_width == 42);
+  }
+
+  SECTION("a frame with more specials grows the vector") {
+    special_count = 0;
+    for (int i = 0; i < 4; i++) { new_special(buf, text_node_t::BG); }
+    REQUIRE(specials.size() == 4);
+    REQUIRE(specials[3].graph_width == 0);
+  }
+
+  special_count = 0;
+  specials.clear();
+}
@@ -0,0 +1,248 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#include <conky.h>
+#include <content/text_object.h>
+
+#include <cstring>
+
+namespace {
+int true_iftest(struct text_object *) { return 1; }
+
+int print_calls = 0;
+void counting_print(struct text_object *, char *p, unsigned int p_max_size) {
+  snprintf(p, p_max_size, "%d", ++print_calls);
+}
+
+uint64_t cache_key = 0;
+uint64_t test_cache_key(struct text_object *) { return cache_key; }
+
+size_t sized_print(struct text_object *, char *p, unsigned int p_max_size) {
+  return written_length(snprintf(p, p_max_size, "sized"), p_max_size);
+}
+
+/* builds "a ${if} b ${else} c ${endif} d" by hand */
+struct ifblock_list {
+  struct text_object root {};
+  struct text_object objs[7] {};
+  void *ifblock_opaque = nullptr;
+
+  explicit ifblock_list(int (*iftest)(struct text_object *)) {
+    obj_be_plain_text(&objs[0], "a");
+    objs[1].callbacks.iftest = iftest;
+    obj_be_ifblock_if(&ifblock_opaque, &objs[1]);
+    obj_be_plain_text(&objs[2], "b");
+    objs[3].callbacks.iftest = &gen_false_iftest;
+    obj_be_ifblock_else(&ifblock_opaque, &objs[3]);
+    obj_be_plain_text(&objs[4], "c");
+    objs[5].callbacks.print = &gen_print_nothing;
+    obj_be_ifblock_endif(&ifblock_opaque, &objs[5]);
+    obj_be_plain_text(&objs[6], "d");
+    for (auto &obj : objs) { append_object(&root, &obj); }
+  }
+
+  ~ifblock_list() {
+    for (auto &obj : objs) { free(obj.data.s); }
+  }
+};
+}  // namespace
+
+TEST_CASE("compile_text_objects lowers an object list", "[text_object]") {
+  SECTION("ifblock jumps continue after the else/endif") {
+    ifblock_list list(&gen_false_iftest);
+    text_program prog;
+
+    compile_text_objects(&list.root, &prog);
+
+    REQUIRE(prog.code.size() == 7);
+    REQUIRE(prog.code[1].op == text_op::IFTEST);
+    REQUIRE(prog.code[1].jump == 4);
+    REQUIRE(prog.code[3].op == text_op::IFTEST);
+    REQUIRE(prog.code[3].jump == 6);
+  }
+
+  SECTION("objects without callbacks are left out") {
+    struct text_object root {};
+    struct text_object objs[3] {};
+    text_program prog;
+
+    obj_be_plain_text(&objs[0], "x");
+    obj_be_plain_text(&objs[2], "y");
+    for (auto &obj : objs) { append_object(&root, &obj); }
+
+    compile_text_objects(&root, &prog);
+
+    REQUIRE(prog.code.size() == 2);
+    REQUIRE(prog.code[0].obj == &objs[0]);
+    REQUIRE(prog.code[1].obj == &objs[2]);
+
+    free(objs[0].data.s);
+    free(objs[2].data.s);
+  }
+
+  SECTION("generated text follows the taken branch") {
+    char buf[32];
+
+    ifblock_list false_list(&gen_false_iftest);
+    generate_text_internal(buf, sizeof(buf), false_list.root);
+    REQUIRE(strcmp(buf, "acd") == 0);
+
+    ifblock_list true_list(&true_iftest);
+    generate_text_internal(buf, sizeof(buf), true_list.root);
+    REQUIRE(strcmp(buf, "abd") == 0);
+  }
+}
+
+TEST_CASE("print output is reused according to the cache policy",
+          "[text_object]") {
+  struct text_object root {};
+  struct text_object obj {};
+  text_program prog;
+  char buf[32];
+
+  obj.callbacks.print = &counting_print;
+  append_object(&root, &obj);
+  print_calls = 0;
+  /* the policy is looked at when compiling, as after construction */
+  auto compile = [&] {
+    compile_text_objects(&root, &prog);
+    root.program = &prog;
+  };
+
+  SECTION("objects without a policy print on every update") {
+    compile();
+    generate_text_internal(buf, sizeof(buf), root);
+    generate_text_internal(buf, sizeof(buf), root);
+    REQUIRE(print_calls == 2);
+    REQUIRE(strcmp(buf, "2") == 0);
+  }
+
+  SECTION("only objects with a policy get a cache") {
+    compile();
+    REQUIRE(prog.code[0].cache == NO_TEXT_CACHE);
+    REQUIRE(prog.caches.empty());
+    obj.cache_policy = text_cache_policy::STATIC;
+    compile();
+    REQUIRE(prog.code[0].cache == 0);
+    REQUIRE(prog.caches.size() == 1);
+  }
+
+  SECTION("static objects print once") {
+    obj.cache_policy = text_cache_policy::STATIC;
+    compile();
+    generate_text_internal(buf, sizeof(buf), root);
+    generate_text_internal(buf, sizeof(buf), root);
+    REQUIRE(print_calls == 1);
+    REQUIRE(strcmp(buf, "1") == 0);
+  }
+
+  SECTION("truncated output is not reused") {
+    obj.cache_policy = text_cache_policy::STATIC;
+    compile();
+    generate_text_internal(buf, 2, root);
+    generate_text_internal(buf, sizeof(buf), root);
+    REQUIRE(print_calls == 2);
+  }
+
+  SECTION("callback objects without a callback print on every update") {
+    obj.cache_policy = text_cache_policy::CALLBACK;
+    compile();
+    generate_text_internal(buf, sizeof(buf), root);
+    generate_text_internal(buf, sizeof(buf), root);
+    REQUIRE(print_calls == 2);
+  }
+
+  SECTION("key objects print when their key changes") {
+    obj.cache_policy = text_cache_policy::KEY;
+    obj.callbacks.cache_key = &test_cache_key;
+    cache_key = 1;
+    compile();
+    generate_text_internal(buf, sizeof(buf), root);
+    generate_text_internal(buf, sizeof(buf), root);
+    REQUIRE(print_calls == 1);
+    cache_key = 2;
+    generate_text_internal(buf, sizeof(buf), root);
+    REQUIRE(print_calls == 2);
+    REQUIRE(strcmp(buf, "2") == 0);
+  }
+
+  SECTION("plain text is not cached") {
+    struct text_object text {};
+    obj_be_plain_text(&text, "text");
+    REQUIRE(text.cache_policy == text_cache_policy::NONE);
+    free(text.data.s);
+  }
+}
+
+TEST_CASE("print_len callbacks report the length they wrote",
+          "[text_object]") {
+  SECTION("written_length clamps to the buffer") {
+    REQUIRE(written_length(5, 10) == 5);
+    REQUIRE(written_length(10, 10) == 9);
+    REQUIRE(written_length(-1, 10) == 0);
+    REQUIRE(written_length(3, 0) == 0);
+  }
+
+  SECTION("print_len takes precedence over print") {
+    struct text_object root {};
+    struct text_object objs[2] {};
+    char buf[32];
+
+    objs[0].callbacks.print = &counting_print;
+    objs[0].callbacks.print_len = &sized_print;
+    obj_be_plain_text(&objs[1], "!");
+    for (auto &obj : objs) { append_object(&root, &obj); }
+    print_calls = 0;
+
+    generate_text_internal(buf, sizeof(buf), root);
+    REQUIRE(print_calls == 0);
+    REQUIRE(strcmp(buf, "sized!") == 0);
+
+    generate_text_internal(buf, 4, root);
+    REQUIRE(strcmp(buf, "siz") == 0);
+
+    free(objs[1].data.s);
+  }
+
+  SECTION("text_builder keeps track of its length") {
+    char buf[8];
+    text_builder out(buf, sizeof(buf));
+
+    memcpy(out.end(), "abc", 4);
+    out.commit(3);
+    REQUIRE(out.length() == 3);
+    REQUIRE(out.room() == 5);
+
+    memcpy(out.end(), "defgh", 5);
+    out.commit(5);
+    REQUIRE(out.length() == 7);
+    REQUIRE(strcmp(buf, "abcdefg") == 0);
+  }
+}
@@ -0,0 +1,131 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#include <timer-wheel.hh>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace {
+struct item {
+  int id;
+};
+
+typedef std::vector<std::pair<int, uint64_t>> firings;
+
+/* advance one tick at a time, the way a late or early timer would not */
+firings advance_by_tick(conky::timer_wheel<item> &wheel, uint64_t to) {
+  firings fired;
+  while (wheel.now() < to) {
+    uint64_t t = wheel.now() + 1;
+    wheel.advance(t, [&](item *i) { fired.emplace_back(i->id, t); });
+  }
+  return fired;
+}
+}  // namespace
+
+TEST_CASE("timer wheel fires items at their deadlines", "[timer-wheel]") {
+  conky::timer_wheel<item> wheel(1000);
+  item a{1}, b{2}, c{3}, d{4};
+
+  SECTION("on every level") {
+    wheel.schedule(&a, 1005);
+    wheel.schedule(&b, 1000 + 100);
+    wheel.schedule(&c, 1000 + 5000);
+    wheel.schedule(&d, 1000 + 300000);
+
+    auto fired = advance_by_tick(wheel, 1000 + 400000);
+    REQUIRE(fired == firings{{1, 1005}, {2, 1100}, {3, 6000}, {4, 301000}});
+    REQUIRE(wheel.empty());
+  }
+
+  SECTION("when advanced in one go") {
+    wheel.schedule(&a, 1000 + 70);
+    wheel.schedule(&b, 1000 + 64 * 64 * 64 + 1);
+    firings fired;
+    wheel.advance(1000 + 1000000, [&](item *i) {
+      fired.emplace_back(i->id, wheel.now());
+    });
+    REQUIRE(fired == firings{{1, 1070}, {2, 1000 + 64 * 64 * 64 + 1}});
+  }
+
+  SECTION("beyond the top level") {
+    const uint64_t far = 1000 + uint64_t(64) * 64 * 64 * 64 * 3;
+    wheel.schedule(&a, far);
+    firings fired;
+    wheel.advance(far - 1, [&](item *i) { fired.emplace_back(i->id, 0); });
+    REQUIRE(fired.empty());
+    wheel.advance(far, [&](item *i) {
+      fired.emplace_back(i->id, wheel.now());
+    });
+    REQUIRE(fired == firings{{1, far}});
+  }
+
+  SECTION("past deadlines fire on the next tick") {
+    wheel.schedule(&a, 10);
+    REQUIRE(advance_by_tick(wheel, 1001) == firings{{1, 1001}});
+  }
+
+  SECTION("cancelled and moved items") {
+    wheel.schedule(&a, 1010);
+    wheel.schedule(&b, 1020);
+    wheel.schedule(&b, 1030);
+    REQUIRE(wheel.cancel(&a));
+    REQUIRE_FALSE(wheel.cancel(&a));
+    REQUIRE(advance_by_tick(wheel, 1100) == firings{{2, 1030}});
+  }
+
+  SECTION("items rescheduled while firing") {
+    wheel.schedule(&a, 1010);
+    firings fired;
+    wheel.advance(1035, [&](item *i) {
+      fired.emplace_back(i->id, wheel.now());
+      wheel.schedule(i, wheel.now() + 10);
+    });
+    REQUIRE(fired == firings{{1, 1010}, {1, 1020}, {1, 1030}});
+    REQUIRE(wheel.next_event() == 1040);
+  }
+}
+
+TEST_CASE("timer wheel with 100000 items", "[.][benchmark][timer-wheel]") {
+  std::vector<item> items(100000);
+  for (size_t i = 0; i < items.size(); ++i) { items[i].id = i; }
+
+  BENCHMARK("schedule and fire") {
+    conky::timer_wheel<item> wheel;
+    for (size_t i = 0; i < items.size(); ++i) {
+      wheel.schedule(&items[i], 1 + (i * 7919) % 100000);
+    }
+    size_t fired = 0;
+    wheel.advance(100000, [&](item *) { ++fired; });
+    return fired;
+  };
+}
@@ -0,0 +1,622 @@
+/*
+ *
+ * Conky, a system monitor, based on torsmo
+ *
+ * Any original torsmo code is licensed under the BSD license
+ *
+ * All code written since the fork of torsmo is licensed under the GPL
+ *
+ * Please see COPYING for details
+ *
+ * Copyright (c) 2005-2024 Brenden Matthews, Philip Kovacs, et. al.
+ *	(see AUTHORS)
+ * All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "catch2/catch.hpp"
+
+#include <callback-stats.hh>
+#include <content/text_object.h>
+#include <update-cb.hh>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+class counter_cb : public conky::callback<int, int> {
+  typedef conky::callback<int, int> Base;
+
+ protected:
+  virtual void work() {
+    std::lock_guard<std::mutex> lock(result_mutex);
+    ++result;
+  }
+
+ public:
+  counter_cb(uint32_t period, bool wait, int key)
+      : Base(period, wait, Base::Tuple(key)) {
+    result = 0;
+  }
+};
+
+typedef conky::callback_handle<counter_cb> counter_cb_handle;
+
+/* state shared by the part_cb callbacks of a test */
+std::atomic<int> inside{0};
+std::atomic<bool> overlapped{false};
+std::mutex order_mutex;
+std::vector<int> order;
+
+/* records when it ran, and whether it overlapped with another part_cb */
+class part_cb : public conky::callback<int, int> {
+  typedef conky::callback<int, int> Base;
+
+ protected:
+  virtual void work() {
+    if (inside++ != 0) { overlapped = true; }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    {
+      std::lock_guard<std::mutex> lock(order_mutex);
+      order.push_back(std::get<0>(tuple));
+    }
+    --inside;
+  }
+
+ public:
+  part_cb(uint32_t period, int key, uint32_t writes, uint32_t reads)
+      : Base(period, true, Base::Tuple(key)) {
+    declare_parts(writes, reads);
+  }
+};
+
+/* sleeps for as many milliseconds as its key says */
+class sleep_cb : public conky::callback<int, int> {
+  typedef conky::callback<int, int> Base;
+
+ protected:
+  virtual void work() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(get<0>()));
+  }
+
+ public:
+  sleep_cb(uint32_t period, bool wait, int ms, uint32_t writes = 0,
+           uint32_t reads = 0)
+      : Base(period, wait, Base::Tuple(ms)) {
+    declare_parts(writes, reads);
+  }
+};
+
+/* sleeps for as many milliseconds as its key says, like a command which
+ * takes its time */
+class blocking_cb : public conky::callback<int, int> {
+  typedef conky::callback<int, int> Base;
+
+ protected:
+  virtual void work() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(get<0>()));
+  }
+
+ public:
+  blocking_cb(uint32_t period, int ms) : Base(period, false, Base::Tuple(ms)) {
+    declare_blocking();
+  }
+};
+
+/* state written in place by shared_cb, like the global info */
+std::atomic<bool> writing{false};
+int shared_value = 0;
+
+/* sleeps for as many milliseconds as its key says while writing
+ * shared_value, without locking */
+class shared_cb : public conky::callback<int, int> {
+  typedef conky::callback<int, int> Base;
+
+ protected:
+  virtual void work() {
+    writing = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(get<0>()));
+    ++shared_value;
+    writing = false;
+  }
+
+ public:
+  shared_cb(uint32_t period, int ms, uint32_t writes = 0, uint32_t reads = 0)
+      : Base(period, true, Base::Tuple(ms)) {
+    declare_parts(writes, reads);
+    writes_shared_state();
+  }
+};
+
+/* sleeps for as many milliseconds as its key says, noting the thread */
+class thread_cb : public conky::callback<std::thread::id, int> {
+  typedef conky::callback<std::thread::id, int> Base;
+
+ protected:
+  virtual void work() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(get<0>()));
+    std::lock_guard<std::mutex> lock(result_mutex);
+    result = std::this_thread::get_id();
+  }
+
+ public:
+  thread_cb(uint32_t period, bool wait, int ms)
+      : Base(period, wait, Base::Tuple(ms)) {}
+};
+
+/* publishes a string of its key's length, changing every other run */
+class publish_cb : public conky::callback<std::string, int> {
+  typedef conky::callback<std::string, int> Base;
+  int runs = 0;
+
+ protected:
+  virtual void work() {
+    ++runs;
+    publish(std::string(get<0>(), 'a' + (runs - 1) / 2 % 26));
+  }
+
+ public:
+  publish_cb(uint32_t period, bool wait, int size)
+      : Base(period, wait, Base::Tuple(size)) {}
+};
+
+/* adds up its key's numbers with run_parallel() */
+class parallel_cb : public conky::callback<long, int> {
+  typedef conky::callback<long, int> Base;
+
+ protected:
+  virtual void work() {
+    std::atomic<long> sum{0};
+    conky::run_parallel(get<0>(), [&sum](size_t i) { sum += i; });
+    std::lock_guard<std::mutex> lock(result_mutex);
+    result = sum;
+  }
+
+ public:
+  parallel_cb(uint32_t period, bool wait, int count)
+      : Base(period, wait, Base::Tuple(count)) {
+    result = 0;
+  }
+};
+
+/* the report of the callback called name, or one with no runs */
+conky::callback_report report_of(const std::string &name) {
+  for (const auto &r : conky::callback_reports()) {
+    if (r.name == name) { return r; }
+  }
+  return conky::callback_report{name, 0, 0, 0, 0, 0, 0, 0, 0};
+}
+
+/* let run_all_callbacks() forget the callbacks nobody holds any more */
+void forget_unused_callbacks() {
+  for (int i = 0; i < 5; ++i) { conky::run_all_callbacks(); }
+}
+
+/* a line of /proc/self/status, e.g. "VmRSS:    1234 kB" */
+std::string self_status(const std::string &key) {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, key.size(), key) == 0) { return line; }
+  }
+  return key + " unknown";
+}
+}  // namespace
+
+TEST_CASE("callbacks are run by run_all_callbacks()", "[update-cb]") {
+  SECTION("waited-for callbacks are done when it returns") {
+    std::vector<counter_cb_handle> handles;
+    for (int i = 0; i < 100; ++i) {
+      handles.push_back(conky::register_cb<counter_cb>(1, true, i));
+    }
+
+    conky::run_all_callbacks();
+    for (auto &h : handles) { REQUIRE(h->get_result_copy() == 1); }
+    conky::run_all_callbacks();
+    for (auto &h : handles) { REQUIRE(h->get_result_copy() == 2); }
+
+    handles.clear();
+    forget_unused_callbacks();
+  }
+
+  SECTION("callbacks with equal keys are merged") {
+    auto a = conky::register_cb<counter_cb>(5, true, 1000);
+    auto b = conky::register_cb<counter_cb>(1, true, 1000);
+    REQUIRE(&*a == &*b);
+
+    /* the smaller period wins */
+    conky::run_all_callbacks();
+    conky::run_all_callbacks();
+    REQUIRE(a->get_result_copy() == 2);
+  }
+  forget_unused_callbacks();
+
+  SECTION("background callbacks run eventually") {
+    auto h = conky::register_cb<counter_cb>(1, false, 2000);
+    conky::run_all_callbacks();
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (h->get_generation() == 0 &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    REQUIRE(h->get_result_copy() == 1);
+  }
+  forget_unused_callbacks();
+}
+
+TEST_CASE("timed callbacks run on their own schedule", "[update-cb]") {
+  SECTION("without wait, between updates") {
+    auto h = conky::register_timed_cb<counter_cb>(0.02, false, 3000);
+
+    /* no run_all_callbacks() at all */
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    int runs = h->get_result_copy();
+    REQUIRE(runs >= 5);
+    REQUIRE(runs <= 17);
+  }
+
+  SECTION("with wait, on the first update after the deadline") {
+    auto h = conky::register_timed_cb<counter_cb>(0.05, true, 3001);
+
+    conky::run_all_callbacks();
+    REQUIRE(h->get_result_copy() == 1);
+    conky::run_all_callbacks();
+    REQUIRE(h->get_result_copy() == 1);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    conky::run_all_callbacks();
+    REQUIRE(h->get_result_copy() == 2);
+  }
+
+  SECTION("merged with one driven by updates") {
+    auto timed = conky::register_timed_cb<counter_cb>(10, true, 3002);
+    auto every_update = conky::register_cb<counter_cb>(1, true, 3002);
+
+    conky::run_all_callbacks();
+    conky::run_all_callbacks();
+    REQUIRE(timed->get_result_copy() == 2);
+  }
+
+  SECTION("merged without wait, the timer lets go of it") {
+    auto timed = conky::register_timed_cb<counter_cb>(0.005, false, 3003);
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    auto every_update = conky::register_cb<counter_cb>(1, false, 3003);
+
+    /* a run the timer started before the merge may still be going */
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    int runs = timed->get_result_copy();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    REQUIRE(timed->get_result_copy() == runs);
+  }
+  forget_unused_callbacks();
+}
+
+TEST_CASE("declared callbacks respect their dependencies", "[update-cb]") {
+  enum { A = 1, B = 2 };
+  order.clear();
+  overlapped = false;
+
+  SECTION("writers run before readers, one at a time") {
+    /* registered readers first, to show that the order is not the set's */
+    auto reader = conky::register_cb<part_cb>(1, 4000, 0, A | B);
+    auto writer_b = conky::register_cb<part_cb>(1, 4001, B, A);
+    auto writer_a = conky::register_cb<part_cb>(1, 4002, A, 0);
+
+    conky::run_all_callbacks();
+    REQUIRE_FALSE(overlapped);
+    REQUIRE(order == std::vector<int>{4002, 4001, 4000});
+  }
+
+  SECTION("independent ones run at the same time") {
+    auto a = conky::register_cb<part_cb>(1, 4003, A, 0);
+    auto b = conky::register_cb<part_cb>(1, 4004, B, 0);
+
+    /* with a single worker the main thread helps out; give it a few tries */
+    for (int i = 0; i < 20 && !overlapped; ++i) { conky::run_all_callbacks(); }
+    REQUIRE(overlapped);
+  }
+  forget_unused_callbacks();
+}
+
+TEST_CASE("callbacks keep statistics", "[update-cb]") {
+  SECTION("of how long work() took") {
+    auto h = conky::register_cb<part_cb>(1, 3000, 0, 0);
+    REQUIRE(h->name() == "(anonymous namespace)::part_cb");
+
+    for (int i = 0; i < 3; ++i) { conky::run_all_callbacks(); }
+    auto r = report_of(h->name());
+    REQUIRE(r.runs == 3);
+    REQUIRE(r.total >= 15000);
+    REQUIRE(r.max >= 5000);
+    REQUIRE(r.p50 >= 4000);
+    REQUIRE(r.p50 <= r.p99);
+    REQUIRE(r.p99 <= r.max);
+  }
+  forget_unused_callbacks();
+
+  SECTION("of runs skipped while it was busy") {
+    auto h = conky::register_cb<sleep_cb>(1, false, 20);
+    for (int i = 0; i < 5; ++i) { conky::run_all_callbacks(); }
+
+    /* every run() either ran or was folded into another run */
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    conky::callback_report r;
+    do {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      r = report_of(h->name());
+    } while (r.runs + r.skipped < 5 &&
+             std::chrono::steady_clock::now() < deadline);
+    REQUIRE(r.runs + r.skipped == 5);
+    REQUIRE(r.skipped > 0);
+  }
+  forget_unused_callbacks();
+
+  SECTION("${cb_stats} reads them once per update") {
+    struct text_object obj {};
+    char before[256], after[256];
+    scan_cb_stats(&obj, "top 1");
+
+    print_cb_stats(&obj, before, sizeof(before));
+    auto slow = conky::register_cb<sleep_cb>(1, true, 50);
+    conky::run_all_callbacks();
+    print_cb_stats(&obj, after, sizeof(after));
+    REQUIRE(std::string(after) == before);
+  }
+  forget_unused_callbacks();
+}
+
+TEST_CASE("updates do not wait past their deadline", "[update-cb]") {
+  SECTION("slow callbacks are left behind and flagged stale") {
+    auto slow = conky::register_cb<sleep_cb>(1, true, 300);
+    auto fast = conky::register_cb<counter_cb>(1, true, 4000);
+    auto name = slow->name();
+
+    /* let the update learn how long they take */
+    conky::run_all_callbacks();
+
+    auto start = std::chrono::steady_clock::now();
+    conky::run_all_callbacks(0.02);
+    REQUIRE(std::chrono::steady_clock::now() - start <
+            std::chrono::milliseconds(200));
+    REQUIRE(slow->is_stale());
+    REQUIRE_FALSE(fast->is_stale());
+    REQUIRE(fast->get_result_copy() == 2);
+    REQUIRE(conky::callbacks_stale(nullptr));
+    REQUIRE(conky::callbacks_stale(name.c_str()));
+    REQUIRE_FALSE(conky::callbacks_stale(fast->name().c_str()));
+
+    /* still busy, so it is not run again */
+    conky::run_all_callbacks(0.02);
+    REQUIRE(slow->is_stale());
+    REQUIRE(fast->get_result_copy() == 3);
+    REQUIRE(report_of(name).timeouts == 2);
+
+    /* once done, it is waited for again */
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    REQUIRE(slow->get_generation() == 2);
+    conky::run_all_callbacks();
+    REQUIRE_FALSE(slow->is_stale());
+    REQUIRE(slow->get_generation() == 3);
+    REQUIRE(report_of(name).runs == 3);
+  }
+  forget_unused_callbacks();
+
+  SECTION("readers of a late writer keep their old results") {
+    auto writer = conky::register_cb<sleep_cb>(1, true, 301, 1, 0);
+    auto reader = conky::register_cb<sleep_cb>(1, true, 1, 0, 1);
+    conky::run_all_callbacks();
+
+    conky::run_all_callbacks(0.02);
+    REQUIRE(writer->is_stale());
+    REQUIRE(reader->is_stale());
+    REQUIRE(reader->get_generation() == 1);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    conky::run_all_callbacks();
+    REQUIRE_FALSE(writer->is_stale());
+    REQUIRE_FALSE(reader->is_stale());
+    REQUIRE(reader->get_generation() == 2);
+  }
+  forget_unused_callbacks();
+
+  SECTION("writers of shared state are waited for anyway") {
+    auto writer = conky::register_cb<shared_cb>(1, 150);
+    auto slow = conky::register_cb<sleep_cb>(1, true, 302);
+    conky::run_all_callbacks();
+    int seen = shared_value;
+
+    /* what the update reads afterwards is not written any more */
+    auto start = std::chrono::steady_clock::now();
+    conky::run_all_callbacks(0.02);
+    REQUIRE(std::chrono::steady_clock::now() - start >=
+            std::chrono::milliseconds(150));
+    REQUIRE_FALSE(writing);
+    REQUIRE(shared_value == seen + 1);
+    REQUIRE_FALSE(writer->is_stale());
+    REQUIRE(slow->is_stale());
+    REQUIRE(report_of(writer->name()).timeouts == 0);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+  }
+  forget_unused_callbacks();
+
+  SECTION("readers of a late writer of shared state still run") {
+    auto writer = conky::register_cb<shared_cb>(1, 151, 1, 0);
+    auto reader = conky::register_cb<shared_cb>(1, 1, 0, 1);
+    auto other = conky::register_cb<sleep_cb>(1, true, 303, 0, 1);
+    conky::run_all_callbacks();
+
+    /* the update waits for the writer, then for the reader it started, but
+     * not for the reader which does not write shared state */
+    auto start = std::chrono::steady_clock::now();
+    conky::run_all_callbacks(0.02);
+    REQUIRE(std::chrono::steady_clock::now() - start <
+            std::chrono::milliseconds(300));
+    REQUIRE_FALSE(writer->is_stale());
+    REQUIRE_FALSE(reader->is_stale());
+    REQUIRE(reader->get_generation() == 2);
+    REQUIRE(other->is_stale());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+  }
+  forget_unused_callbacks();
+
+  SECTION("callbacks which have not run yet stay off the update's thread") {
+    auto untried = conky::register_cb<thread_cb>(1, true, 300);
+
+    auto start = std::chrono::steady_clock::now();
+    conky::run_all_callbacks(0.02);
+    REQUIRE(std::chrono::steady_clock::now() - start <
+            std::chrono::milliseconds(200));
+    REQUIRE(untried->is_stale());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    REQUIRE(untried->get_generation() == 1);
+    REQUIRE(untried->get_result_copy() != std::this_thread::get_id());
+  }
+  forget_unused_callbacks();
+}
+
+TEST_CASE("blocking callbacks leave the pool alone", "[update-cb]") {
+  SECTION("while all of them hang, the others still run") {
+    std::vector<conky::callback_handle<blocking_cb>> blocking;
+    unsigned int workers = std::max(1U, std::thread::hardware_concurrency());
+    for (unsigned int i = 0; i <= workers; ++i) {
+      blocking.push_back(conky::register_cb<blocking_cb>(1, 400 + i));
+    }
+    conky::run_all_callbacks();
+
+    /* not run yet, so it has to run on a worker */
+    auto waited = conky::register_cb<counter_cb>(1, true, 5000);
+    conky::run_all_callbacks(0.2);
+    REQUIRE_FALSE(waited->is_stale());
+    REQUIRE(waited->get_result_copy() == 1);
+  }
+
+  SECTION("a config full of them uses a bounded number of threads") {
+    auto threads = [] {
+      return std::stoi(self_status("Threads:").substr(8));
+    };
+    int before = threads();
+    std::vector<conky::callback_handle<blocking_cb>> blocking;
+    for (int i = 0; i < 150; ++i) {
+      blocking.push_back(conky::register_cb<blocking_cb>(1, 20 + i));
+    }
+    conky::run_all_callbacks();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    int grown = threads() - before;
+    printf("150 blocking callbacks: %d more threads, %s\n", grown,
+           self_status("VmRSS").c_str());
+    /* BLOCKING_WORKERS_MAX, and the timer */
+    REQUIRE(grown <= 16 + 1);
+
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+    for (auto &h : blocking) { REQUIRE(h->get_generation() == 1); }
+  }
+  forget_unused_callbacks();
+}
+
+TEST_CASE("callbacks can publish their results", "[update-cb]") {
+  SECTION("readers keep the result they have") {
+    auto h = conky::register_cb<publish_cb>(1, true, 100);
+    REQUIRE(h->get_result_ptr()->empty());
+
+    conky::run_all_callbacks();
+    auto first = h->get_result_ptr();
+    REQUIRE(*first == std::string(100, 'a'));
+
+    /* an equal result is not published again */
+    conky::run_all_callbacks();
+    REQUIRE(h->get_result_ptr() == first);
+
+    conky::run_all_callbacks();
+    REQUIRE(*h->get_result_ptr() == std::string(100, 'b'));
+    REQUIRE(*first == std::string(100, 'a'));
+  }
+  forget_unused_callbacks();
+}
+
+TEST_CASE("work can be split with run_parallel()", "[update-cb]") {
+  SECTION("every piece is done once") {
+    for (size_t count : {0, 1, 2, 1000}) {
+      std::vector<std::atomic<int>> done(count);
+      conky::run_parallel(count, [&done](size_t i) { ++done[i]; });
+      for (auto &d : done) { REQUIRE(d == 1); }
+    }
+  }
+
+  SECTION("pieces run on the pool") {
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    conky::run_parallel(64, [&](size_t) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      std::lock_guard<std::mutex> lock(mutex);
+      threads.insert(std::this_thread::get_id());
+    });
+    REQUIRE(!threads.empty());
+    if (std::thread::hardware_concurrency() > 1) {
+      REQUIRE(threads.size() > 1);
+    }
+  }
+
+  SECTION("callbacks split their work") {
+    /* more of them than there are workers, all waiting for helpers */
+    std::vector<conky::callback_handle<parallel_cb>> handles;
+    for (int i = 0; i < 16; ++i) {
+      handles.push_back(conky::register_cb<parallel_cb>(1, true, 1000 + i));
+    }
+    conky::run_all_callbacks();
+    for (int i = 0; i < 16; ++i) {
+      long n = 1000 + i;
+      REQUIRE(handles[i]->get_result_copy() == n * (n - 1) / 2);
+    }
+  }
+  forget_unused_callbacks();
+}
+
+TEST_CASE("run 5000 callbacks", "[.][benchmark][update-cb]") {
+  std::vector<counter_cb_handle> handles;
+  for (int i = 0; i < 5000; ++i) {
+    /* mostly background callbacks, like execi, with some waited-for ones */
+    handles.push_back(conky::register_cb<counter_cb>(1, i % 10 == 0, i));
+  }
+  conky::run_all_callbacks();
+
+  std::printf("with %zu callbacks: %s, %s\n", handles.size(),
+              self_status("VmRSS").c_str(), self_status("Threads").c_str());
+
+  BENCHMARK("frame") { conky::run_all_callbacks(); };
+
+  handles.clear();
+  forget_unused_callbacks();
+}
+
+TEST_CASE("read a 64 KiB result", "[.][benchmark][update-cb]") {
+  auto h = conky::register_cb<publish_cb>(1, false, 64 * 1024);
+  conky::run_all_callbacks();
+  while (h->get_generation() == 0) { std::this_thread::yield(); }
+
+  BENCHMARK("copy") { return std::string(*h->get_result_ptr()).size(); };
+  BENCHMARK("published") { return h->get_result_ptr()->size(); };
+}